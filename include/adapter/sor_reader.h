@@ -0,0 +1,115 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "data/dataframe.h"
+#include "data/parallel_frame_builder.h"
+#include "adapter/sor_scanner.h"
+
+/** The number of lines at the start of a file the schema is inferred from. */
+#define SOR_SCHEMA_LINES      500
+/** The fewest bytes of a file worth giving a thread of their own. */
+#define SOR_MIN_THREAD_BYTES  (size_t(1) << 20)
+/** The number of places lines are sampled from to estimate the row count. */
+#define SOR_SAMPLE_POINTS     8
+/** The number of lines sampled at each of those places. */
+#define SOR_SAMPLE_LINES      64
+
+/****************************************************************************
+ * SorReader::
+ *
+ * Reads files in Schema-on-Read (SoR) format into dataframes, in parallel.
+ * Every line is a row of fields in angle brackets, eg. <1> <"a b"> <>, where
+ * an empty field is missing, and strings may be quoted to hold spaces. The
+ * schema is inferred from the first SOR_SCHEMA_LINES lines: there are as many
+ * columns as the longest of them has fields, and each column takes the most
+ * general type of the values in it, from bool (0 or 1) to int, float and
+ * string. Fields that do not parse as the type of their column are missing,
+ * as are the fields a line is short of.
+ * The file is mapped and split at line boundaries into one range per thread.
+ * Each thread finds the brackets, quotes and line ends of its range with a
+ * SorScanner, parses each field straight as the type of its column with
+ * std::from_chars, and appends it to its own segment of columns. The segments
+ * are then spliced together in order. Before parsing, each segment reserves
+ * room for the rows its range is estimated to hold, from the average length
+ * of a sample of lines, so that its columns do not grow a row at a time; the
+ * slack is released once the frame is finished.
+ */
+class SorReader {
+public:
+    /** The size and throughput of a read. */
+    struct Report {
+        /** The number of bytes read. */
+        size_t bytes = 0;
+        /** The number of rows read. */
+        size_t rows = 0;
+        /** The number of threads the file was split between. */
+        size_t threads = 0;
+        /** The time spent reading, in seconds. */
+        double seconds = 0;
+
+        /** Returns the bytes read per second, in MB. */
+        double mbps() const;
+        /** Returns the rows read per second. */
+        double rows_per_second() const;
+        /** Returns a one line summary. */
+        std::string to_string() const;
+    };
+
+    /** Reads the SoR file at the given path. If report is given, it is filled
+     * in with the size and throughput of the read. Returns nullptr if the file
+     * cannot be mapped. */
+    static std::shared_ptr<DataFrame> read(const std::string& path, Report *report = nullptr);
+
+    /** Parses the SoR text in [begin, end) on up to the given number of
+     * threads. */
+    static std::shared_ptr<DataFrame> parse(const char *begin, const char *end,
+                                            size_t max_threads = MAX_THREADS);
+
+    /** Estimates the number of lines in [begin, end) from the average length
+     * of SOR_SAMPLE_LINES lines at each of SOR_SAMPLE_POINTS evenly spaced
+     * places, rounded up. */
+    static size_t estimate_rows(const char *begin, const char *end);
+
+private:
+    friend class SorStream;
+
+    /** A field of a line, without its brackets, surrounding spaces and quotes. */
+    struct Field {
+        const char *begin;
+        const char *end;
+        /** Whether the value was quoted, making it a string. */
+        bool quoted;
+    };
+
+    /** Finds the next field of the line, where s is the last structural
+     * character the scanner returned, advancing s past the field. Returns false
+     * if the line ends, or ends before the field is closed, leaving s at the
+     * end of the line. */
+    static bool _next_field(SorScanner& scan, const char *&s, Field& field);
+
+    /** Returns the type of the field's value ('B', 'I', 'F' or 'S'), or 0 if
+     * it is missing. */
+    static char _field_type(const Field& field);
+
+    /** Returns the number of threads to split the given number of bytes
+     * between, one for every SOR_MIN_THREAD_BYTES up to max_threads. */
+    static size_t _thread_count(size_t bytes, size_t max_threads);
+
+    /** Returns the average number of bytes in a line of [begin, end), from
+     * the lines sampled by estimate_rows. */
+    static double _bytes_per_line(const char *begin, const char *end);
+
+    /** Infers the schema from the first SOR_SCHEMA_LINES lines of the text. */
+    static std::unique_ptr<Schema> _infer_schema(const char *begin, const char *end);
+
+    /** Parses every line of [begin, end) onto the end of the segment. */
+    static void _parse_range(const char *begin, const char *end, const Schema& schema,
+                             ParallelFrameBuilder::Segment& segment);
+
+    /** Parses [begin, end) with the given schema, split at line boundaries
+     * between up to the given number of threads. */
+    static std::shared_ptr<DataFrame> _parse_lines(const char *begin, const char *end,
+                                                   const Schema& schema, size_t max_threads);
+};
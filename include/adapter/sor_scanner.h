@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/** The number of bytes SorScanner classifies at once. */
+#define SOR_SCAN_BLOCK  64
+
+/****************************************************************************
+ * SorScanner::
+ *
+ * Finds the characters that give SoR text its structure, '<', '>', '"' and
+ * '\n', in order. Each block of SOR_SCAN_BLOCK bytes is compared against all
+ * four at once with SIMD (two 32 byte compares with AVX2, four 16 byte ones
+ * with SSE2, or a byte at a time otherwise), giving a mask with a bit set for
+ * each of them. next() then pops the lowest bit, so the bytes in between are
+ * never looked at one by one. The last partial block is copied into a padded
+ * buffer, so nothing past the end is read.
+ */
+class SorScanner {
+private:
+    /** The end of the text scanned. */
+    const char *_end;
+    /** The start of the block the mask is for. */
+    const char *_block;
+    /** A bit for every structural character of the block not yet returned. */
+    uint64_t _mask;
+
+    /** Returns the mask of the structural characters of the 64 bytes at p. */
+    static inline uint64_t _classify(const char *p) {
+#if defined(__AVX2__)
+        uint64_t mask = 0;
+        for(size_t half = 0; half < 2; ++half) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + half * 32));
+            __m256i m = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('<')),
+                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('>'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+            mask |= uint64_t(uint32_t(_mm256_movemask_epi8(m))) << (half * 32);
+        }
+        return mask;
+#elif defined(__SSE2__)
+        uint64_t mask = 0;
+        for(size_t quarter = 0; quarter < 4; ++quarter) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + quarter * 16));
+            __m128i m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('<')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('>'))),
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                             _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+            mask |= uint64_t(uint32_t(_mm_movemask_epi8(m))) << (quarter * 16);
+        }
+        return mask;
+#else
+        uint64_t mask = 0;
+        for(size_t i = 0; i < SOR_SCAN_BLOCK; ++i) {
+            char c = p[i];
+            mask |= uint64_t(c == '<' || c == '>' || c == '"' || c == '\n') << i;
+        }
+        return mask;
+#endif
+    }
+
+    /** Returns the mask of the block at _block, which may be partial. */
+    inline uint64_t _classify_block() const {
+        size_t left = _end - _block;
+        if(left >= SOR_SCAN_BLOCK) return _classify(_block);
+        char padded[SOR_SCAN_BLOCK];
+        memset(padded, ' ', sizeof(padded));
+        memcpy(padded, _block, left);
+        return _classify(padded);
+    }
+
+public:
+    /** Constructs a scanner over the text in [begin, end). */
+    SorScanner(const char *begin, const char *end)
+        : _end(end), _block(begin), _mask(0) {
+        if(_block < _end) _mask = this->_classify_block();
+    }
+
+    /** Returns the position of the next '<', '>', '"' or '\n', or the end of
+     * the text if there are none left. */
+    inline const char *next() {
+        while(_mask == 0) {
+            if(_end - _block <= SOR_SCAN_BLOCK) return _end;
+            _block += SOR_SCAN_BLOCK;
+            _mask = this->_classify_block();
+        }
+        const char *pos = _block + __builtin_ctzll(_mask);
+        _mask &= _mask - 1;
+        return pos;
+    }
+
+    /** Returns the end of the text. */
+    inline const char *end() const {
+        return _end;
+    }
+};
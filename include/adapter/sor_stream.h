@@ -0,0 +1,102 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <condition_variable>
+
+#include "data/dataframe.h"
+#include "util/mapped_file.h"
+
+/** The number of lines of a file parsed into each row group. */
+#define SOR_GROUP_ROWS      (size_t(1) << 16)
+/** The number of finished row groups a stream holds before it stops parsing
+ * until one is taken. */
+#define SOR_STREAM_PENDING  4
+
+/****************************************************************************
+ * SorStream::
+ *
+ * Reads a SoR file as a sequence of row groups, so that they can be used
+ * while the rest of the file is still being parsed. The schema is inferred
+ * from the start of the file as SorReader does, so every group has the same
+ * one. A thread of its own then parses the file SOR_GROUP_ROWS lines at a
+ * time, each group split between threads by SorReader, and publishes each
+ * group as soon as it is finished: it is queued for next() and its rows are
+ * added to the committed row watermark.
+ * The stream only holds the groups that have not been taken yet, and stops
+ * parsing while it holds the most it may, so the memory it uses is bounded by
+ * the size of a few groups however large the file is. The pages of the file
+ * behind the parser are dropped once parsed.
+ */
+class SorStream {
+private:
+    /** The file being parsed. */
+    std::shared_ptr<MappedFile> _file;
+    /** The schema of every group. */
+    std::unique_ptr<Schema> _schema;
+    /** The most lines parsed into a group. */
+    size_t _group_rows;
+    /** The most finished groups held at once, or 0 for no limit. */
+    size_t _max_pending;
+
+    /** Protects everything below it. mutable so that it can be locked in
+     * const methods. */
+    mutable std::mutex _mutex;
+    /** Signalled when a group is published or taken, and when parsing stops. */
+    std::condition_variable _cv;
+    /** The finished groups not yet taken, in file order. */
+    std::deque<std::shared_ptr<DataFrame>> _pending;
+    /** The number of groups published. */
+    size_t _groups;
+    /** The number of rows in the groups published, the committed row watermark. */
+    size_t _rows;
+    /** Whether the whole file has been parsed. */
+    bool _done;
+    /** Whether the stream is being destroyed, which stops the parser. */
+    bool _closing;
+    /** The thread parsing the file. */
+    std::thread _parser;
+
+    SorStream(std::shared_ptr<MappedFile> file, size_t group_rows, size_t max_pending);
+
+    /** Parses the file group by group, publishing each. Runs on _parser. */
+    void _parse();
+
+    /** Queues the group and adds its rows to the watermark, waiting for room
+     * first. Returns false if the stream is closing. */
+    bool _publish(std::shared_ptr<DataFrame> group);
+
+public:
+    SorStream(const SorStream&) = delete;
+    SorStream& operator=(const SorStream&) = delete;
+
+    /** Stops parsing and waits for the parser to exit. */
+    ~SorStream();
+
+    /** Opens the SoR file at the given path and starts parsing it into groups
+     * of at most group_rows lines, holding at most max_pending finished groups
+     * at once (0 for no limit). Returns nullptr if the file cannot be mapped. */
+    static std::shared_ptr<SorStream> open(const std::string& path,
+                                           size_t group_rows = SOR_GROUP_ROWS,
+                                           size_t max_pending = SOR_STREAM_PENDING);
+
+    /** The schema of every group. */
+    const Schema& get_schema() const;
+
+    /** Takes the next group in file order, waiting for it to be parsed.
+     * Returns nullptr once every group has been taken. */
+    std::shared_ptr<DataFrame> next();
+
+    /** The number of rows in the groups published so far. */
+    size_t committed_rows() const;
+
+    /** The number of groups published so far. */
+    size_t committed_groups() const;
+
+    /** Whether the whole file has been parsed. Groups may still be waiting
+     * to be taken. */
+    bool done() const;
+};
@@ -1,13 +1,32 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include "data/dataframe.h"
+#include "adapter/sor_reader.h"
 
-/** Namespace which wraps the other group's Sorer implemntation in
- * a function which creates the DataFrame object used by our project. */
+/** Appended to the path of a parsed file to give the path of its cache. */
+#define SOR_CACHE_SUFFIX    ".ltgtcache"
+
+/** Namespace which reads SoR files into the DataFrame object used by our
+ * project, with SorReader, and caches them. It used to wrap the other group's
+ * Sorer implementation, hence its name. */
 namespace SorerDataframeAdapter {
-    /** Parses a file in SOR format using the other group's Sorer implementation
-     * into our dataframe object. */
-    std::shared_ptr<DataFrame> parse_file(const std::string& filename);
+    /** Parses a file in SOR format into our dataframe object with SorReader.
+     * If compute_stats is true, the statistics of every column are computed
+     * once the file is read. If the file is parsed and report is given, it is
+     * filled in with the throughput of the parse.
+     * The parsed dataframe is saved to a binary cache next to the file (see
+     * cache_path), keyed by the path, size, modification time and a hash of
+     * the contents of the file. Later calls map the cache instead of parsing
+     * as long as the key still matches, unless force_parse is true, in which
+     * case the file is parsed and the cache rewritten. If the cache cannot be
+     * written, the file is parsed every time. */
+    std::shared_ptr<DataFrame> parse_file(const std::string& filename, bool compute_stats = false,
+                                          bool force_parse = false,
+                                          SorReader::Report *report = nullptr);
+
+    /** Returns the path of the cache parse_file keeps for the given file. */
+    std::string cache_path(const std::string& filename);
 }
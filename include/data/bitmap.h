@@ -0,0 +1,198 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "util/serializable.h"
+
+/** The largest number of values a container stores as a sorted array. Above it,
+ * a bitset of 65536 bits (8KB) is smaller. */
+#define BITMAP_ARRAY_MAX    4096
+
+/****************************************************************************
+ * Bitmap::
+ *
+ * A compressed set of unsigned 32 bit integers, eg. row indices, in the style
+ * of a Roaring bitmap. Values are split by their upper 16 bits into containers,
+ * each holding the lower 16 bits of its values either as a sorted array, when
+ * it has at most BITMAP_ARRAY_MAX values, or as a bitset otherwise. Sparse sets
+ * cost 2 bytes per value and dense sets 1 bit per possible value, and AND, OR
+ * and AND NOT work a container at a time, on whole 64 bit words for bitsets.
+ */
+class Bitmap : public Serializable {
+private:
+    friend class Serializable;
+
+    /** The values sharing the same upper 16 bits. */
+    struct Container {
+        /** The upper 16 bits of every value in the container. */
+        uint16_t key = 0;
+        /** The number of values in the container. */
+        size_t cardinality = 0;
+        /** The lower 16 bits of the values, sorted, if this is an array container. */
+        std::vector<uint16_t> array;
+        /** 1024 words with a bit set for each value, if this is a bitset container. */
+        std::vector<uint64_t> words;
+
+        bool is_bitset() const;
+
+        bool contains(uint16_t low) const;
+
+        /** Adds the value, returning false if it was already present. */
+        bool add(uint16_t low);
+
+        /** Removes the value, returning false if it was not present. */
+        bool remove(uint16_t low);
+
+        /** Switches to a bitset if there are more than BITMAP_ARRAY_MAX values,
+         * or to an array otherwise. */
+        void normalize();
+
+        bool operator==(const Container& other) const;
+    };
+
+    /** The containers, sorted by key. Empty containers are never kept. */
+    std::vector<Container> _containers;
+
+    /** Returns the container with the given key, or nullptr. */
+    const Container *_find(uint16_t key) const;
+
+    /** Returns the container with the given key, inserting an empty one if it
+     * does not exist. */
+    Container& _find_or_insert(uint16_t key);
+
+    static Container _and(const Container& a, const Container& b);
+    static Container _or(const Container& a, const Container& b);
+    static Container _and_not(const Container& a, const Container& b);
+
+public:
+    Bitmap() = default;
+    Bitmap(const Bitmap&) = default;
+    Bitmap(Bitmap&&) = default;
+    Bitmap& operator=(const Bitmap&) = default;
+    Bitmap& operator=(Bitmap&&) = default;
+
+    /** Returns a bitmap holding every value in [start, end). */
+    static Bitmap range(uint32_t start, uint32_t end);
+
+    /** Adds a value. Adding values in increasing order is fastest. */
+    void add(uint32_t val);
+
+    /** Removes a value, returning false if it was not present. */
+    bool remove(uint32_t val);
+
+    /** Returns true if the value is in the set. */
+    bool contains(uint32_t val) const;
+
+    /** The number of values in the set, from the count kept by each container. */
+    size_t cardinality() const;
+
+    /** Returns true if the set has no values. */
+    bool empty() const;
+
+    /** The smallest and largest values in the set, which must not be empty. */
+    uint32_t min() const;
+    uint32_t max() const;
+
+    /** Returns the values in both sets. */
+    Bitmap operator&(const Bitmap& other) const;
+
+    /** Returns the values in either set. */
+    Bitmap operator|(const Bitmap& other) const;
+
+    /** Returns the values in this set but not the other. */
+    Bitmap and_not(const Bitmap& other) const;
+
+    /** Returns the values in [0, universe) which are not in this set. */
+    Bitmap negate(uint32_t universe) const;
+
+    /** Calls f(uint32_t) for every value in increasing order. */
+    template< typename F >
+    void for_each(F&& f) const {
+        for(size_t c = 0; c < _containers.size(); ++c) {
+            const Container& con = _containers[c];
+            uint32_t high = uint32_t(con.key) << 16;
+            if(con.is_bitset()) {
+                for(size_t w = 0; w < con.words.size(); ++w) {
+                    uint64_t word = con.words[w];
+                    while(word) {
+                        f(high | uint32_t(w * 64 + __builtin_ctzll(word)));
+                        word &= word - 1;
+                    }
+                }
+            } else {
+                for(size_t i = 0; i < con.array.size(); ++i) {
+                    f(high | con.array[i]);
+                }
+            }
+        }
+    }
+
+    /** Returns every value in increasing order. */
+    std::vector<uint32_t> to_vector() const;
+
+    bool operator==(const Bitmap& other) const;
+
+    bool equals(const Object *other) const override;
+
+    size_t hash() const override;
+
+    std::shared_ptr<Object> clone() const override;
+
+    /** Serializes the containers, arrays as 2 bytes per value and bitsets as
+     * 8KB of words. */
+    std::vector<uint8_t> serialize() const override;
+
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
+};
+
+/** Specialization of deserialize_from for Bitmap. Bitmaps are fetched from
+ * other nodes, so the container count is checked against the bytes remaining
+ * before room is made for the containers, and the keys must be strictly
+ * increasing and each cardinality right, as _find, min() and max() rely on
+ * them. Throws a ShortSerializedDataException otherwise. */
+template<>
+inline Bitmap Serializable::deserialize_from<Bitmap>(ByteReader& r) {
+    Bitmap bm;
+    size_t cnt = r.read_size();
+    // every container takes at least its key and its cardinality
+    size_t min_bytes = sizeof(uint16_t) + (r.encoding() == Encoding::FIXED ? sizeof(size_t) : 1);
+    if(cnt > r.remaining() / min_bytes) throw ShortSerializedDataException();
+    bm._containers.resize(cnt);
+    for(size_t c = 0; c < cnt; ++c) {
+        Bitmap::Container& con = bm._containers[c];
+        con.key = r.read<uint16_t>();
+        con.cardinality = r.read_size();
+        if((c > 0 && con.key <= bm._containers[c - 1].key)
+                || con.cardinality == 0 || con.cardinality > 65536) {
+            throw ShortSerializedDataException();
+        }
+        if(con.cardinality <= BITMAP_ARRAY_MAX) {
+            size_t bytes = con.cardinality * sizeof(uint16_t);
+            const uint8_t *in = r.read_bytes(bytes);
+            con.array.resize(con.cardinality);
+            memcpy(con.array.data(), in, bytes);
+            for(size_t i = 1; i < con.array.size(); ++i) {
+                if(con.array[i] <= con.array[i - 1]) throw ShortSerializedDataException();
+            }
+        } else {
+            size_t bytes = 1024 * sizeof(uint64_t);
+            const uint8_t *in = r.read_bytes(bytes);
+            con.words.resize(1024);
+            memcpy(con.words.data(), in, bytes);
+            size_t bits = 0;
+            for(size_t w = 0; w < con.words.size(); ++w) bits += __builtin_popcountll(con.words[w]);
+            if(bits != con.cardinality) throw ShortSerializedDataException();
+        }
+    }
+    return bm;
+}
+
+/** Specialization of deserialize for Bitmap. */
+template<>
+inline Bitmap Serializable::deserialize<Bitmap>(const std::vector<uint8_t>& data, size_t& pos) {
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<Bitmap>(r);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <variant>
+
+#include "util/object.h"
+#include "data/column.h"
+#include "data/bitmap.h"
+
+/** The default largest number of distinct values a column can have to be
+ * indexed with a BitmapIndex. */
+#define INDEX_MAX_VALUES    1024
+
+/****************************************************************************
+ * EqualsPredicate::
+ *
+ * A test that the value in one column is equal to a given value. A list of
+ * them given to DataFrame::select, count or filter selects the rows matching
+ * every one of them.
+ */
+class EqualsPredicate : public Object {
+public:
+    /** The types of value that can be compared. */
+    using Value = std::variant<int, bool, std::string>;
+
+private:
+    /** The column the value is compared against. */
+    size_t _col;
+    /** The value the column must be equal to. */
+    Value _value;
+
+public:
+    /** Constructs a test against an int, bool or string column. */
+    EqualsPredicate(size_t col, int value);
+    EqualsPredicate(size_t col, bool value);
+    EqualsPredicate(size_t col, std::string value);
+    EqualsPredicate(size_t col, const char *value);
+
+    /** Returns the column the value is compared against. */
+    size_t col() const;
+
+    /** Returns the value the column must be equal to. */
+    const Value& value() const;
+
+    size_t hash() const override;
+
+    bool equals(const Object *other) const override;
+
+    std::shared_ptr<Object> clone() const override;
+};
+
+/****************************************************************************
+ * BitmapIndex::
+ *
+ * An index over a bool, int or string column with few distinct values. It holds
+ * one compressed Bitmap of row indices per distinct value, plus one of the rows
+ * where the value is missing. Equality tests are answered by looking up the
+ * bitmap of the value, and combined by AND, OR and NOT on the bitmaps, without
+ * reading the column.
+ *
+ * The index describes the column when it was built. The dataframe drops it when
+ * the column changes.
+ */
+class BitmapIndex : public Object {
+private:
+    /** The type of the column. */
+    char _type;
+    /** The number of rows indexed. */
+    size_t _rows;
+    /** The rows holding each distinct value. */
+    std::map<EqualsPredicate::Value, Bitmap> _values;
+    /** The rows where the value is missing. */
+    Bitmap _missing;
+    /** Returned for values which are not in the column. */
+    Bitmap _empty;
+
+    BitmapIndex(char type, size_t rows);
+
+public:
+    /** Builds the index of the given column. Returns nullptr if the column is a
+     * float column, or has more than max_values distinct values. */
+    static std::shared_ptr<BitmapIndex> build(const Column& col, size_t max_values = INDEX_MAX_VALUES);
+
+    /** The type of the indexed column. */
+    char type() const;
+
+    /** The number of rows indexed. */
+    size_t rows() const;
+
+    /** The number of distinct non-missing values. */
+    size_t distinct() const;
+
+    /** Returns the rows equal to the given value, which is empty if no row is. */
+    const Bitmap& rows_equal(const EqualsPredicate::Value& value) const;
+
+    /** Returns the rows where the value is missing. */
+    const Bitmap& missing() const;
+
+    /** Returns the number of rows equal to the given value. */
+    size_t count(const EqualsPredicate::Value& value) const;
+
+    size_t hash() const override;
+
+    bool equals(const Object *other) const override;
+
+    std::shared_ptr<Object> clone() const override;
+};
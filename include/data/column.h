@@ -8,6 +8,7 @@
 
 #include "util/serializable.h"
 #include "data/nullable_array.h"
+#include "data/zone_map.h"
 
 // Forward Declarations for Column
 class IntColumn;
@@ -26,6 +27,10 @@ class Column : public Serializable {
 public:
     virtual ~Column();
 
+    /** Given a type ('I', 'S', 'B' or 'F'), returns a new empty column of that
+     * type, or nullptr if the type is unknown. */
+    static std::unique_ptr<Column> from_type(char type);
+
     /** Type converters: Return same column under its actual type, or
     *  nullptr if of the wrong type.  */
     virtual IntColumn* as_int();
@@ -45,6 +50,18 @@ public:
     /** Returns the number of elements in the column. */
     virtual size_t size() const = 0;
 
+    /** Makes room for at least the given number of elements, so that pushing
+     * that many does not reallocate. */
+    virtual void reserve(size_t n) = 0;
+
+    /** Releases the memory reserved beyond the elements in the column. */
+    virtual void shrink_to_fit() = 0;
+
+    /** Moves every element of the given column onto the end of this column,
+     * leaving the other column empty. The other column must be of the same
+     * type, otherwise it is undefined behavior. */
+    virtual void append(Column&& other) = 0;
+
     /** Return the type of this column as a char: 'S', 'B', 'I' and 'F'. */
     virtual char get_type() const = 0;
 
@@ -58,8 +75,17 @@ public:
  */
 class IntColumn : public Column {
 private:
+    friend class Serializable;
+    friend class FrameFile;
+
     /** Internal data structure holding the data */
     NullableArray<int> _data;
+    /** The min, max and null count of every block of ZONE_ROWS values. */
+    ZoneMap<int> _zones;
+
+    /** Constructs the column from deserialized data and zone maps. If the zone
+     * map does not cover the data, it is rebuilt. */
+    IntColumn(NullableArray<int>&& data, ZoneMap<int>&& zones);
 
 public:
     IntColumn() = default;
@@ -79,12 +105,30 @@ public:
     /** Get this as an integer column. */
     IntColumn* as_int() override;
 
+    /** Returns a read-only reference to the nullable array backing this column.
+     * Used for typed access that skips the virtual type converters. */
+    const NullableArray<int>& get_array() const;
+
+    /** Returns the zone map of this column, used to skip blocks of rows which
+     * cannot match a range. */
+    const ZoneMap<int>& get_zones() const;
+
     /** Set value at idx. An out of bound idx is undefined.  */
     std::optional<int> set(size_t idx, std::optional<int> val);
 
     /** Returns the number of elements in the column. */
     size_t size() const override;
 
+    /** Reserves room in the data and the zone map. */
+    void reserve(size_t n) override;
+
+    /** Releases the slack of the data and the zone map. */
+    void shrink_to_fit() override;
+
+    /** Moves every element of the given column onto the end of this column.
+     * The other column must also be a IntColumn. */
+    void append(Column&& other) override;
+
     /** Gets the type of the column. Returns 'I' */
     char get_type() const override;
 
@@ -99,20 +143,28 @@ public:
 
     /** Serializes the current column into a byte representation. */
     std::vector<uint8_t> serialize() const override;
+
+    /** Writes the data followed by the zone map. */
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
 };
 
 /** Specialization of deserialize for IntColumn
  *
  * Converts from the serialized form of this column to an object containing 
  * the data */
+template<>
+inline IntColumn Serializable::deserialize_from<IntColumn>(ByteReader& r) {
+    auto na = NullableArray<int>::read_from(r);
+    auto zones = ZoneMap<int>::read_from(r);
+    return IntColumn(std::move(na), std::move(zones));
+}
+
 template<>
 inline IntColumn Serializable::deserialize<IntColumn>(const std::vector<uint8_t>& data, size_t& pos) {
-    auto na = NullableArray<int>::deserialize(data, pos);
-    IntColumn ic;
-    for(size_t i = 0; i < na.size(); ++i){
-        ic.push_back(na.get(i));
-    }
-    return ic;
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<IntColumn>(r);
 }
  
 /*************************************************************************
@@ -121,8 +173,17 @@ inline IntColumn Serializable::deserialize<IntColumn>(const std::vector<uint8_t>
  */
 class FloatColumn : public Column {
 private:
+    friend class Serializable;
+    friend class FrameFile;
+
     /** Internal data structure holding the data */
     NullableArray<double> _data;
+    /** The min, max and null count of every block of ZONE_ROWS values. */
+    ZoneMap<double> _zones;
+
+    /** Constructs the column from deserialized data and zone maps. If the zone
+     * map does not cover the data, it is rebuilt. */
+    FloatColumn(NullableArray<double>&& data, ZoneMap<double>&& zones);
 
 public:
     FloatColumn() = default;
@@ -142,12 +203,30 @@ public:
     /** Get this as an float column. */
     FloatColumn* as_float() override;
 
+    /** Returns a read-only reference to the nullable array backing this column.
+     * Used for typed access that skips the virtual type converters. */
+    const NullableArray<double>& get_array() const;
+
+    /** Returns the zone map of this column, used to skip blocks of rows which
+     * cannot match a range. */
+    const ZoneMap<double>& get_zones() const;
+
     /** Set value at idx. An out of bound idx is undefined.  */
     std::optional<double> set(size_t idx, std::optional<double> val);
 
     /** Returns the number of elements in the column. */
     size_t size() const override;
 
+    /** Reserves room in the data and the zone map. */
+    void reserve(size_t n) override;
+
+    /** Releases the slack of the data and the zone map. */
+    void shrink_to_fit() override;
+
+    /** Moves every element of the given column onto the end of this column.
+     * The other column must also be a FloatColumn. */
+    void append(Column&& other) override;
+
     /** Gets the type of the column. Returns 'F' */
     char get_type() const override;
 
@@ -162,20 +241,28 @@ public:
 
     /** Serializes the current column into a byte representation. */
     std::vector<uint8_t> serialize() const override;
+
+    /** Writes the data followed by the zone map. */
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
 };
 
 /** Specialization of deserialize for FloatColumn
  *
  * Converts from the serialized form of this column to an object containing 
  * the data */
+template<>
+inline FloatColumn Serializable::deserialize_from<FloatColumn>(ByteReader& r) {
+    auto na = NullableArray<double>::read_from(r);
+    auto zones = ZoneMap<double>::read_from(r);
+    return FloatColumn(std::move(na), std::move(zones));
+}
+
 template<>
 inline FloatColumn Serializable::deserialize<FloatColumn>(const std::vector<uint8_t>& data, size_t& pos) {
-    auto na = NullableArray<double>::deserialize(data, pos);
-    FloatColumn fc;
-    for(size_t i = 0; i < na.size(); ++i){
-        fc.push_back(na.get(i));
-    }
-    return fc;
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<FloatColumn>(r);
 }
 
 /*************************************************************************
@@ -184,8 +271,17 @@ inline FloatColumn Serializable::deserialize<FloatColumn>(const std::vector<uint
  */
 class BoolColumn : public Column {
 private:
+    friend class Serializable;
+    friend class FrameFile;
+
     /** Internal data structure holding the data */
     NullableArray<bool> _data;
+    /** The min, max and null count of every block of ZONE_ROWS values. */
+    ZoneMap<bool> _zones;
+
+    /** Constructs the column from deserialized data and zone maps. If the zone
+     * map does not cover the data, it is rebuilt. */
+    BoolColumn(NullableArray<bool>&& data, ZoneMap<bool>&& zones);
 
 public:
     BoolColumn() = default;
@@ -205,12 +301,30 @@ public:
     /** Get this as an boolean column. */
     BoolColumn* as_bool() override;
 
+    /** Returns a read-only reference to the nullable array backing this column.
+     * Used for typed access that skips the virtual type converters. */
+    const NullableArray<bool>& get_array() const;
+
+    /** Returns the zone map of this column, used to skip blocks of rows which
+     * cannot match a range. */
+    const ZoneMap<bool>& get_zones() const;
+
     /** Set value at idx. An out of bound idx is undefined.  */
     std::optional<bool> set(size_t idx, std::optional<bool> val);
 
     /** Returns the number of elements in the column. */
     size_t size() const override;
 
+    /** Reserves room in the data and the zone map. */
+    void reserve(size_t n) override;
+
+    /** Releases the slack of the data and the zone map. */
+    void shrink_to_fit() override;
+
+    /** Moves every element of the given column onto the end of this column.
+     * The other column must also be a BoolColumn. */
+    void append(Column&& other) override;
+
     /** Gets the type of the column. Returns 'B' */
     char get_type() const override;
 
@@ -225,20 +339,28 @@ public:
 
     /** Serializes the current column into a byte representation. */
     std::vector<uint8_t> serialize() const override;
+
+    /** Writes the data followed by the zone map. */
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
 };
 
 /** Specialization of deserialize for BoolColumn
  *
  * Converts from the serialized form of this column to an object containing 
  * the data */
+template<>
+inline BoolColumn Serializable::deserialize_from<BoolColumn>(ByteReader& r) {
+    auto na = NullableArray<bool>::read_from(r);
+    auto zones = ZoneMap<bool>::read_from(r);
+    return BoolColumn(std::move(na), std::move(zones));
+}
+
 template<>
 inline BoolColumn Serializable::deserialize<BoolColumn>(const std::vector<uint8_t>& data, size_t& pos) {
-    auto na = NullableArray<bool>::deserialize(data, pos);
-    BoolColumn bc;
-    for(size_t i = 0; i < na.size(); ++i){
-        bc.push_back(na.get(i));
-    }
-    return bc;
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<BoolColumn>(r);
 }
  
 /*************************************************************************
@@ -248,8 +370,17 @@ inline BoolColumn Serializable::deserialize<BoolColumn>(const std::vector<uint8_
  */
 class StringColumn : public Column {
 private:
+    friend class Serializable;
+    friend class FrameFile;
+
     /** Internal data structure holding the data */
     NullableArray<std::string> _data;
+    /** The min, max and null count of every block of ZONE_ROWS values. */
+    ZoneMap<std::string> _zones;
+
+    /** Constructs the column from deserialized data and zone maps. If the zone
+     * map does not cover the data, it is rebuilt. */
+    StringColumn(NullableArray<std::string>&& data, ZoneMap<std::string>&& zones);
 
 public:
     StringColumn() = default;
@@ -269,12 +400,30 @@ public:
     /** Get this as an string column. */
     StringColumn* as_string() override;
 
+    /** Returns a read-only reference to the nullable array backing this column.
+     * Used for typed access that skips the virtual type converters. */
+    const NullableArray<std::string>& get_array() const;
+
+    /** Returns the zone map of this column, used to skip blocks of rows which
+     * cannot match a range. */
+    const ZoneMap<std::string>& get_zones() const;
+
     /** Set value at idx. An out of bound idx is undefined.  */
     std::optional<std::string> set(size_t idx, std::optional<std::string> val);
 
     /** Returns the number of elements in the column. */
     size_t size() const override;
 
+    /** Reserves room in the data and the zone map. */
+    void reserve(size_t n) override;
+
+    /** Releases the slack of the data and the zone map. */
+    void shrink_to_fit() override;
+
+    /** Moves every element of the given column onto the end of this column.
+     * The other column must also be a StringColumn. */
+    void append(Column&& other) override;
+
     /** Gets the type of the column. Returns 'S' */
     char get_type() const override;
 
@@ -289,18 +438,26 @@ public:
 
     /** Serializes the current column into a byte representation. */
     std::vector<uint8_t> serialize() const override;
+
+    /** Writes the data followed by the zone map. */
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
 };
 
 /** Specialization of deserialize for StringColumn
  *
  * Converts from the serialized form of this column to an object containing 
  * the data */
+template<>
+inline StringColumn Serializable::deserialize_from<StringColumn>(ByteReader& r) {
+    auto na = NullableArray<std::string>::read_from(r);
+    auto zones = ZoneMap<std::string>::read_from(r);
+    return StringColumn(std::move(na), std::move(zones));
+}
+
 template<>
 inline StringColumn Serializable::deserialize<StringColumn>(const std::vector<uint8_t>& data, size_t& pos) {
-    auto na = NullableArray<std::string>::deserialize(data, pos);
-    StringColumn sc;
-    for(size_t i = 0; i < na.size(); ++i){
-        sc.push_back(na.get(i));
-    }
-    return sc;
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<StringColumn>(r);
 }
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "util/serializable.h"
+#include "data/column.h"
+
+/** The default number of buckets in the histogram of a ColumnStats. */
+#define STATS_BUCKETS    16
+
+/****************************************************************************
+ * ColumnStats::
+ *
+ * Summary statistics of a single column: the number of rows and missing
+ * values, an estimate of the number of distinct values, an equi-depth histogram
+ * of numeric columns, and the average length of string columns. They are cheap
+ * to keep and to send, and let operators pre-size hash tables and estimate how
+ * many rows a range will select before scanning.
+ *
+ * The statistics describe the column at the time they were computed, they are
+ * not updated when the column changes.
+ */
+class ColumnStats : public Serializable {
+private:
+    friend class Serializable;
+
+    /** The type of the column. */
+    char _type;
+    /** The number of rows in the column. */
+    size_t _rows;
+    /** The number of missing values. */
+    size_t _null_count;
+    /** The estimated number of distinct non-missing values. */
+    size_t _distinct;
+    /** The average length of the non-missing strings, 0 for other types. */
+    double _avg_length;
+    /** The bucket boundaries of the equi-depth histogram, each bucket holding
+     * about the same number of values. Empty for string columns. */
+    std::vector<double> _bounds;
+
+    ColumnStats(char type);
+
+public:
+    /** Computes the statistics of the given column with a single scan, using a
+     * HyperLogLog for the distinct count and a QuantileSketch for the histogram. */
+    static std::shared_ptr<ColumnStats> compute(const Column& col, size_t buckets = STATS_BUCKETS);
+
+    /** The type of the column. */
+    char type() const;
+
+    /** The number of rows in the column when the statistics were computed. */
+    size_t rows() const;
+
+    /** The number of missing values. */
+    size_t null_count() const;
+
+    /** The estimated number of distinct non-missing values. */
+    size_t distinct() const;
+
+    /** The average length of the non-missing strings, 0 for other types. */
+    double avg_length() const;
+
+    /** The bucket boundaries of the equi-depth histogram, from the smallest
+     * to the largest value. Empty for string columns or columns with no values. */
+    const std::vector<double>& histogram() const;
+
+    /** Estimates the fraction of non-missing values in [lo, hi] from the
+     * histogram, assuming values are spread evenly within a bucket. Returns 1
+     * if there is no histogram. */
+    double selectivity(double lo, double hi) const;
+
+    size_t hash() const override;
+
+    bool equals(const Object *other) const override;
+
+    std::shared_ptr<Object> clone() const override;
+
+    std::vector<uint8_t> serialize() const override;
+
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
+};
+
+/** Specialization of deserialize_from for ColumnStats. */
+template<>
+inline ColumnStats Serializable::deserialize_from<ColumnStats>(ByteReader& r) {
+    ColumnStats stats(r.read<char>());
+    stats._rows = r.read_size();
+    stats._null_count = r.read_size();
+    stats._distinct = r.read_size();
+    stats._avg_length = r.read<double>();
+    size_t bound_cnt = r.read_size();
+    for(size_t i = 0; i < bound_cnt; ++i) {
+        stats._bounds.push_back(r.read<double>());
+    }
+    return stats;
+}
+
+/** Specialization of deserialize for ColumnStats. */
+template<>
+inline ColumnStats Serializable::deserialize<ColumnStats>(const std::vector<uint8_t>& data, size_t& pos) {
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<ColumnStats>(r);
+}
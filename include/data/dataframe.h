@@ -3,16 +3,20 @@
 #include <memory>
 #include <string>
 #include <thread>
+#include <future>
 #include <optional>
 
 #include "util/serializable.h"
+#include "util/parallel.h"
+#include "util/codec.h"
 #include "data/schema.h"
 #include "data/rower.h"
 #include "data/fielder.h"
 #include "data/column.h"
 #include "data/kvstore.h"
+#include "data/range_predicate.h"
+#include "data/bitmap_index.h"
 
-#define MAX_THREADS    8
 #define THREAD_ROWS    5000
 
 
@@ -25,66 +29,83 @@
  */
 class DataFrame : public Serializable {
 private:
+    friend class Serializable;
+
     /** Stores a schema representing the both the number and types of the columns
      * internally, and the names of the rows and columns */
     std::unique_ptr<Schema> _schema;
     /* A list of columns which store the data */
     std::vector<std::unique_ptr<Column>> _columns;
+    /** The bitmap index of each column, null if the column is not indexed. */
+    std::vector<std::shared_ptr<const BitmapIndex>> _indexes;
 
     /* Given a type (I, S, B, or F), returns a new column from that type. 
      * Used as a helper method when constructing or adding columns */
     std::unique_ptr<Column> _get_col_from_type(char type) const;
 
     /** This method is used to execute a map in parallel. The row_start
-     * is the starting row for the rower in this thread, the row_end is
-     * the non-inclusive end row for the rower in this thread. This method
+     * is the starting row for the rowers in this thread, the row_end is
+     * the non-inclusive end row for the rowers in this thread. Each row is
+     * filled once and given to every rower in order. This method
      * should be passed to a thread as the method it is executing.
      *
      * If the rower is mutating shared objects or data, it must 
      * do that in a thread safe manner internally, or reults are
      * undefined behavior.
      */
-    void _pmap_helper(size_t row_start, size_t row_end, Rower& rower) const;
-
-    /* Helper Rower to print the dataframe */
-    class PrintRower : public Rower {
-    private:
-        /* Helper Fielder to print the dataframe */
-        class PrintFielder : public Fielder {
-        public:
-            /** Called for fields of the argument's type with the value of the field. */
-            void accept(std::optional<bool> b) override;
-
-            void accept(std::optional<double> f) override;
-
-            void accept(std::optional<int> i) override;
-
-            void accept(std::optional<std::string> s) override;
-
-            /** Called when all fields have been seen. */
-            void done() override;
-
-            size_t hash() const override;
-
-            bool equals(const Object *other) const override;
-
-            std::shared_ptr<Object> clone() const override;
-        };
-
-        PrintFielder pf;
-    public:
-        PrintRower() = default;
-
-        bool accept(Row& r) override;
-
-        void join(std::shared_ptr<Rower> other) override;
-
-        size_t hash() const override;
-
-        bool equals(const Object *other) const override;
-        
-        std::shared_ptr<Object> clone() const override;
-    };
+    void _pmap_helper(size_t row_start, size_t row_end, const std::vector<Rower*>& rowers,
+                      const RangePredicate *pred) const;
+
+    /** Returns the first row at or after the given one, and before row_end,
+     * whose block might contain values in the range of the predicate. Returns
+     * row_end if there is none. If the predicate is null, returns the row. */
+    size_t _skip_zones(size_t row, size_t row_end, const RangePredicate *pred) const;
+
+    /** Implementation of filter. Blocks of rows are skipped if pred is not null
+     * and the zone map proves they are out of its range. */
+    std::shared_ptr<DataFrame> _filter(Rower& r, const RangePredicate *pred) const;
+
+    /** Returns the rows whose value matches the predicate by reading the
+     * column. If candidates is not null, only those rows are read. */
+    Bitmap _scan_equal(const EqualsPredicate& pred, const Bitmap *candidates) const;
+
+    /** Drops the bitmap index of the given column, after it has changed. */
+    void _drop_index(size_t col);
+
+    /** Returns true if whole columns should be serialized, hashed and compared
+     * on their own threads: the frame is large, and either has a column for
+     * every thread or columns too short to be split into chunks. Otherwise each
+     * column splits its work between the threads itself. */
+    bool _fan_out_columns() const;
+
+    /** Reads a column of the given type (I, S, B, or F). */
+    static std::unique_ptr<Column> _read_column(char type, ByteReader& r);
+
+    /** Writes each column in the COMPACT encoding as a block: the id of the
+     * codec Codec::choose picks for it, its length, the length of the block and
+     * the block. The columns are compressed in parallel. */
+    void _serialize_compressed_columns(ByteWriter& w) const;
+
+    /** Reads the columns written by _serialize_compressed_columns, decompressing
+     * and deserializing them in parallel. */
+    static std::vector<std::unique_ptr<Column>> _read_compressed_columns(const Schema& schema,
+                                                                         ByteReader& r);
+
+    /** Returns the indices of the k rows with the largest values in the given
+     * array, largest first. Rows are split between threads the same way as pmap,
+     * each thread keeps its own bounded heap, and the heaps are merged at the end. */
+    template< typename T >
+    std::vector<size_t> _top_k_rows(const NullableArray<T>& arr, size_t k) const;
+
+    /** This method is used by pmap to merge the clones of an associative rower
+     * as a pairwise tree, on the worker threads. Once the given worker has
+     * finished its rows, it joins the rower of the worker one stride after it,
+     * for strides of 1, 2, 4, ... until its own index is not a multiple of twice
+     * the stride. It then fulfills its promise, letting the worker that joins it
+     * continue. Worker 0 is the original rower and ends up with the result. */
+    static void _pmap_tree_join(size_t worker, Rower& rower,
+                                std::vector<std::shared_ptr<Rower>>& rower_clones,
+                                std::vector<std::promise<void>>& merged);
 
 public:
     /** Given an array of integers, constructs a single-column dataframe from it,
@@ -125,6 +146,10 @@ public:
     * empty. */
     DataFrame(std::unique_ptr<Schema> schema);
 
+    /** Create a data frame from a schema and already filled columns. The
+    * columns must match the types of the schema and all have the same length. */
+    DataFrame(std::unique_ptr<Schema> schema, std::vector<std::unique_ptr<Column>> columns);
+
     /** Default move constructor. */
     DataFrame(DataFrame&& other) = default;
 
@@ -139,6 +164,19 @@ public:
     * name is optional and external. A nullptr colum is undefined. */
     void add_column(std::unique_ptr<Column> col, std::optional<std::string> name = std::nullopt);
 
+    /** Returns a read-only reference to the column at the given index. An
+     * index out of bounds is undefined. */
+    const Column& get_column(size_t col) const;
+
+    /** Computes the statistics of every column and stores them in the schema,
+     * replacing any computed before. Columns are scanned in parallel. */
+    void compute_stats();
+
+    /** Returns the statistics of the given column, or nullptr if they have not
+     * been computed. They describe the column as it was when compute_stats was
+     * called, which can be checked against nrows(). */
+    std::shared_ptr<const ColumnStats> get_stats(size_t col) const;
+
     /** Return the value at the given column and row. Accessing rows or
     *  columns out of bounds, or request the wrong type is undefined.*/
     std::optional<int> get_int(size_t col, size_t row) const;
@@ -180,20 +218,111 @@ public:
     /** The number of rows in the dataframe. */
     size_t nrows() const;
 
+    /** Makes room for at least the given number of rows in every column and
+     * in the schema, so that adding that many does not reallocate. */
+    void reserve(size_t rows);
+
+    /** Releases the memory reserved beyond the rows of the dataframe, once
+     * no more are going to be added. */
+    void shrink_to_fit();
+
     /** The number of columns in the dataframe.*/
     size_t ncols() const;
 
     /** Visit rows in order */
     void map(Rower& r) const;
 
+    /** Visit rows in order, skipping every block of rows that the zone map of
+     * the predicate's column proves has no value in its range. */
+    void map(Rower& r, const RangePredicate& pred) const;
+
     /** This method clones the Rower and executes the map in parallel. Join is
-      * used at the end to merge the results. */
+      * used at the end to merge the results, in parallel if the Rower's join
+      * is associative. */
     void pmap(Rower& r) const;
 
+    /** Executes the map in parallel, skipping every block of rows that the
+     * zone map of the predicate's column proves has no value in its range. */
+    void pmap(Rower& r, const RangePredicate& pred) const;
+
+    /** Visit rows in order, filling each row once and giving it to every
+     * rower in the list, in list order. The rowers must not modify the row.
+     * If a predicate is given, blocks of rows outside its range are skipped. */
+    void map_many(const std::vector<Rower*>& rowers, const RangePredicate *pred = nullptr) const;
+
+    /** Executes several independent rowers in parallel over a single scan of
+     * the dataframe. Each row is filled once and given to every rower, so the
+     * data is only read once no matter how many rowers there are. Each rower is
+     * cloned and joined exactly as pmap would. The rowers must not modify the row.
+     * If a predicate is given, blocks of rows outside its range are skipped. */
+    void pmap_many(const std::vector<Rower*>& rowers, const RangePredicate *pred = nullptr) const;
+
     /** Create a new dataframe, constructed from rows for which the given Rower
     * returned true from its accept method. */
     std::shared_ptr<DataFrame> filter(Rower& r) const;
 
+    /** Create a new dataframe from the rows the Rower accepts, without visiting
+     * the blocks of rows that the zone map of the predicate's column proves have
+     * no value in its range. */
+    std::shared_ptr<DataFrame> filter(Rower& r, const RangePredicate& pred) const;
+
+    /** Create a new dataframe containing the k rows with the largest values
+    * in the given column, largest first, with ties in row order. Missing values
+    * and NaNs are never selected. Each thread keeps a bounded heap of at most k
+    * rows, so the column is never sorted. */
+    std::shared_ptr<DataFrame> top_k(size_t col, size_t k) const;
+
+    /** Builds a bitmap index of the given bool, int or string column, which
+     * select, count and filter then use instead of reading the column. Returns
+     * false if the column is a float column or has more than max_values distinct
+     * values. Changing the column drops its index. */
+    bool build_index(size_t col, size_t max_values = INDEX_MAX_VALUES);
+
+    /** Returns the bitmap index of the given column, or nullptr if it has none. */
+    std::shared_ptr<const BitmapIndex> get_index(size_t col) const;
+
+    /** Returns the indices of the rows matching every predicate. Indexed
+     * columns are answered by AND-ing their bitmaps, and only the rows left are
+     * read for columns without an index. */
+    Bitmap select(const std::vector<EqualsPredicate>& preds) const;
+
+    /** Returns the number of rows matching every predicate. */
+    size_t count(const std::vector<EqualsPredicate>& preds) const;
+
+    /** Create a new dataframe from the rows matching every predicate. */
+    std::shared_ptr<DataFrame> filter(const std::vector<EqualsPredicate>& preds) const;
+
+    /** Returns the compression ratio and throughput of every codec on the
+     * COMPACT bytes of each column, one report per column and codec, in order. */
+    std::vector<Codec::Report> codec_report() const;
+
+    /** Writes the dataframe to a binary columnar file at the given path, see
+     * FrameFile. Returns false if it cannot be written. */
+    bool save(const std::string& path) const;
+
+    /** Reads a dataframe written by save, or only the given columns of it.
+     * Returns nullptr if the file cannot be read. */
+    static std::shared_ptr<DataFrame> load(const std::string& path,
+                                           const std::vector<size_t>& cols = {});
+
+    /** Maps a file written by save into memory, returning a dataframe of all
+     * of its columns, or the given ones, that reads them where they lie in the
+     * file and pages them in as they are touched. Changing the dataframe copies
+     * the changed columns into memory; the file is never written. Returns
+     * nullptr if the file cannot be mapped. See FrameFile::open_mmap. */
+    static std::shared_ptr<DataFrame> open_mmap(const std::string& path,
+                                                const std::vector<size_t>& cols = {});
+
+    /** Writes every row to the file descriptor in SoR format, formatting
+     * chunks of rows in parallel. Returns false if the write fails. See
+     * FrameWriter::write_sor. */
+    bool write_sor(int fd) const;
+
+    /** Writes every row to the file descriptor in CSV format, formatting
+     * chunks of rows in parallel. Returns false if the write fails. See
+     * FrameWriter::write_csv. */
+    bool write_csv(int fd) const;
+
     /** Print the dataframe in SoR format to standard output. */
     void print() const;
 
@@ -210,38 +339,45 @@ public:
     /** Overload the equality operator. Tests for equality. */
     bool operator==(const DataFrame& other) const;
 
-    /** Serialize the dataframe into byte format. Drops row and column names. */
+    /** Serialize the dataframe into byte format, followed by the statistics of
+     * the columns that have them. Drops row and column names. */
     std::vector<uint8_t> serialize() const override;
+
+    /** Writes the schema, the columns and the statistics in place, into a
+     * writer which can be sized with serialized_size(). */
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
 };
 
-/** Specialization of deserialize for DataFrames. 
+/** Specialization of deserialize_from for DataFrames. 
  * 
- * Converts the serialized version of a datframe into an object with the approriate
- * data. All row and column names are dropped. */
+ * Converts the serialized version of a datframe, in the reader's encoding, into
+ * an object with the approriate data. All row and column names are dropped,
+ * column statistics are kept. */
 template<>
-inline DataFrame Serializable::deserialize<DataFrame>(const std::vector<uint8_t>& data, size_t& pos) {
-    Schema schema = Serializable::deserialize<Schema>(data, pos);
-    size_t col_cnt = Serializable::deserialize<size_t>(data, pos);
-    assert(col_cnt == schema.width());
-    DataFrame df;
+inline DataFrame Serializable::deserialize_from<DataFrame>(ByteReader& r) {
+    auto schema = std::make_unique<Schema>(r.read<Schema>());
+    size_t col_cnt = r.read_size();
+    assert(col_cnt == schema->width());
+    std::vector<std::unique_ptr<Column>> columns;
+    if(r.encoding() == Encoding::COMPRESSED) {
+        columns = DataFrame::_read_compressed_columns(*schema, r);
+    } else {
+        for(size_t i = 0; i < col_cnt; ++i){
+            columns.push_back(DataFrame::_read_column(schema->col_type(i), r));
+        }
+    }
     for(size_t i = 0; i < col_cnt; ++i){
-        std::unique_ptr<Column> col = nullptr;
-        switch(schema.col_type(i)){
-            case 'I':
-                col = std::make_unique<IntColumn>(Serializable::deserialize<IntColumn>(data, pos));
-                break;
-            case 'F':
-                col = std::make_unique<FloatColumn>(Serializable::deserialize<FloatColumn>(data, pos));
-                break;
-            case 'B':
-                col = std::make_unique<BoolColumn>(Serializable::deserialize<BoolColumn>(data, pos));
-                break;
-            case 'S':
-                col = std::make_unique<StringColumn>(Serializable::deserialize<StringColumn>(data, pos));
-                break;
+        if(r.read<bool>()) {
+            schema->set_col_stats(i, std::make_shared<ColumnStats>(r.read<ColumnStats>()));
         }
-        assert(col);
-        df.add_column(std::move(col));
     }
-    return df;
+    return DataFrame(std::move(schema), std::move(columns));
+}
+
+template<>
+inline DataFrame Serializable::deserialize<DataFrame>(const std::vector<uint8_t>& data, size_t& pos) {
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<DataFrame>(r);
 }
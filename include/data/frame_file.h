@@ -0,0 +1,131 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "util/mapped_file.h"
+#include "data/dataframe.h"
+
+/** The first bytes of every frame file. */
+#define FRAME_FILE_MAGIC     "LTGTCOLS"
+/** The version of the layout written, bumped whenever it changes. */
+#define FRAME_FILE_VERSION   1
+/** Every section starts at a multiple of this many bytes. */
+#define FRAME_FILE_ALIGN     64
+
+/****************************************************************************
+ * FrameFile::
+ *
+ * Saves and loads dataframes in a binary columnar file. The file starts with a
+ * header holding the magic, version, alignment, row and column counts, followed
+ * by an entry for each column with its type and the offset and length of each
+ * of its sections:
+ *  - validity: the bitmap of existing values, packed 8 to a byte.
+ *  - values: every value, including the missing ones, as an array of ints or
+ *    doubles, as packed bits for booleans, or as the bytes of every string one
+ *    after another.
+ *  - offsets: for strings, the offset of each string in the values section,
+ *    and the end of the last one.
+ *  - meta: the zone map of the column, the metadata of each chunk of ZONE_ROWS
+ *    values, followed by the column statistics if the column had them.
+ * Every section is aligned to FRAME_FILE_ALIGN bytes, so that fixed width values
+ * can be read straight into the column's storage, and can be mapped in place
+ * with open_mmap.
+ * Values are stored in the native byte order.
+ */
+class FrameFile {
+public:
+    /** The position and length of a section of the file, in bytes. */
+    struct Section {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    /** The entry of a column in the header. */
+    struct ColumnEntry {
+        /** The type of the column (I, S, B, or F). */
+        char type;
+        /** 1 if the meta section ends with the column statistics. */
+        uint8_t has_stats;
+        uint8_t padding[6];
+        Section validity;
+        Section values;
+        Section offsets;
+        Section meta;
+    };
+
+    /** The fixed part of the header, followed by one ColumnEntry per column. */
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t alignment;
+        uint64_t nrows;
+        uint64_t ncols;
+    };
+
+    /** Writes the dataframe to the file at the given path, replacing it, and
+     * then the trailer bytes, where readers of the frame do not look. The frame
+     * is written to a temporary file beside the path and renamed over it, so
+     * the file is replaced whole: a dataframe mapped from the old file, even
+     * the one being saved, keeps reading it. Returns false if the file cannot
+     * be written, leaving the old one. */
+    static bool save(const DataFrame& df, const std::string& path,
+                     const void *trailer = nullptr, size_t trailer_len = 0);
+
+    /** Reads the given columns, in that order, of the dataframe in the file at
+     * the given path, or every column if none are given. Columns are read in
+     * parallel, each straight into its storage. Returns nullptr if the file
+     * cannot be read, or is not a frame file of this version. */
+    static std::shared_ptr<DataFrame> load(const std::string& path,
+                                           const std::vector<size_t>& cols = {});
+
+    /** Maps the file at the given path into memory and returns a dataframe of
+     * the given columns, or every column, reading their bitmaps, values and
+     * strings where they lie in the mapping. Only the header and the meta
+     * sections are read up front; the rest is paged in as it is touched, and
+     * the pages are shared with every other process mapping the file. The
+     * file must not change while the dataframe or a copy of its columns is
+     * alive. The dataframe never writes to the file: changing a column copies
+     * it into memory first. Returns nullptr if the file cannot be mapped, or is
+     * not a frame file of this version. */
+    static std::shared_ptr<DataFrame> open_mmap(const std::string& path,
+                                                const std::vector<size_t>& cols = {});
+
+private:
+    /** Returns whether the header is that of a frame file of this version
+     * whose column entries fit in a file of the given size. */
+    static bool _check_header(const Header& header, uint64_t file_size);
+
+    /** Returns whether the sections of a column are aligned, lie within a file
+     * of the given size, and have the lengths its type and row count give. */
+    static bool _check_entry(const ColumnEntry& entry, uint64_t nrows, uint64_t file_size);
+
+    /** Sets selected to the given columns, or every column if none are given,
+     * and types to their types. Returns false if any of them does not exist or
+     * fails _check_entry. */
+    static bool _select(const Header& header, const std::vector<ColumnEntry>& entries,
+                        uint64_t file_size, const std::vector<size_t>& cols,
+                        std::vector<size_t>& selected, std::string& types);
+
+    /** Returns the sections of each column of the dataframe, laid out one
+     * after another from the given offset. */
+    static std::vector<ColumnEntry> _layout(const DataFrame& df, uint64_t offset,
+                                            std::vector<std::vector<uint8_t>>& metas);
+
+    /** Writes the sections of a column to the file at their offsets. */
+    static bool _write_column(int fd, const Column& col, const ColumnEntry& entry,
+                              const std::vector<uint8_t>& meta);
+
+    /** Reads a column from the file. Returns nullptr if its sections are
+     * inconsistent with the row count. */
+    static std::unique_ptr<Column> _read_column(int fd, const ColumnEntry& entry, size_t nrows,
+                                                std::shared_ptr<ColumnStats>& stats);
+
+    /** Returns a column reading its sections in the mapped file, which it
+     * keeps mapped. Returns nullptr if its meta section cannot be parsed. */
+    static std::unique_ptr<Column> _map_column(const std::shared_ptr<const MappedFile>& file,
+                                               const ColumnEntry& entry, size_t nrows,
+                                               std::shared_ptr<ColumnStats>& stats);
+};
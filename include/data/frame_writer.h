@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include "data/dataframe.h"
+
+/****************************************************************************
+ * FrameWriter::
+ *
+ * Writes dataframes out as text, in SoR or CSV format. The rows are split into
+ * chunks of PARALLEL_CHUNK_ROWS, and each worker formats its chunks into a
+ * buffer of its own, numbers with std::to_chars. The buffers are then written
+ * to the file descriptor in row order with a single write each, a wave of
+ * MAX_THREADS chunks at a time, so at most that many are held in memory.
+ * Doubles are written in their shortest exact form, with a ".0" added when
+ * that looks like an int, so that reading them back gives the same values and
+ * types. Booleans are written as 1 or 0.
+ */
+class FrameWriter {
+public:
+    /** Writes every row as a line of SoR: each field in angle brackets, with
+     * strings quoted and missing values empty, eg. <1><"a b"><>. Strings holding
+     * quotes or newlines cannot be read back. Returns false if the write fails. */
+    static bool write_sor(const DataFrame& df, int fd);
+
+    /** Writes every row as a line of CSV, the fields separated by commas and
+     * missing values empty. Strings are quoted when they are empty or hold a
+     * comma, quote or newline, with their quotes doubled. Returns false if the
+     * write fails. */
+    static bool write_csv(const DataFrame& df, int fd);
+
+private:
+    /** The text formats rows can be written in. */
+    enum class Format {
+        SOR,
+        CSV
+    };
+
+    /** Formats and writes every row in the given format. */
+    static bool _write(const DataFrame& df, int fd, Format format);
+
+    /** Appends the rows [start, end) to the buffer in the given format. */
+    static void _format_rows(const DataFrame& df, size_t start, size_t end, Format format,
+                             std::string& out);
+};
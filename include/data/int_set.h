@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "util/serializable.h"
+#include "data/bitmap.h"
+#include "data/dataframe.h"
+#include "data/kvstore.h"
+
+/****************************************************************************
+ * IntSet::
+ *
+ * A compressed set of ints, eg. user or project ids, stored as a Bitmap. Each
+ * int is mapped to an unsigned key by flipping its sign bit, so that keys keep
+ * the order of the ints. Dense runs of ids cost 1 bit each and sparse ids 2
+ * bytes each, both in memory and serialized, and union and intersection work a
+ * container at a time.
+ */
+class IntSet : public Serializable {
+private:
+    friend class Serializable;
+
+    /** The keys of the ints in the set. */
+    Bitmap _bits;
+
+    /** Maps an int to its key and back. */
+    static uint32_t _key(int v);
+    static int _value(uint32_t k);
+
+    IntSet(Bitmap&& bits);
+
+public:
+    /** Constructs an empty set. */
+    IntSet();
+
+    /** Builds the set of ints in the given int column of the dataframe.
+     * Missing values are skipped. */
+    static std::shared_ptr<IntSet> from_frame(const DataFrame& df, size_t col = 0);
+
+    /** Adds an int. Adding ints in increasing order is fastest. */
+    void add(int v);
+
+    /** Removes an int, returning false if it was not present. */
+    bool remove(int v);
+
+    /** Returns true if the int is in the set. Safe to call from several threads
+     * as long as the set is not changed. */
+    bool contains(int v) const;
+
+    /** The number of ints in the set. */
+    size_t size() const;
+
+    /** Returns true if the set has no ints. */
+    bool empty() const;
+
+    /** The smallest and largest ints in the set, which must not be empty. */
+    int min() const;
+    int max() const;
+
+    /** Returns the ints in both sets. */
+    IntSet operator&(const IntSet& other) const;
+
+    /** Returns the ints in either set. */
+    IntSet operator|(const IntSet& other) const;
+
+    /** Adds every int in the other set to this one. */
+    IntSet& operator|=(const IntSet& other);
+
+    /** Returns the ints in this set but not the other. */
+    IntSet and_not(const IntSet& other) const;
+
+    /** Calls f(int) for every int in increasing order. */
+    template< typename F >
+    void for_each(F&& f) const {
+        _bits.for_each([&f](uint32_t k){ f(_value(k)); });
+    }
+
+    /** Returns every int in increasing order. */
+    std::vector<int> to_vector() const;
+
+    bool equals(const Object *other) const override;
+
+    size_t hash() const override;
+
+    std::shared_ptr<Object> clone() const override;
+
+    std::vector<uint8_t> serialize() const override;
+
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
+};
+
+/** Specialization of deserialize_from for IntSet. */
+template<>
+inline IntSet Serializable::deserialize_from<IntSet>(ByteReader& r) {
+    return IntSet(Serializable::deserialize_from<Bitmap>(r));
+}
+
+/** Specialization of deserialize for IntSet. */
+template<>
+inline IntSet Serializable::deserialize<IntSet>(const std::vector<uint8_t>& data, size_t& pos) {
+    return IntSet(Serializable::deserialize<Bitmap>(data, pos));
+}
+
+/** Stores the serialized set in the KVStore as a dataframe with a single
+ * string, so that other nodes can fetch it without the duplicates a column of
+ * ids would carry. */
+void put_int_set(KVStore::Key k, const IntSet& set);
+
+/** Fetches a set stored with put_int_set, waiting for it if it does not exist
+ * yet. */
+std::shared_ptr<IntSet> get_int_set(const KVStore::Key& k);
@@ -2,31 +2,300 @@
 
 #include <optional>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string_view>
 #include <functional>
+#include <iterator>
 
 #include "util/serializable.h"
+#include "util/parallel.h"
+
+/** The number of values in each chunk an array is split into to be serialized,
+ * hashed and compared in parallel. A multiple of 64, so that every chunk of a
+ * bitmap starts on a word. */
+#define PARALLEL_CHUNK_ROWS  (size_t(1) << 16)
+
+/** Bits packed 8 to a byte, the first one in the lowest bit of the first byte,
+ * as ByteWriter::pack_bits writes them, read where they lie. Indexes like a
+ * std::vector<bool>. */
+struct PackedBits {
+    /** The packed bits. */
+    const uint8_t *bytes;
+    /** The number of bits. */
+    size_t count;
+
+    inline bool operator[](size_t i) const {
+        return (bytes[i >> 3] >> (i & 7)) & 1;
+    }
+
+    inline size_t size() const {
+        return count;
+    }
+};
 
 /** A template class representing an array with the possibility of having missing
  * values. To acheive this is uses a bitmap to represent whether the value exists
  * or not, and a vector to actually store the data. The downside of this approach
  * is that the two internal arrays have bad locality, resulting in more cache
  * misses. Another note is the bitmap (Vector<bool>) does not work with
- * other STL algorithms. */
+ * other STL algorithms.
+ * An array can instead be mapped from a file (see FrameFile::open_mmap), its
+ * bitmap and values read where they lie in the mapped memory. Such an array is
+ * read-only as far as the file goes: changing it first copies it into vectors. */
 template < class T >
 class NullableArray : public Serializable {
 private:
+    /** The values of an array mapped from a file, read where they lie: an
+     * array of T, packed bits for booleans, or for strings the bytes of every
+     * string one after another and the offset of each. Indexes like the
+     * std::vector<T> it stands in for, giving string_views for strings. */
+    struct MappedValues {
+        const uint8_t *bytes;
+        /** For strings, count + 1 offsets into bytes. */
+        const uint64_t *offsets;
+        /** The number of values. */
+        size_t count;
+        /** The number of bytes at bytes. */
+        size_t length;
+
+        inline auto operator[](size_t i) const {
+            if constexpr (std::is_same_v<bool, T>){
+                return bool((bytes[i >> 3] >> (i & 7)) & 1);
+            } else if constexpr (std::is_same_v<std::string, T>){
+                // clamped, so that corrupt offsets cannot read outside the file
+                size_t start = std::min<uint64_t>(offsets[i], length);
+                size_t end = std::min<uint64_t>(std::max(offsets[i + 1], uint64_t(start)), length);
+                return std::string_view(reinterpret_cast<const char *>(bytes) + start, end - start);
+            } else {
+                static_assert(std::is_fundamental_v<T>, "Only fundamental types and strings can be mapped!");
+                return reinterpret_cast<const T *>(bytes)[i];
+            }
+        }
+
+        inline size_t size() const {
+            return count;
+        }
+    };
+
+    /** The storage of an array mapped from a file, shared by its copies. */
+    struct Mapping {
+        /** Keeps the mapped memory alive. */
+        std::shared_ptr<const void> owner;
+        PackedBits bits;
+        MappedValues values;
+        /** Copies of the bitmap and values, made the first time data() or
+         * bitmap() is called. */
+        std::once_flag copied;
+        /** Set once the copies are filled. */
+        std::atomic<bool> filled{false};
+        std::vector<bool> bitmap;
+        std::vector<T> data;
+    };
+
     /** Store boolean values representing whether the value at that index exists
      * if true in a space efficient manner. */
     std::vector<bool> _bitmap;
     /** Store the actual data. Missing values are simply default initialized,
      * using them as non-missing values is undefined behavior. */
     std::vector<T> _data;
+    /** The storage in the file, if the array is mapped from one, in which case
+     * the vectors are empty. */
+    std::shared_ptr<Mapping> _mapping;
+
+    /** Calls f(bitmap, data) with the bitmap and values of the array: its
+     * vectors, or the PackedBits and MappedValues of a mapped array, which
+     * index the same way. */
+    template< typename F >
+    inline decltype(auto) _visit(F&& f) const {
+        if(_mapping) return f(_mapping->bits, _mapping->values);
+        return f(_bitmap, _data);
+    }
+
+    /** Returns the fixed width values, mapped or not. */
+    inline const T *_values() const {
+        if(_mapping) return reinterpret_cast<const T *>(_mapping->values.bytes);
+        return _data.data();
+    }
+
+    /** Fills the copies of the bitmap and values of a mapped array, once. */
+    inline void _copy_mapping() const {
+        Mapping *m = _mapping.get();
+        std::call_once(m->copied, [m](){
+            size_t count = m->values.count;
+            m->bitmap.resize(count);
+            ByteReader::unpack_bits(m->bits.bytes, 0, count, m->bitmap);
+            if constexpr (std::is_same_v<bool, T>){
+                m->data.resize(count);
+                ByteReader::unpack_bits(m->values.bytes, 0, count, m->data);
+            } else if constexpr (std::is_same_v<std::string, T>){
+                m->data.resize(count);
+                for(size_t i = 0; i < count; ++i) m->data[i] = m->values[i];
+            } else {
+                m->data.assign(reinterpret_cast<const T *>(m->values.bytes),
+                               reinterpret_cast<const T *>(m->values.bytes) + count);
+            }
+            m->filled = true;
+        });
+    }
+
+    /** Copies a mapped array into its own vectors, so that it can be changed. */
+    inline void _unmap() {
+        if(!_mapping) return;
+        this->_copy_mapping();
+        _bitmap = _mapping->bitmap;
+        _data = _mapping->data;
+        _mapping.reset();
+    }
+
+    /** Whether the values can be delta encoded in the compact encoding: the
+     * difference of any two fits in an int64_t. */
+    static constexpr bool _delta_encodable = std::is_integral_v<T> && std::is_signed_v<T>
+                                            && sizeof(T) <= sizeof(int32_t);
+
+    /** Returns the number of bytes the existing values take delta encoded,
+     * each a zigzag varint of its difference from the one before. */
+    inline size_t _delta_size() const {
+        return _visit([](auto& bitmap, auto& data){
+            size_t size = 0;
+            int64_t prev = 0;
+            for(size_t i = 0; i < data.size(); ++i){
+                if(!bitmap[i]) continue;
+                size += ByteWriter::varint_size(ByteWriter::zigzag(int64_t(data[i]) - prev));
+                prev = data[i];
+            }
+            return size;
+        });
+    }
+
+    /** Returns the number of chunks of PARALLEL_CHUNK_ROWS values. */
+    inline size_t _chunk_count() const {
+        return (this->size() + PARALLEL_CHUNK_ROWS - 1) / PARALLEL_CHUNK_ROWS;
+    }
 
-    /** Private constructor used for serialization to simplify the logic. */
-    NullableArray(std::vector<bool> bitmap, std::vector<T> data){
-        assert(bitmap.size() == data.size());
-        _bitmap = bitmap;
-        _data = data;
+    /** Returns the index after the last value of the given chunk. */
+    inline size_t _chunk_end(size_t chunk) const {
+        return std::min(this->size(), (chunk + 1) * PARALLEL_CHUNK_ROWS);
+    }
+
+    /** Returns the number of values which exist in [start, end). */
+    inline size_t _count_existing(size_t start, size_t end) const {
+        return _visit([start, end](auto& bitmap, auto&){
+            size_t cnt = 0;
+            for(size_t i = start; i < end; ++i) cnt += bitmap[i];
+            return cnt;
+        });
+    }
+
+    /** Returns the number of values which exist. */
+    inline size_t _count_existing() const {
+        return _count_existing(0, this->size());
+    }
+
+    /** Calls f(start, end) for every maximal run [start, end) of existing
+     * values in [from, to), in order. */
+    template< typename F >
+    inline void _for_each_run(size_t from, size_t to, F&& f) const {
+        _visit([from, to, &f](auto& bitmap, auto&){
+            size_t i = from;
+            while(i < to){
+                if(!bitmap[i]){
+                    ++i;
+                    continue;
+                }
+                size_t end = i + 1;
+                while(end < to && bitmap[end]) ++end;
+                f(i, end);
+                i = end;
+            }
+        });
+    }
+
+    /** Writes the bits as ByteWriter::write_bits does, packing a chunk of
+     * them on each thread. */
+    static inline void _write_bits(ByteWriter& w, const std::vector<bool>& vb) {
+        w.write_size(vb.size());
+        uint8_t *out = w.extend((vb.size() + 7) / 8);
+        parallel_for((vb.size() + PARALLEL_CHUNK_ROWS - 1) / PARALLEL_CHUNK_ROWS,
+                     [&vb, out](size_t c){
+            size_t start = c * PARALLEL_CHUNK_ROWS;
+            size_t end = std::min(vb.size(), start + PARALLEL_CHUNK_ROWS);
+            ByteWriter::pack_bits(vb, start, end, out + start / 8);
+        });
+    }
+
+    /** Writes mapped bits as ByteWriter::write_bits does: they are already
+     * packed, so they are copied, clearing the unused bits of the last byte. */
+    static inline void _write_bits(ByteWriter& w, const PackedBits& bits) {
+        w.write_size(bits.count);
+        size_t len = (bits.count + 7) / 8;
+        uint8_t *out = w.extend(len);
+        memcpy(out, bits.bytes, len);
+        if(bits.count % 8) out[len - 1] &= uint8_t((1u << (bits.count % 8)) - 1);
+    }
+
+    static inline void _write_bits(ByteWriter& w, const MappedValues& values) {
+        _write_bits(w, PackedBits{values.bytes, values.count});
+    }
+
+    /** Writes the existing fixed width values, each chunk copied by its own
+     * thread to the offset given by the number of values existing before it. */
+    inline void _write_fixed_width(ByteWriter& w) const {
+        size_t chunks = this->_chunk_count();
+        std::vector<size_t> offsets(chunks + 1, 0);
+        parallel_for(chunks, [this, &offsets](size_t c){
+            offsets[c + 1] = this->_count_existing(c * PARALLEL_CHUNK_ROWS, this->_chunk_end(c));
+        });
+        for(size_t c = 0; c < chunks; ++c) offsets[c + 1] += offsets[c];
+
+        uint8_t *out = w.extend(offsets[chunks] * sizeof(T));
+        const T *values = this->_values();
+        parallel_for(chunks, [this, out, values, &offsets](size_t c){
+            uint8_t *o = out + offsets[c] * sizeof(T);
+            this->_for_each_run(c * PARALLEL_CHUNK_ROWS, this->_chunk_end(c),
+                                [values, &o](size_t run_start, size_t run_end){
+                size_t bytes = (run_end - run_start) * sizeof(T);
+                memcpy(o, values + run_start, bytes);
+                o += bytes;
+            });
+        });
+    }
+
+    /** Tests the data of both arrays for equality, a chunk on each thread. */
+    inline bool _data_equals(const NullableArray<T>& other) const {
+        if constexpr (std::is_same_v<bool, T>){
+            return _data == other._data;
+        } else {
+            if(_data.size() != other._data.size()) return false;
+            std::vector<char> equal(this->_chunk_count(), true);
+            parallel_for(equal.size(), [this, &other, &equal](size_t c){
+                size_t start = c * PARALLEL_CHUNK_ROWS;
+                equal[c] = std::equal(_data.begin() + start, _data.begin() + this->_chunk_end(c),
+                                      other._data.begin() + start);
+            });
+            return std::all_of(equal.begin(), equal.end(), [](char e){ return e; });
+        }
+    }
+
+    /** Tests the bitmaps and data of both arrays for equality, a chunk on each
+     * thread, where either of them is mapped. */
+    inline bool _mapped_equals(const NullableArray<T>& other) const {
+        if(this->size() != other.size()) return false;
+        std::vector<char> equal(this->_chunk_count(), true);
+        parallel_for(equal.size(), [this, &other, &equal](size_t c){
+            size_t start = c * PARALLEL_CHUNK_ROWS;
+            size_t end = this->_chunk_end(c);
+            equal[c] = _visit([&other, start, end](auto& bitmap, auto& data){
+                return other._visit([&bitmap, &data, start, end](auto& obitmap, auto& odata){
+                    for(size_t i = start; i < end; ++i){
+                        if(bitmap[i] != obitmap[i] || data[i] != odata[i]) return false;
+                    }
+                    return true;
+                });
+            });
+        });
+        return std::all_of(equal.begin(), equal.end(), [](char e){ return e; });
     }
 
 public:
@@ -34,14 +303,59 @@ public:
     NullableArray(const NullableArray<T>&) = default;
     NullableArray(NullableArray<T>&&) = default;
 
+    /** Constructs an array adopting the given bitmap and data, which must be
+     * the same length. */
+    NullableArray(std::vector<bool>&& bitmap, std::vector<T>&& data)
+        : _bitmap(std::move(bitmap)), _data(std::move(data)) {
+        assert(_bitmap.size() == _data.size());
+    }
+
+    /** Constructs an array of count values mapped from a file, reading its
+     * bitmap and values where they lie, as FrameFile lays them out: bits packed
+     * as ByteWriter::pack_bits does, then an aligned array of T, packed bits for
+     * booleans, or for strings length bytes of strings and count + 1 offsets
+     * into them. The owner keeps the memory mapped while any copy of the array
+     * reads it. */
+    static inline NullableArray<T> mapped(std::shared_ptr<const void> owner, size_t count,
+                                          const uint8_t *bits, const uint8_t *values,
+                                          size_t length, const uint64_t *offsets = nullptr){
+        NullableArray<T> arr;
+        arr._mapping = std::make_shared<Mapping>();
+        arr._mapping->owner = std::move(owner);
+        arr._mapping->bits = PackedBits{bits, count};
+        arr._mapping->values = MappedValues{values, offsets, count, length};
+        return arr;
+    }
+
+    /** Returns whether the array reads its values from a mapped file. */
+    inline bool is_mapped() const {
+        return _mapping != nullptr;
+    }
+
+    /** Returns whether a mapped array has been copied into memory, by data()
+     * or bitmap(). */
+    inline bool is_copied() const {
+        return _mapping && _mapping->filled;
+    }
+
+    /** Calls f(bitmap, data), where the bitmap and data index like the
+     * vectors returned by bitmap() and data(). For an array mapped from a file
+     * they read it where it lies instead of copying it, and strings are
+     * string_views, so f is a generic lambda. */
+    template< typename F >
+    inline decltype(auto) visit(F&& f) const {
+        return _visit(std::forward<F>(f));
+    }
+
     /** 
      * If the optional exists, puts the value on the back of the data
      * and marks it as existing in the bitmap. Otherwise, default constructs a value
      * on the back of the data and marks it as non-existient in the bitmap.
      */
     inline void push_back(std::optional<T> val){
+        this->_unmap();
         if(val){
-            _data.push_back(*val);
+            _data.push_back(std::move(*val));
             _bitmap.push_back(true);
         } else {
             _data.emplace_back();
@@ -49,10 +363,34 @@ public:
         }
     }
 
+    /** The type value() returns: a const reference for fixed width values, a
+     * bool for booleans, which are stored as bits, and a string_view for
+     * strings, which a mapped array does not store as std::strings. */
+    using const_reference = std::conditional_t<std::is_same_v<bool, T>, bool,
+                            std::conditional_t<std::is_same_v<std::string, T>, std::string_view,
+                                               const T&>>;
+
+    /** Returns the value at the given index without copying it, reading a
+     * mapped array where it lies. Missing values are default constructed, so
+     * exists() must be checked before using them. An invalid index is
+     * undefined behavior. */
+    inline const_reference value(size_t pos) const {
+        assert(pos < this->size());
+        if constexpr (std::is_same_v<bool, T> || std::is_same_v<std::string, T>){
+            return _mapping ? const_reference(_mapping->values[pos]) : const_reference(_data[pos]);
+        } else {
+            return this->_values()[pos];
+        }
+    }
+
     /** Returns the value at the given index if it exists as a non-null optional.
      * Otherwise returns a null optional. An invalid index is undefined behavior */
     inline std::optional<T> get(size_t pos) const {
-        assert(pos < _data.size());
+        assert(pos < this->size());
+        if(_mapping){
+            if(!_mapping->bits[pos]) return std::nullopt;
+            return std::optional<T>(T(_mapping->values[pos]));
+        }
         if(_bitmap[pos]){
             return std::optional<T>(_data[pos]);
         }
@@ -63,6 +401,7 @@ public:
      * records it as existing. Otherwise it sets it to a default constructed value,
      * and sets is as missing. */
     inline std::optional<T> set(size_t pos, std::optional<T> val){
+        this->_unmap();
         assert(pos < _data.size());
         std::optional<T> old = ((_bitmap[pos]) ? std::optional<T>(_data[pos]) : std::nullopt);
         if(val){
@@ -79,6 +418,7 @@ public:
      * If it exists a non-null optional is returned, otherwise a null optional
      * is returned. */
     inline std::optional<T> pop(size_t pos){
+        this->_unmap();
         assert(pos < _data.size());
         std::optional<T> val = std::nullopt;
         if(_bitmap[pos]){
@@ -89,36 +429,109 @@ public:
         return val;
     }
 
+    /** Moves every element of the given array onto the end of this array,
+     * leaving the other array empty. */
+    inline void append(NullableArray<T>&& other){
+        this->_unmap();
+        other._unmap();
+        if(_data.empty()){
+            _data = std::move(other._data);
+            _bitmap = std::move(other._bitmap);
+        } else {
+            _data.insert(_data.end(), std::make_move_iterator(other._data.begin()),
+                         std::make_move_iterator(other._data.end()));
+            _bitmap.insert(_bitmap.end(), other._bitmap.begin(), other._bitmap.end());
+        }
+        other._data.clear();
+        other._bitmap.clear();
+    }
+
+    /** Makes room for at least the given number of elements, so that pushing
+     * that many does not reallocate. Does nothing to a mapped array, which is
+     * copied whole when it is first changed. */
+    inline void reserve(size_t n){
+        if(_mapping) return;
+        _data.reserve(n);
+        _bitmap.reserve(n);
+    }
+
+    /** Releases the memory reserved beyond the elements in the array. */
+    inline void shrink_to_fit(){
+        if(_mapping) return;
+        _data.shrink_to_fit();
+        _bitmap.shrink_to_fit();
+    }
+
     /** Returns the total number of elements in the array, including missing
      * values. */
     inline size_t size() const {
-        return _data.size();
+        return _mapping ? _mapping->values.count : _data.size();
+    }
+
+    /** Returns true if the value at the given index exists, false if it is
+     * missing. An invalid index is undefined behavior. */
+    inline bool exists(size_t pos) const {
+        assert(pos < this->size());
+        return _mapping ? _mapping->bits[pos] : _bitmap[pos];
+    }
+
+    /** Returns a read-only reference to the underlying data. Missing values
+     * are default constructed, so the bitmap must be checked before using them.
+     * A mapped array is copied into memory the first time, see visit() instead. */
+    inline const std::vector<T>& data() const {
+        if(_mapping){
+            this->_copy_mapping();
+            return _mapping->data;
+        }
+        return _data;
+    }
+
+    /** Returns a read-only reference to the underlying bitmap. A mapped array
+     * is copied into memory the first time, see visit() instead. */
+    inline const std::vector<bool>& bitmap() const {
+        if(_mapping){
+            this->_copy_mapping();
+            return _mapping->bitmap;
+        }
+        return _bitmap;
     }
 
     /** Tests for equality */
     inline bool equals(const Object *other) const override {
         auto ona = dynamic_cast<const NullableArray<T> *>(other);
         if(ona) {
-            return _bitmap == ona->_bitmap && _data == ona->_data;
+            return *this == *ona;
         }
         return false;
     }
 
     /** Overload of the equality operator. Tests for equality. */
     inline bool operator==(const NullableArray<T>& other) const {
-        return _bitmap == other._bitmap && _data == other._data;
+        if(_mapping || other._mapping) return this->_mapped_equals(other);
+        return _bitmap == other._bitmap && this->_data_equals(other);
     }
 
-    /** Returns the hashcode of the array */
+    /** Returns the hashcode of the array. Each chunk is hashed on its own
+     * thread, and the hashes are combined in order. */
     inline size_t hash() const override {
-        size_t hash = _data.size();
-        for(size_t i = 0; i < _data.size(); ++i){
-            bool exists = _bitmap[i];
-            hash += exists;
-            if(exists){
-                hash ^= std::hash<T>()(_data[i]) ^ i;
-            }
-        }
+        std::vector<size_t> hashes(this->_chunk_count());
+        parallel_for(hashes.size(), [this, &hashes](size_t c){
+            hashes[c] = _visit([this, c](auto& bitmap, auto& data){
+                // std::hash of a string_view is that of the string it views
+                using V = std::decay_t<decltype(data[0])>;
+                size_t hash = c == 0 ? data.size() : 0;
+                for(size_t i = c * PARALLEL_CHUNK_ROWS; i < this->_chunk_end(c); ++i){
+                    bool exists = bitmap[i];
+                    hash += exists;
+                    if(exists){
+                        hash ^= std::hash<V>()(data[i]) ^ i;
+                    }
+                }
+                return hash;
+            });
+        });
+        size_t hash = hashes.empty() ? this->size() : hashes[0];
+        for(size_t c = 1; c < hashes.size(); ++c) hash = hash * 31 + hashes[c];
         return hash;
     }
 
@@ -127,51 +540,130 @@ public:
         return std::make_shared<NullableArray<T>>(*this);
     }
 
-    /** Serializes the data into byte form */
-    inline std::vector<uint8_t> serialize() const override {
-        // bitmap
-        std::vector<uint8_t> serialized = Serializable::serialize<std::vector<bool>>(_bitmap);
-        // data
-        std::vector<uint8_t> temp;
+    /** Returns the number of bytes serialize_into writes in the FIXED encoding,
+     * an upper bound on what it writes in COMPACT. */
+    inline size_t serialized_size() const override {
+        size_t size = ByteWriter::bits_size(this->size());
         if constexpr (std::is_same_v<bool, T>){
-            temp = Serializable::serialize<std::vector<bool>>(_data);
-            serialized.insert(serialized.end(), temp.begin(), temp.end());
+            size += ByteWriter::bits_size(this->size());
+        } else if constexpr (std::is_fundamental_v<T>){
+            size += _count_existing() * sizeof(T);
         } else {
-            for(size_t i = 0; i < _data.size(); ++i){
-                if(_bitmap[i]){ // only serialize existing values
-                    if constexpr (std::is_base_of_v<Serializable, T>){
-                        temp = _data[i].serialize();
-                    } else if constexpr (std::is_fundamental_v<T> 
-                                            || std::is_same_v<std::string, T>){
-                        temp = Serializable::serialize<T>(_data[i]);
+            _visit([&size](auto& bitmap, auto& data){
+                for(size_t i = 0; i < data.size(); ++i){
+                    if(bitmap[i]) size += ByteWriter::size_of(data[i]);
+                }
+            });
+        }
+        return size;
+    }
+
+    /** Writes the bitmap followed by the existing values. Fixed width values
+     * are copied a run of existing values at a time, so a column without
+     * missing values is a single memcpy. Long arrays are written a chunk per
+     * thread, each to its offset, giving the same bytes. In the compact
+     * encodings integers are preceded by a byte saying whether they are delta
+     * encoded, which they are when that is smaller, as it is for sorted or
+     * clustered ids. */
+    inline void serialize_into(ByteWriter& w) const override {
+        _visit([this, &w](auto& bitmap, auto& data){
+            // bitmap
+            _write_bits(w, bitmap);
+            // data
+            if constexpr (std::is_same_v<bool, T>){
+                _write_bits(w, data);
+            } else if constexpr (std::is_fundamental_v<T>){
+                if constexpr (_delta_encodable){
+                    if(w.encoding() != Encoding::FIXED){
+                        bool delta = _delta_size() < _count_existing() * sizeof(T);
+                        w.write<bool>(delta);
+                        if(delta){
+                            int64_t prev = 0;
+                            for(size_t i = 0; i < data.size(); ++i){
+                                if(!bitmap[i]) continue;
+                                w.write_varint(ByteWriter::zigzag(int64_t(data[i]) - prev));
+                                prev = data[i];
+                            }
+                            return;
+                        }
                     }
-                    serialized.insert(serialized.end(), temp.begin(), temp.end());
                 }
+                this->_write_fixed_width(w);
+            } else if(this->_chunk_count() <= 1){
+                for(size_t i = 0; i < data.size(); ++i){
+                    if(bitmap[i]) w.write(data[i]); // only serialize existing values
+                }
+            } else {
+                // each chunk is written to its own buffer, then they are copied in
+                std::vector<std::vector<uint8_t>> pieces(this->_chunk_count());
+                parallel_for(pieces.size(), [this, &w, &bitmap, &data, &pieces](size_t c){
+                    ByteWriter pw(pieces[c], w.encoding());
+                    for(size_t i = c * PARALLEL_CHUNK_ROWS; i < this->_chunk_end(c); ++i){
+                        if(bitmap[i]) pw.write(data[i]);
+                    }
+                });
+                w.write_pieces(pieces);
             }
-        }
+        });
+    }
 
-        return serialized;
+    /** Serializes the data into byte form */
+    inline std::vector<uint8_t> serialize() const override {
+        return this->_serialize_exact();
     }
 
-    /** Implementation of its own deserialize method. Due to C++ template rules,
-     * we cannot provide a specialization of Serializable::deserialize() that is
-     * generic over the inner type T for a NullableArray. Therefore we implement our
-     * own deserialize method. This is not ideal, but is the best solution we found. */
-    static inline NullableArray<T> deserialize(std::vector<uint8_t> data, size_t& pos){
-        std::vector<bool> bitmap = Serializable::deserialize<std::vector<bool>>(data, pos);
-        std::vector<T> arr_data;
+    /** Reads an array written by serialize_into in the reader's encoding. */
+    static inline NullableArray<T> read_from(ByteReader& r){
+        NullableArray<T> arr;
+        arr._bitmap = r.read_bits();
         if constexpr (std::is_same_v<bool, T>){
-            arr_data = Serializable::deserialize<std::vector<bool>>(data, pos);
+            arr._data = r.read_bits();
+            assert(arr._bitmap.size() == arr._data.size());
+        } else if constexpr (std::is_fundamental_v<T>){
+            arr._data.resize(arr._bitmap.size());
+            if constexpr (_delta_encodable){
+                if(r.encoding() != Encoding::FIXED && r.read<bool>()){
+                    int64_t prev = 0;
+                    for(size_t i = 0; i < arr._bitmap.size(); ++i){
+                        if(!arr._bitmap[i]) continue;
+                        prev += ByteReader::unzigzag(r.read_varint());
+                        arr._data[i] = T(prev);
+                    }
+                    return arr;
+                }
+            }
+            const uint8_t *in = r.read_bytes(arr._count_existing() * sizeof(T));
+            arr._for_each_run(0, arr._bitmap.size(), [&in, &arr](size_t run_start, size_t run_end){
+                size_t bytes = (run_end - run_start) * sizeof(T);
+                memcpy(arr._data.data() + run_start, in, bytes);
+                in += bytes;
+            });
+        } else if constexpr (std::is_same_v<std::string, T>){
+            // assign each string straight from the received bytes
+            arr._data.resize(arr._bitmap.size());
+            for(size_t i = 0; i < arr._bitmap.size(); ++i){
+                if(!arr._bitmap[i]) continue;
+                size_t len = r.read_size();
+                arr._data[i].assign(reinterpret_cast<const char *>(r.read_bytes(len)), len);
+            }
         } else {
-            for(size_t i = 0; i < bitmap.size(); ++i){
-                if(bitmap[i]){
-                    arr_data.push_back(Serializable::deserialize<T>(data, pos));
-                } else {
-                    arr_data.emplace_back();
+            arr._data.resize(arr._bitmap.size());
+            for(size_t i = 0; i < arr._bitmap.size(); ++i){
+                if(arr._bitmap[i]){
+                    arr._data[i] = r.read<T>();
                 }
             }
         }
-        return NullableArray(bitmap, arr_data);
+        return arr;
+    }
+
+    /** Implementation of its own deserialize method. Due to C++ template rules,
+     * we cannot provide a specialization of Serializable::deserialize() that is
+     * generic over the inner type T for a NullableArray. Therefore we implement our
+     * own deserialize method. This is not ideal, but is the best solution we found. */
+    static inline NullableArray<T> deserialize(const std::vector<uint8_t>& data, size_t& pos){
+        ByteReader r(data, pos);
+        return read_from(r);
     }
 };
 
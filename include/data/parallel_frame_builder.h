@@ -0,0 +1,101 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <optional>
+
+#include "util/object.h"
+#include "data/schema.h"
+#include "data/column.h"
+#include "data/row.h"
+
+// forward declaration to avoid circular dependancy
+class DataFrame;
+
+/****************************************************************************
+ * ParallelFrameBuilder::
+ *
+ * Builds a dataframe from rows emitted by several threads at once without
+ * locking. Every worker thread appends to its own segment of columns, and
+ * finish() splices the segments together in worker order into a single
+ * dataframe. Rowers that produce a dataframe during pmap share a builder
+ * between their clones, and pick their segment in Rower::start_worker().
+ */
+class ParallelFrameBuilder : public Object {
+public:
+    /** The private set of columns a single worker appends to. A segment must
+     * only ever be used by one thread at a time. */
+    class Segment {
+    private:
+        /** The columns of this segment, following the builder's schema. */
+        std::vector<std::unique_ptr<Column>> _columns;
+
+    public:
+        /** Creates an empty segment with one column per column of the schema. */
+        Segment(const Schema& schema);
+
+        /** Type appropriate push_back methods, which push the value onto the
+         * end of the given column. Pushing to a column of the wrong type is
+         * undefined. Every column must be pushed to the same number of times
+         * before the builder is finished. */
+        void push_back(size_t col, std::optional<int> val);
+        void push_back(size_t col, std::optional<double> val);
+        void push_back(size_t col, std::optional<bool> val);
+        void push_back(size_t col, std::optional<std::string> val);
+
+        /** Adds a row to the end of this segment. The row is expected to
+         * have the builder's schema. */
+        void add_row(const Row& row);
+
+        /** The number of rows in this segment. */
+        size_t nrows() const;
+
+        /** Makes room for at least the given number of rows in every column. */
+        void reserve(size_t rows);
+
+        friend class ParallelFrameBuilder;
+    };
+
+private:
+    /** The schema of the dataframe being built. */
+    Schema _schema;
+    /** One segment per worker. Segments are heap allocated so that references
+     * to them stay valid when the number of workers changes. */
+    std::vector<std::unique_ptr<Segment>> _segments;
+
+public:
+    /** Creates a builder for a dataframe with the given schema, starting
+     * with a single worker. */
+    ParallelFrameBuilder(const Schema& schema);
+
+    /** Ensures there is a segment for at least the given number of workers.
+     * Existing segments are kept. This must not be called while workers are
+     * appending. */
+    void set_workers(size_t worker_cnt);
+
+    /** The number of workers this builder has segments for. */
+    size_t workers() const;
+
+    /** Returns the segment belonging to the given worker. An index greater than
+     * or equal to the number of workers is undefined. */
+    Segment& segment(size_t worker);
+
+    /** The total number of rows appended across all segments. */
+    size_t nrows() const;
+
+    /** Splices the segments together in worker order and returns the resulting
+     * dataframe. The first segment's columns are reserved for every row before
+     * the others are moved onto them, so they grow at most once. The builder
+     * is reset to a single empty worker afterwards.
+     * This must not be called while workers are appending. */
+    std::shared_ptr<DataFrame> finish();
+
+    /** Returns the hashcode of the builder. */
+    size_t hash() const override;
+
+    /** Tests for pointer equality. */
+    bool equals(const Object *other) const override;
+
+    /** Returns nullptr. This object cannot be cloned. */
+    std::shared_ptr<Object> clone() const override;
+};
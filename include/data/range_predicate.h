@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <variant>
+#include <utility>
+
+#include "util/object.h"
+#include "data/column.h"
+
+/****************************************************************************
+ * RangePredicate::
+ *
+ * Describes the range [lo, hi] of values of one column that a scan is looking
+ * for. Given to map, pmap and filter, it lets them skip every block of ZONE_ROWS
+ * rows whose zone map proves that no value in the column is in the range.
+ *
+ * It is only a hint: rows in the blocks which are not skipped are all visited,
+ * including the ones outside the range, so the Rower must still check the values
+ * itself. The type of the range must match the type of the column.
+ */
+class RangePredicate : public Object {
+private:
+    /** The column the range applies to. */
+    size_t _col;
+    /** The inclusive bounds of the range. */
+    std::variant<std::pair<int, int>, std::pair<double, double>,
+                 std::pair<std::string, std::string>> _range;
+
+public:
+    /** Constructs a range over an int, float or string column. */
+    RangePredicate(size_t col, int lo, int hi);
+    RangePredicate(size_t col, double lo, double hi);
+    RangePredicate(size_t col, std::string lo, std::string hi);
+
+    /** Returns the column the range applies to. */
+    size_t col() const;
+
+    /** Returns false if the zone map of the given column proves that no value
+     * in the given block of rows is in the range, true otherwise. The column
+     * must be of the same type as the range. */
+    bool may_match(const Column& col, size_t zone) const;
+
+    size_t hash() const override;
+
+    bool equals(const Object *other) const override;
+
+    std::shared_ptr<Object> clone() const override;
+};
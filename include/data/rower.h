@@ -23,6 +23,22 @@ public:
       original object will be the last to be called join on. The join method
       is reponsible for cleaning up memory. */
     virtual void join(std::shared_ptr<Rower> other) = 0;
+
+    /** Returns true if joining is associative, that is joining b into a
+      and then c into a gives the same result as joining c into b and then
+      b into a. If so, pmap merges the clones with a parallel pairwise tree
+      on its worker threads instead of one at a time on the calling thread.
+      A rower is always joined with a rower that visited later rows, so join
+      does not need to be commutative. Returns false by default. */
+    virtual bool join_is_associative() const;
+
+    /** Called by map and pmap before traversal starts, with the index of the
+      worker this rower is going to run on (the original object is always
+      worker 0) and the total number of workers. Rowers that build a dataframe
+      in parallel use this to pick their segment of a ParallelFrameBuilder.
+      It is called on the thread that started the traversal, before any worker
+      runs. Does nothing by default. */
+    virtual void start_worker(size_t worker, size_t worker_cnt);
 };
 
 
@@ -7,6 +7,7 @@
 
 #include "util/serializable.h"
 #include "data/column.h"
+#include "data/column_stats.h"
 
 
 /*************************************************************************
@@ -28,9 +29,11 @@ private:
     size_t _width;
     /** The number of rows in the schema. */
     size_t _length;
+    /** The statistics of each column, null if they have not been computed. */
+    std::vector<std::shared_ptr<const ColumnStats>> _stats;
 
 public:
-    /** Copy constructor */
+    /** Copy constructor. Names and column statistics are not copied. */
     Schema(const Schema& from);
 
     /** Create an empty schema **/
@@ -62,6 +65,12 @@ public:
     *  no name. */
     void add_row(std::optional<std::string> name = std::nullopt);
 
+    /** Makes room for the names of at least the given number of rows. */
+    void reserve_rows(size_t rows);
+
+    /** Releases the memory reserved beyond the names of the rows. */
+    void shrink_to_fit();
+
     /** Return name of row at idx; nullopt indicates no name. An idx >= width
     * is undefined. */
     std::optional<std::string> row_name(size_t idx) const;
@@ -85,6 +94,13 @@ public:
     /** The number of rows */
     size_t length() const;
 
+    /** Returns the statistics of the column at idx, or nullptr if they have
+     * not been computed. */
+    std::shared_ptr<const ColumnStats> col_stats(size_t idx) const;
+
+    /** Sets the statistics of the column at idx. An idx >= width is undefined. */
+    void set_col_stats(size_t idx, std::shared_ptr<const ColumnStats> stats);
+
     /** Create a copy of the schema. */
     std::shared_ptr<Object> clone() const override;
 
@@ -95,22 +111,30 @@ public:
     size_t hash() const override;
 
     /** Serialize the schema into byte format. Drops row and column 
-     * names. */
+     * names and column statistics. */
     std::vector<uint8_t> serialize() const override;
 
+    /** Writes the width followed by the type of each column. */
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
+
 };
 
 /**Sspecialization of deserialize for Schema
  *
  * Given a serialized schema, constructs a Schema object containing the appropriate
  * data from the serialized schema. Row and column names are dropped. */
+template<>
+inline Schema Serializable::deserialize_from<Schema>(ByteReader& r) {
+    size_t width = r.read_size();
+    const uint8_t *types = r.read_bytes(width);
+    return Schema(std::string(reinterpret_cast<const char *>(types), width));
+}
+
 template<>
 inline Schema Serializable::deserialize<Schema>(const std::vector<uint8_t>& data, size_t& pos) {
-    std::string s;
-    size_t width = Serializable::deserialize<size_t>(data, pos);
-    for(size_t i = 0; i < width; ++i) {
-        s += Serializable::deserialize<char>(data, pos);
-    }
-    return Schema(s);
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<Schema>(r);
 }
 
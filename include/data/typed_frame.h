@@ -0,0 +1,236 @@
+#pragma once
+
+#include <tuple>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <exception>
+
+#include "data/dataframe.h"
+
+/** Maps a C++ value type to the column class that stores it, and the character
+ * used to represent that column type in a schema. Only the four types supported
+ * by the dataframe have specializations. */
+template< typename T >
+struct ColumnTraits;
+
+template<>
+struct ColumnTraits<int> {
+    using column_type = IntColumn;
+    static constexpr char type = 'I';
+};
+
+template<>
+struct ColumnTraits<double> {
+    using column_type = FloatColumn;
+    static constexpr char type = 'F';
+};
+
+template<>
+struct ColumnTraits<bool> {
+    using column_type = BoolColumn;
+    static constexpr char type = 'B';
+};
+
+template<>
+struct ColumnTraits<std::string> {
+    using column_type = StringColumn;
+    static constexpr char type = 'S';
+};
+
+/****************************************************************************
+ * TypedFrame::
+ *
+ * A read-only view over an existing DataFrame whose column types are known at
+ * compile time, eg. TypedFrame<int, std::string>. The schema is checked once
+ * when the view is constructed, after which every access goes straight to the
+ * arrays backing the columns, with no virtual type converters, no Row objects
+ * and no switching on the column type. Columns mapped from a file are read
+ * where they lie, without being copied into memory.
+ *
+ * The view borrows the storage of the dataframe. The dataframe must outlive
+ * the view, and adding rows to it while the view exists is undefined.
+ */
+template< typename... Ts >
+class TypedFrame {
+public:
+    /** The type of the column at the given index. */
+    template< size_t I >
+    using type_at = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    /** The type returned when reading a value without copying it. This is a
+     * const reference, except for booleans which are stored as bits, and
+     * strings which are string_views. */
+    template< size_t I >
+    using const_reference = typename NullableArray<type_at<I>>::const_reference;
+
+    /** Exception thrown when the dataframe given to the constructor does not
+     * match the types of the view. */
+    class SchemaMismatchException : public std::exception {
+        const char *what() const throw() override {
+            return "DataFrame schema does not match the typed view!";
+        }
+    };
+
+    /** A lightweight handle to a single row of the view, passed to the functions
+     * given to map and pmap. It is only valid for the duration of that call. */
+    class RowView {
+    private:
+        const TypedFrame& _frame;
+        size_t _row;
+
+    public:
+        RowView(const TypedFrame& frame, size_t row) : _frame(frame), _row(row) {}
+
+        /** The index of this row in the dataframe. */
+        size_t get_index() const { return _row; }
+
+        /** Returns true if the value in the given column exists. */
+        template< size_t I >
+        bool exists() const { return _frame.template exists<I>(_row); }
+
+        /** Returns the value in the given column without copying it. Reading
+         * a missing value is undefined. */
+        template< size_t I >
+        const_reference<I> value() const { return _frame.template value<I>(_row); }
+
+        /** Returns the value in the given column, or a null optional if it
+         * is missing. */
+        template< size_t I >
+        std::optional<type_at<I>> get() const { return _frame.template get<I>(_row); }
+    };
+
+private:
+    /** Pointers to the array backing each column. */
+    std::tuple<const NullableArray<Ts>*...> _arrays;
+    /** The number of rows in the viewed dataframe. */
+    size_t _nrows;
+
+    /** Checks the type of the column at index I and stores a pointer to its
+     * array. Throws a SchemaMismatchException if the types differ. */
+    template< size_t I >
+    void _bind_column(const DataFrame& df) {
+        using T = type_at<I>;
+        const Column& col = df.get_column(I);
+        if(col.get_type() != ColumnTraits<T>::type) throw SchemaMismatchException();
+
+        std::get<I>(_arrays) = &static_cast<const typename ColumnTraits<T>::column_type&>(col).get_array();
+    }
+
+    template< size_t... Is >
+    void _bind(const DataFrame& df, std::index_sequence<Is...>) {
+        (_bind_column<Is>(df), ...);
+    }
+
+    /** Calls the given function on every row in [row_start, row_end). */
+    template< typename F >
+    void _map_range(size_t row_start, size_t row_end, F& f) const {
+        for(size_t r = row_start; r < row_end; ++r) {
+            f(RowView(*this, r));
+        }
+    }
+
+    /** Splits the rows into chunks the same way DataFrame::pmap does, and calls
+     * task(thread_idx, row_start, row_end) for each chunk on its own thread.
+     * Returns the number of threads used, which is 0 if the view is too small
+     * to be worth multi-threading, in which case task is not called. */
+    template< typename Task >
+    size_t _run_chunks(Task&& task) const {
+        size_t thread_cnt = _nrows / THREAD_ROWS;
+        if(thread_cnt <= 1) return 0;
+
+        size_t step_size = THREAD_ROWS;
+        if(thread_cnt > MAX_THREADS) {
+            thread_cnt = MAX_THREADS;
+            step_size = _nrows / thread_cnt;
+        }
+
+        std::vector<std::thread> threads;
+        size_t row_start = 0;
+        for(size_t i = 0; i < thread_cnt; ++i) {
+            size_t row_end = (i == (thread_cnt - 1)) ? _nrows : row_start + step_size;
+            threads.emplace_back([&task, i, row_start, row_end]{ task(i, row_start, row_end); });
+            row_start = row_end;
+        }
+        for(size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+        return thread_cnt;
+    }
+
+public:
+    /** Constructs a view over the given dataframe. Throws a SchemaMismatchException
+     * if the dataframe does not have exactly one column per type, or if any column
+     * has a different type than the view. */
+    explicit TypedFrame(const DataFrame& df) : _arrays(), _nrows(df.nrows()) {
+        if(df.ncols() != sizeof...(Ts)) throw SchemaMismatchException();
+        _bind(df, std::index_sequence_for<Ts...>{});
+    }
+
+    /** The number of rows in the view. */
+    size_t nrows() const { return _nrows; }
+
+    /** The number of columns in the view. */
+    static constexpr size_t ncols() { return sizeof...(Ts); }
+
+    /** Returns true if the value at the given column and row exists. */
+    template< size_t I >
+    bool exists(size_t row) const {
+        return std::get<I>(_arrays)->exists(row);
+    }
+
+    /** Returns the value at the given column and row without copying it.
+     * Reading a missing value is undefined. */
+    template< size_t I >
+    const_reference<I> value(size_t row) const {
+        return std::get<I>(_arrays)->value(row);
+    }
+
+    /** Returns the value at the given column and row, or a null optional if
+     * it is missing. */
+    template< size_t I >
+    std::optional<type_at<I>> get(size_t row) const {
+        if(exists<I>(row)) return std::optional<type_at<I>>(type_at<I>(value<I>(row)));
+        return std::nullopt;
+    }
+
+    /** Visit rows in order, calling f(const RowView&) for each one. */
+    template< typename F >
+    void map(F&& f) const {
+        _map_range(0, _nrows, f);
+    }
+
+    /** Visit rows in parallel, calling f(const RowView&) for each one. The
+     * same function object is shared by every thread, so anything it mutates
+     * must be done in a thread safe manner. */
+    template< typename F >
+    void pmap(F&& f) const {
+        if(!_run_chunks([this, &f](size_t, size_t row_start, size_t row_end){
+                    this->_map_range(row_start, row_end, f);
+                })) {
+            this->map(f);
+        }
+    }
+
+    /** Visit rows in parallel. Each thread other than the first works on its
+     * own copy of f, the same way pmap clones a Rower. Once every thread has
+     * finished, join(f, copy) is called for each copy in order so the partial
+     * results can be merged into f. */
+    template< typename F, typename J >
+    void pmap(F& f, J&& join) const {
+        size_t max_threads = (_nrows / THREAD_ROWS > MAX_THREADS ? MAX_THREADS : _nrows / THREAD_ROWS);
+        std::vector<F> copies(max_threads > 1 ? max_threads - 1 : 0, f);
+
+        size_t thread_cnt = _run_chunks([this, &f, &copies](size_t i, size_t row_start, size_t row_end){
+                    this->_map_range(row_start, row_end, (i > 0 ? copies[i - 1] : f));
+                });
+        if(!thread_cnt) {
+            this->map(f);
+            return;
+        }
+        for(size_t i = 0; i < copies.size(); ++i) {
+            join(f, copies[i]);
+        }
+    }
+};
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <optional>
+#include <type_traits>
+
+#include "util/serializable.h"
+#include "data/nullable_array.h"
+
+/** The number of rows summarized by each zone of a ZoneMap. */
+#define ZONE_ROWS    1024
+
+/** A template class summarizing each consecutive block of ZONE_ROWS values of a
+ * column with the smallest and largest value in the block, and the number of
+ * missing values. A scan looking for values in a range can skip every block
+ * whose [min, max] does not overlap the range without reading it.
+ *
+ * NaNs are never counted as values, since they are never in any range. The map
+ * is kept up to date by the column it belongs to: push_back for every new
+ * value, and update whenever a value is overwritten. */
+template < class T >
+class ZoneMap : public Serializable {
+public:
+    /** The summary of a single block of rows. min and max are only meaningful
+     * if value_count is not 0. */
+    struct Zone {
+        T min{};
+        T max{};
+        /** The number of missing values in the block. */
+        size_t null_count = 0;
+        /** The number of values in the block which are neither missing nor NaN. */
+        size_t value_count = 0;
+
+        bool operator==(const Zone& other) const {
+            return null_count == other.null_count && value_count == other.value_count
+                && (value_count == 0 || (min == other.min && max == other.max));
+        }
+    };
+
+private:
+    std::vector<Zone> _zones;
+    /** The number of rows summarized. */
+    size_t _rows;
+
+    /** Returns false if the value can never be in a range, ie. it is NaN. */
+    template< typename V >
+    static inline bool _is_value(const V& val) {
+        if constexpr (std::is_floating_point_v<T>) {
+            return !std::isnan(val);
+        } else {
+            return true;
+        }
+    }
+
+    /** Adds an existing value to the zone, which may be a string_view of a
+     * mapped string. */
+    template< typename V >
+    static inline void _include(Zone& z, const V& val) {
+        if(!_is_value(val)) return;
+        if(z.value_count == 0) {
+            z.min = val;
+            z.max = val;
+        } else if(val < z.min) {
+            z.min = val;
+        } else if(z.max < val) {
+            z.max = val;
+        }
+        ++z.value_count;
+    }
+
+    /** Recomputes the given zone from the values in the array. */
+    inline void _rebuild_zone(size_t zone, const NullableArray<T>& arr) {
+        Zone z;
+        size_t end = std::min(_rows, (zone + 1) * ZONE_ROWS);
+        for(size_t r = zone * ZONE_ROWS; r < end; ++r) {
+            if(arr.exists(r)) _include(z, arr.value(r));
+            else ++z.null_count;
+        }
+        _zones[zone] = std::move(z);
+    }
+
+public:
+    ZoneMap() : _zones(), _rows(0) {}
+    ZoneMap(const ZoneMap<T>&) = default;
+    ZoneMap(ZoneMap<T>&&) = default;
+    ZoneMap<T>& operator=(const ZoneMap<T>&) = default;
+    ZoneMap<T>& operator=(ZoneMap<T>&&) = default;
+
+    /** Makes room for the zones of the given number of rows. */
+    inline void reserve(size_t rows) {
+        _zones.reserve((rows + ZONE_ROWS - 1) / ZONE_ROWS);
+    }
+
+    /** Releases the memory reserved beyond the zones in the map. */
+    inline void shrink_to_fit() {
+        _zones.shrink_to_fit();
+    }
+
+    /** Records a value pushed onto the end of the column. */
+    inline void push_back(const std::optional<T>& val) {
+        if(_rows % ZONE_ROWS == 0) _zones.emplace_back();
+        ++_rows;
+        if(val) _include(_zones.back(), *val);
+        else ++_zones.back().null_count;
+    }
+
+    /** Records that the value at the given position changed from old to val.
+     * The array must already hold the new value. If the old value was the
+     * smallest or largest of its zone, the zone is recomputed from the array,
+     * since the bound may have shrunk. */
+    inline void update(size_t pos, const std::optional<T>& old, const std::optional<T>& val,
+                       const NullableArray<T>& arr) {
+        assert(pos < _rows);
+        Zone& z = _zones[pos / ZONE_ROWS];
+        if(old && _is_value(*old) && (!(z.min < *old) || !(*old < z.max))) {
+            _rebuild_zone(pos / ZONE_ROWS, arr);
+            return;
+        }
+        if(!old) --z.null_count;
+        else if(_is_value(*old)) --z.value_count;
+
+        if(val) _include(z, *val);
+        else ++z.null_count;
+    }
+
+    /** Recomputes every zone from the one containing the given row to the
+     * end of the array. Used after rows are appended in bulk. Zones do not
+     * depend on each other, so each chunk of PARALLEL_CHUNK_ROWS rows is
+     * recomputed on its own thread. */
+    inline void rebuild_from(const NullableArray<T>& arr, size_t row) {
+        size_t first = std::min(row, std::min(_rows, arr.size())) / ZONE_ROWS;
+        _rows = arr.size();
+        _zones.resize(first);
+        _zones.resize((_rows + ZONE_ROWS - 1) / ZONE_ROWS);
+        size_t chunk_zones = PARALLEL_CHUNK_ROWS / ZONE_ROWS;
+        size_t chunks = (_zones.size() - first + chunk_zones - 1) / chunk_zones;
+        parallel_for(chunks, [this, &arr, first, chunk_zones](size_t c){
+            size_t end = std::min(_zones.size(), first + (c + 1) * chunk_zones);
+            for(size_t z = first + c * chunk_zones; z < end; ++z) this->_rebuild_zone(z, arr);
+        });
+    }
+
+    /** The number of rows summarized. */
+    inline size_t rows() const {
+        return _rows;
+    }
+
+    /** The number of zones. */
+    inline size_t size() const {
+        return _zones.size();
+    }
+
+    /** Returns the summary of the given zone. */
+    inline const Zone& zone(size_t idx) const {
+        assert(idx < _zones.size());
+        return _zones[idx];
+    }
+
+    /** Returns false if no value of the given zone can be in [lo, hi], true
+     * if some might be. */
+    inline bool may_contain(size_t idx, const T& lo, const T& hi) const {
+        const Zone& z = zone(idx);
+        return z.value_count > 0 && !(hi < z.min) && !(z.max < lo);
+    }
+
+    /** Tests for equality */
+    inline bool equals(const Object *other) const override {
+        auto ozm = dynamic_cast<const ZoneMap<T> *>(other);
+        if(ozm) return *this == *ozm;
+        return false;
+    }
+
+    /** Overload of the equality operator. Tests for equality. */
+    inline bool operator==(const ZoneMap<T>& other) const {
+        return _rows == other._rows && _zones == other._zones;
+    }
+
+    /** Returns the hashcode of the zone map */
+    inline size_t hash() const override {
+        size_t hash = _rows;
+        for(size_t i = 0; i < _zones.size(); ++i) {
+            hash = hash * 31 + _zones[i].null_count + (_zones[i].value_count << 16);
+        }
+        return hash;
+    }
+
+    /** Returns a copy constructed instance of this object */
+    inline std::shared_ptr<Object> clone() const override {
+        return std::make_shared<ZoneMap<T>>(*this);
+    }
+
+    /** Returns the number of bytes serialize_into writes. */
+    inline size_t serialized_size() const override {
+        size_t size = sizeof(size_t) + _zones.size() * 2 * sizeof(size_t);
+        for(size_t i = 0; i < _zones.size(); ++i) {
+            if(_zones[i].value_count == 0) continue; // no bounds
+            size += ByteWriter::size_of(_zones[i].min) + ByteWriter::size_of(_zones[i].max);
+        }
+        return size;
+    }
+
+    /** Writes the row count, then the counts and bounds of each zone. */
+    inline void serialize_into(ByteWriter& w) const override {
+        w.write_size(_rows);
+        for(size_t i = 0; i < _zones.size(); ++i) {
+            w.write_size(_zones[i].null_count);
+            w.write_size(_zones[i].value_count);
+            if(_zones[i].value_count == 0) continue; // no bounds
+            w.write(_zones[i].min);
+            w.write(_zones[i].max);
+        }
+    }
+
+    /** Serializes the zone map into byte form */
+    inline std::vector<uint8_t> serialize() const override {
+        return this->_serialize_exact();
+    }
+
+    /** Reads a zone map written by serialize_into in the reader's encoding. */
+    static inline ZoneMap<T> read_from(ByteReader& r) {
+        ZoneMap<T> zm;
+        zm._rows = r.read_size();
+        // every zone takes at least two bytes, so check before making room
+        size_t zones = zm._rows / ZONE_ROWS + (zm._rows % ZONE_ROWS != 0);
+        if(zones > r.remaining() / 2) throw Serializable::ShortSerializedDataException();
+        zm._zones.resize(zones);
+        for(size_t i = 0; i < zm._zones.size(); ++i) {
+            Zone& z = zm._zones[i];
+            z.null_count = r.read_size();
+            z.value_count = r.read_size();
+            if(z.value_count == 0) continue;
+            z.min = r.read<T>();
+            z.max = r.read<T>();
+        }
+        return zm;
+    }
+
+    /** Deserializes a zone map, the same way as NullableArray::deserialize. */
+    static inline ZoneMap<T> deserialize(const std::vector<uint8_t>& data, size_t& pos) {
+        ByteReader r(data, pos);
+        return read_from(r);
+    }
+};
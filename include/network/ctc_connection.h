@@ -5,6 +5,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <list>
+#include <unordered_set>
 
 #include "network/client.h"
 #include "network/connection.h"
@@ -59,6 +60,16 @@ public:
     /** Returns the hashcode for this object. */
     size_t hash() const override;
 
+    /** Returns the value of a key list packet holding the given keys in the
+     * given encoding. */
+    static std::vector<uint8_t> pack_keys(const std::unordered_set<std::string>& keys,
+                                          Encoding enc);
+
+    /** Returns the keys held in the value of a key list packet in the given
+     * encoding. */
+    static std::vector<std::string> unpack_keys(const std::vector<uint8_t>& value,
+                                                Encoding enc);
+
 protected:
     /** Reference to the client object which this connection represents locally. */
     Client& _client;
@@ -76,6 +87,9 @@ protected:
     /** The list of requests that have communicated to the remote node, but have
      * not yet received a response. */
     std::list<std::shared_ptr<ValueRequest>> _waiting_requests;
+    /** The newest encoding the other node announced it reads. Only touched by
+     * the thread running this connection. */
+    Encoding _peer_encoding;
 
     /** Helper function to perform the required actions if _receiver is false.
      * In this case, it connects to the given target and identifies which client
@@ -86,12 +100,16 @@ protected:
      * In this case, it does nothing. */
     void _as_receiver();
 
+    /** Announces the newest encoding this node reads. A node that predates
+     * the announcement ignores it, and so keeps receiving the FIXED encoding. */
+    void _send_encoding();
+
     /** Send the set of keys whose associated values are stored locally on this
      * node. */
     void _send_keys();
 
     /** Updates the list of remote keys with the latest set that the other
-     * node claims to have. */
+     * node claims to have. A malformed key list is a ParseError. */
     ParseResult _update_keys(Packet &packet);
 
     /** Overriden parse data method which provides the correct parsing for 
@@ -109,7 +127,8 @@ protected:
 
     /** Helper function that parses the response to a value request, and
      * updates the correct waiting request with the received value, wakes the
-     * thread and removes it from the list of waiting requests. */
+     * thread and removes it from the list of waiting requests. A malformed
+     * or corrupt response is a ParseError. */
     ParseResult _parse_request_response(Packet &p);
 
     /** Helper function that parses a request for a value from a remote node,
@@ -8,6 +8,13 @@
 
 #include "util/object.h"
 
+/** The length of the type and length fields in front of the value. */
+#define PACKET_HEADER_LEN   (sizeof(uint8_t) + sizeof(uint64_t))
+/** The largest value length allocated up front when a packet starts to be
+ * read in. Longer values grow as they arrive, so a corrupt length cannot
+ * allocate an arbitrary amount of memory. */
+#define PACKET_MAX_RESERVE  (size_t(1) << 30)
+
 
 /** Class which represents a TLV packet used to simplify the logic
  * of reading from and writing a packet over the network. */
@@ -45,6 +52,17 @@ public:
         /** The packet is a list of keys whose values are stored in the sender's
          * local KVStore */
         KEY_LIST       = 0x09,
+        /** The packet holds one byte, the newest Encoding the sender reads.
+         * Until it arrives, the receiver only sends the FIXED encoding. */
+        ENCODING       = 0x0A,
+        /** A VALUE_RESPONSE whose dataframe is in the COMPACT encoding. */
+        VALUE_RESPONSE_COMPACT = 0x0B,
+        /** A KEY_LIST in the COMPACT encoding: the keys sorted, each written
+         * as the length of the prefix it shares with the key before it and
+         * the rest of the key. */
+        KEY_LIST_COMPACT = 0x0C,
+        /** A VALUE_RESPONSE whose dataframe is in the COMPRESSED encoding. */
+        VALUE_RESPONSE_COMPRESSED = 0x0D,
         /** Packet used to update a watchdog timer. */
         KEEP_ALIVE     = 0xFC,
         /** Packet containing a string representing an error message. */
@@ -74,6 +92,11 @@ public:
      * representation. */
     std::vector<uint8_t> pack() const;
 
+    /** Writes the type and length fields of the TLV form into the given buffer
+     * of PACKET_HEADER_LEN bytes, so that the value can be sent after it
+     * without being copied. */
+    void pack_header(uint8_t *header) const;
+
     /** Given a pointer to a buffer containing a packet and the length of said
      * buffer, attempts to read the data from the buffer into this instance of
      * a packet. Returns the number of bytes read in on success, and -1 on failure. 
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <exception>
+
+/** The fewest bytes worth trying to compress. */
+#define CODEC_MIN_BYTES     512
+/** The number of bits of the hash the LZ compressor finds matches with. */
+#define LZ_HASH_BITS        14
+/** The shortest match the LZ compressor encodes. */
+#define LZ_MIN_MATCH        4
+/** The furthest back a match can start. */
+#define LZ_MAX_OFFSET       65535
+/** The most bytes one byte of LZ compressed data decompresses to: a length
+ * continuation byte of 255 adds 255 bytes, and nothing else adds more. */
+#define LZ_MAX_EXPANSION    255
+
+/** Identifies the codec a block of bytes was compressed with. Stored in front
+ * of the block, so the values must not change. */
+enum class CodecId : uint8_t { NONE = 0, LZ = 1 };
+
+/**************************************************************************
+ * Codec ::
+ * Compresses and decompresses blocks of bytes. A block is stored with the id of
+ * its codec and its decompressed length, so decompress() is told exactly how many
+ * bytes to produce. Codecs are stateless, so one instance is shared by every
+ * thread, and is looked up by id with Codec::get.
+ */
+class Codec {
+public:
+    /** Thrown when a block does not decompress to the length it claims. */
+    class CorruptDataException : public std::exception {
+        const char *what() const throw() override {
+            return "Compressed data is corrupt!";
+        }
+    };
+
+    /** The compression ratio and throughput of a codec on some data. */
+    struct Report {
+        /** The codec measured. */
+        CodecId codec;
+        /** The number of bytes before compression. */
+        size_t raw_bytes;
+        /** The number of bytes after compression. */
+        size_t compressed_bytes;
+        /** The time spent compressing and decompressing them, in seconds. */
+        double compress_seconds;
+        double decompress_seconds;
+
+        /** Returns how many times smaller the compressed bytes are. */
+        double ratio() const;
+        /** Returns the raw bytes compressed per second, in MB. */
+        double compress_mbps() const;
+        /** Returns the raw bytes decompressed per second, in MB. */
+        double decompress_mbps() const;
+        /** Returns a one line summary. */
+        std::string to_string() const;
+    };
+
+    virtual ~Codec() = default;
+
+    /** Returns the id stored in front of blocks this codec compresses. */
+    virtual CodecId id() const = 0;
+
+    /** Returns the name of the codec. */
+    virtual const char *name() const = 0;
+
+    /** Appends the compressed form of the len bytes at in to out. */
+    virtual void compress(const uint8_t *in, size_t len, std::vector<uint8_t>& out) const = 0;
+
+    /** Returns the most bytes that len bytes compressed by this codec can
+     * decompress to, so that a block claiming more can be rejected before room
+     * is made for it. */
+    virtual size_t max_decompressed(size_t len) const = 0;
+
+    /** Decompresses the len bytes at in into exactly out_len bytes at out.
+     * Throws CorruptDataException if they do not decompress to out_len bytes. */
+    virtual void decompress(const uint8_t *in, size_t len, uint8_t *out, size_t out_len) const = 0;
+
+    /** Returns the codec with the given id. Throws CorruptDataException if
+     * there is none, as the id was read from a block. */
+    static const Codec& get(CodecId id);
+
+    /** Returns the codec to compress the given bytes with: none for small
+     * blocks, or blocks the compressor cannot shrink by an eighth, in which
+     * case out is left empty. Otherwise out holds the compressed bytes. */
+    static const Codec& choose(const uint8_t *in, size_t len, std::vector<uint8_t>& out);
+
+    /** Compresses and decompresses the bytes with the codec, timing both. */
+    static Report measure(const Codec& codec, const std::vector<uint8_t>& data);
+};
+
+/**************************************************************************
+ * NoneCodec ::
+ * Stores blocks as they are.
+ */
+class NoneCodec : public Codec {
+public:
+    CodecId id() const override;
+    const char *name() const override;
+    void compress(const uint8_t *in, size_t len, std::vector<uint8_t>& out) const override;
+    size_t max_decompressed(size_t len) const override;
+    void decompress(const uint8_t *in, size_t len, uint8_t *out, size_t out_len) const override;
+};
+
+/**************************************************************************
+ * LzCodec ::
+ * A fast LZ77 compressor, in the block format of LZ4. Each sequence is a token
+ * byte holding the number of literals in its high 4 bits and the match length
+ * less LZ_MIN_MATCH in its low 4, either of which continues in following bytes
+ * of 255 when it is 15, the literals, and a 2 byte little endian offset back to
+ * the match. The last sequence is only literals. Matches are found with a hash
+ * table of the last position each 4 byte sequence was seen at, and the search
+ * skips ahead faster the longer it goes without finding one, so incompressible
+ * data passes through quickly.
+ */
+class LzCodec : public Codec {
+public:
+    CodecId id() const override;
+    const char *name() const override;
+    void compress(const uint8_t *in, size_t len, std::vector<uint8_t>& out) const override;
+    size_t max_decompressed(size_t len) const override;
+    void decompress(const uint8_t *in, size_t len, uint8_t *out, size_t out_len) const override;
+};
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "util/application.h"
 #include "data/kvstore.h"
+#include "data/rower.h"
+#include "adapter/sor_stream.h"
 
 #define DEFAULT_IP   "127.0.0.1"
 #define DEFAULT_SERVER_PORT 8001
@@ -46,6 +49,11 @@ private:
      * The mode that this applicatoin is currently on
      */
     Mode _mode;
+    /**
+     * Whether the commits file is streamed in row groups rather than read
+     * in whole before it is used.
+     */
+    bool _stream;
 
     /**
      * The dataframe is produced after we read in the file,
@@ -55,6 +63,20 @@ private:
      */
     std::shared_ptr<DataFrame> _read_in_file(KVStore::Key k, std::string fn) const;
 
+    /**
+     * Takes every group of the stream as it is parsed, stores each in the
+     * local KVStore under the key's name followed by "/" and its index, and
+     * maps the rower over it before taking the next. Once the file is parsed,
+     * the number of groups is stored under the key's name followed by
+     * "/groups".
+     * @param k The key the groups belong to
+     * @param stream The stream the file is being parsed by
+     * @param r The rower mapped over each group
+     * @return the groups of the file, in order
+     */
+    std::vector<std::shared_ptr<DataFrame>> _publish_groups(KVStore::Key k, SorStream& stream,
+                                                            Rower& r) const;
+
     /**
      * Reads in the projects file and stores it in the local KVStore under
      * the key "projects".
@@ -77,7 +99,9 @@ private:
      * worked on projects with him and stores their uuids in the local KVStore.
      * Then it finds the list of projects for the next degree, and stores them in
      * the local KVStore, and repeats the proccess until it has calculated all 7
-     * degrees.
+     * degrees. When streaming, the file is parsed while the uuid of Linus is
+     * waited for, each group is published as it is finished (see
+     * _publish_groups), and the projects of Linus are found group by group.
      */
     void _commits();
 
@@ -1,46 +1,44 @@
 #pragma once
 
 #include <vector>
-#include <unordered_set>
-#include <mutex>
 
 #include "data/rower.h"
 #include "data/dataframe.h"
+#include "data/int_set.h"
+#include "data/parallel_frame_builder.h"
 
 /** Rower that operates on a dataframe containing integers,
  * and adds all integers in that dataframe to a set (preventing 
  * duplicates), and returns said set when finish_set() is called. */
 class IntSetGenerator : public Rower {
 private:
-    std::shared_ptr<std::mutex> _mutex;
-    std::shared_ptr<std::unordered_set<int>> _set;
+    /** The integers seen by this instance. Clones start empty and are
+     * merged into it with a union in join. */
+    IntSet _set;
 
 public:
-    /** Constructor. Creates new mutex and set. */
+    /** Constructor. Creates an empty set. */
     IntSetGenerator();
 
-    /** Constructor for clone. Takes the pointer to the mutex and set
-     * so that all instances created through clone are adding to the same 
-     * set. */
-    IntSetGenerator(std::shared_ptr<std::mutex> m, std::shared_ptr<std::unordered_set<int>> s);
-
     /** Override Rower.accept() method parsing a row. */
     bool accept(Row& row) override;
 
-    /** Combines rowers at the end. In this case does nothing. */
+    /** Adds the integers seen by the other rower to this one's set. */
     void join(std::shared_ptr<Rower> other) override;
 
+    /** Union is associative, so clones can be joined in a tree. */
+    bool join_is_associative() const override;
+
     /** Returns the set of integers constructed by the IntSetGenerator */
-    std::shared_ptr<std::unordered_set<int>> finish_set();
+    std::shared_ptr<IntSet> finish_set();
 
     /** Returns the hashcode of this object. */
     size_t hash() const override;
 
-    /** Returns a new instance of the IntSetGenerator that adds to the
-     * same set as this one. */
+    /** Returns a new instance of the IntSetGenerator with an empty set. */
     std::shared_ptr<Object> clone() const override;
 
-    /** Compares for pointer equality of the mutex and set. */
+    /** Compares the sets of integers seen. */
     bool equals(const Object *other) const override;
 };
 
@@ -49,43 +47,49 @@ public:
  * given set of values. */
 class UnorderedFilter : public Rower {
 protected:
-    /** Mutex protecting the _gen_df we are constructing. */
-    std::shared_ptr<std::mutex> _df_mutex;
-    /** The dataframe we are constructing. */
-    std::shared_ptr<DataFrame> _gen_df;
+    /** The builder constructing the dataframe, shared by every clone. Each
+     * clone appends to its own segment so that no locking is needed. */
+    std::shared_ptr<ParallelFrameBuilder> _builder;
+    /** The segment of the builder this instance appends to. */
+    ParallelFrameBuilder::Segment *_segment;
     /** The set of integers we are looking in. */
-    std::shared_ptr<std::unordered_set<int>> _set; // read only
-    /** A local row object to decrease the number of times
-     * a row is constructed for add_row. */
-    Row _row;
+    std::shared_ptr<const IntSet> _set; // read only
 
     /** Constructs the the filter from the schema of the dataframe, constructing
-     * new mutex and dataframe. */
-    UnorderedFilter(std::unique_ptr<Schema> s);
+     * a new builder, and the set of integers to look in. */
+    UnorderedFilter(std::unique_ptr<Schema> s, std::shared_ptr<const IntSet> set);
 
-    /** Constructs a new filter pointing to the the same mutex and dataframe
-     * so that they construct the dataframe in parallel. */
-    UnorderedFilter(std::shared_ptr<std::mutex> dfm, std::shared_ptr<DataFrame> df,
-                    std::shared_ptr<std::unordered_set<int>> s);
+    /** Constructs a new filter sharing the same builder so that they construct
+     * the dataframe in parallel. */
+    UnorderedFilter(std::shared_ptr<ParallelFrameBuilder> builder,
+                    std::shared_ptr<const IntSet> s);
 
     /** Returns true if the set of integers contains the given value, false
      * otherwise. */
-    bool _set_contains(int v);
+    bool _set_contains(int v) const;
 
-    /** Adds the integer to the dataframe. */
+    /** Adds the integer to this instance's segment of the dataframe. */
     void _add_to_df(int v);
 
-    /** Adds the given string to the dataframe. */
+    /** Adds the given string to this instance's segment of the dataframe. */
     void _add_to_df(std::string v);
 
-    /** Compares the internal mutex, dataframe, and set for pointer
-     * equality. */
+    /** Compares the internal builder and set for pointer equality. */
     bool _ptr_equality(const UnorderedFilter& other_uf) const;
 
 public:
     /** Returns the constructed dataframe. */
     std::shared_ptr<DataFrame> finish_filter();
 
+    /** Returns the set of integers in the constructed dataframe, which must
+     * have a single integer column, dropping the duplicates. */
+    std::shared_ptr<IntSet> finish_set();
+
+    /** Returns the range from the smallest to the largest integer in the set,
+     * over the given column. Given to pmap, it skips the blocks of rows whose
+     * values in that column are all outside the set's range. */
+    RangePredicate set_range(size_t col) const;
+
     /** Once traversal of the data frame is complete the rowers that were
      split off will be joined.  There will be one join per split. The
      original object will be the last to be called join on. The join method
@@ -93,6 +97,9 @@ public:
      nothing. */
     void join(std::shared_ptr<Rower> other) override;
 
+    /** Selects the segment of the shared builder this instance appends to. */
+    void start_worker(size_t worker, size_t worker_cnt) override;
+
     /** Returns the hashcode of this object. */
     size_t hash() const override;
 };
@@ -102,14 +109,18 @@ public:
  * that those users have worked on. */
 class UUIDsToProjectsFilter : public UnorderedFilter {
 public:
-    /* Constructor that creates new mutex and dataframe, and generates a set of
+    /* Constructor that creates a new builder, and generates a set of
      * UUIDs from the given dataframe. */
     UUIDsToProjectsFilter(std::shared_ptr<DataFrame> uuid_df);
 
-    /** Constructor that passes the pointer to the internal mutex, dataframe
+    /* Constructor that creates a new builder, looking in the given set of
+     * UUIDs. */
+    UUIDsToProjectsFilter(std::shared_ptr<const IntSet> uuids);
+
+    /** Constructor that passes the pointer to the builder of the dataframe
      * we are constructing, and set. */
-    UUIDsToProjectsFilter(std::shared_ptr<std::mutex> m, std::shared_ptr<DataFrame> df,
-                          std::shared_ptr<std::unordered_set<int>> uuids);
+    UUIDsToProjectsFilter(std::shared_ptr<ParallelFrameBuilder> builder,
+                          std::shared_ptr<const IntSet> uuids);
 
     /** the rower is taking the row that is going to be parse, 
      * and if the uuid of the writer or commiter is in the set,
@@ -120,7 +131,7 @@ public:
     std::shared_ptr<Object> clone() const override;
 
     /** Compares to ensure they are the same class and reference the
-     * same dataframe, mutex, and set. */
+     * same builder and set. */
     bool equals(const Object *other) const override;
 };
 
@@ -129,14 +140,18 @@ public:
  * users who have worked on those projects. */
 class ProjectsToUUIDsFilter : public UnorderedFilter {
 public:
-    /* Constructor that creates new mutex and dataframe, and generates a set of
+    /* Constructor that creates a new builder, and generates a set of
      * PIDs from the given dataframe. */
     ProjectsToUUIDsFilter(std::shared_ptr<DataFrame> projects_df);
 
-    /** Constructor that passes the pointer to the internal mutex, dataframe
+    /* Constructor that creates a new builder, looking in the given set of
+     * PIDs. */
+    ProjectsToUUIDsFilter(std::shared_ptr<const IntSet> pids);
+
+    /** Constructor that passes the pointer to the builder of the dataframe
      * we are constructing, and set. */
-    ProjectsToUUIDsFilter(std::shared_ptr<std::mutex> m, std::shared_ptr<DataFrame> df,
-                          std::shared_ptr<std::unordered_set<int>> pids);
+    ProjectsToUUIDsFilter(std::shared_ptr<ParallelFrameBuilder> builder,
+                          std::shared_ptr<const IntSet> pids);
 
     /** the rower is taking the row that is going to be parsed, 
      * and if the pid of the project is in the set, then
@@ -148,7 +163,7 @@ public:
     std::shared_ptr<Object> clone() const override;
 
     /** Compares to ensure they are the same class and reference the
-     * same dataframe, mutex, and set. */
+     * same builder and set. */
     bool equals(const Object *other) const override;
 };
 
@@ -157,14 +172,18 @@ public:
  * of the users in the set. */
 class UUIDsToNamesFilter : public UnorderedFilter {
 public:
-    /* Constructor that creates new mutex and dataframe, and generates a set of
+    /* Constructor that creates a new builder, and generates a set of
      * Usernames from the given dataframe. */
     UUIDsToNamesFilter(std::shared_ptr<DataFrame> uuid_df);
 
-    /** Constructor that passes the pointer to the internal mutex, dataframe
+    /* Constructor that creates a new builder, looking in the given set of
+     * UUIDs. */
+    UUIDsToNamesFilter(std::shared_ptr<const IntSet> uuids);
+
+    /** Constructor that passes the pointer to the builder of the dataframe
      * we are constructing, and set. */
-    UUIDsToNamesFilter(std::shared_ptr<std::mutex> m, std::shared_ptr<DataFrame> df,
-                       std::shared_ptr<std::unordered_set<int>> uuids);
+    UUIDsToNamesFilter(std::shared_ptr<ParallelFrameBuilder> builder,
+                       std::shared_ptr<const IntSet> uuids);
 
     /** the rower is taking the row that is going to be parsed, 
      * and if the uuid is in the set, adds the username to the dataframe we
@@ -175,6 +194,6 @@ public:
     std::shared_ptr<Object> clone() const override;
 
     /** Compares to ensure they are the same class and reference the
-     * same dataframe, mutex, and set. */
+     * same builder and set. */
     bool equals(const Object *other) const override;
 };
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+/**************************************************************************
+ * MappedFile ::
+ * A whole file mapped read-only into memory. The mapping is shared, so every
+ * process mapping the same file reads the same pages of the page cache, and
+ * nothing is read from disk until it is first touched. The file is unmapped
+ * when the object is destroyed.
+ */
+class MappedFile {
+private:
+    /** The start of the mapping. */
+    const uint8_t *_data;
+    /** The length of the file. */
+    size_t _size;
+
+    MappedFile(const uint8_t *data, size_t size);
+
+public:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    /** Maps the file at the given path. Returns nullptr if it cannot be opened
+     * or mapped. */
+    static std::shared_ptr<MappedFile> open(const std::string& path);
+
+    /** Returns the start of the mapped file. */
+    const uint8_t *data() const;
+
+    /** Returns the length of the file. */
+    size_t size() const;
+
+    /** Hints that [offset, offset + len) will be read in order, so the kernel
+     * reads ahead of the reader and may drop the pages behind it. */
+    void advise_sequential(size_t offset, size_t len) const;
+
+    /** Hints that [offset, offset + len) will be read soon, so the kernel
+     * starts reading it in the background. */
+    void advise_willneed(size_t offset, size_t len) const;
+
+    /** Hints that [offset, offset + len) will not be read again, so the kernel
+     * may drop its pages now rather than when memory runs short. */
+    void advise_dontneed(size_t offset, size_t len) const;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <exception>
+#include <algorithm>
+
+/** The most threads a parallel operation runs on. */
+#define MAX_THREADS    8
+
+/** Returns whether the calling thread is running the work of a parallel_for. */
+inline bool& in_parallel_for() {
+    static thread_local bool in = false;
+    return in;
+}
+
+/** Calls f(i) for every i in [0, count) on up to MAX_THREADS threads, thread t
+ * taking indices t, t + threads, ... The calling thread does the first share.
+ * Called from within another parallel_for, it runs on the calling thread, so
+ * that nested fan outs do not multiply the threads. Once every thread has
+ * finished, the first exception thrown by f, if any, is rethrown. */
+template< typename F >
+inline void parallel_for(size_t count, F&& f) {
+    size_t thread_cnt = std::min<size_t>(count, MAX_THREADS);
+    if(thread_cnt <= 1 || in_parallel_for()) {
+        for(size_t i = 0; i < count; ++i) f(i);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(thread_cnt);
+    auto work = [count, thread_cnt, &f, &errors](size_t t) {
+        in_parallel_for() = true;
+        try {
+            for(size_t i = t; i < count; i += thread_cnt) f(i);
+        } catch(...) {
+            errors[t] = std::current_exception();
+        }
+        in_parallel_for() = false;
+    };
+    std::vector<std::thread> threads;
+    for(size_t t = 1; t < thread_cnt; ++t) {
+        threads.emplace_back(work, t);
+    }
+    work(0);
+    for(size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    for(size_t t = 0; t < errors.size(); ++t) {
+        if(errors[t]) std::rethrow_exception(errors[t]);
+    }
+}
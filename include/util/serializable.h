@@ -5,10 +5,27 @@
 #include <type_traits>
 #include <exception>
 #include <string>
+#include <string_view>
 #include <cstring>
 #include <cassert>
+#include <algorithm>
 
 #include "util/object.h"
+#include "util/parallel.h"
+
+class ByteWriter;
+class ByteReader;
+
+/** The encodings a ByteWriter can write. FIXED is the format of
+ * Serializable::serialize, with every length and count written as a size_t.
+ * COMPACT writes them as LEB128 varints, and lets integer columns be delta
+ * encoded. COMPRESSED is COMPACT with each column of a dataframe compressed by
+ * the codec that suits it. A connection only sends an encoding newer than FIXED
+ * once its peer announced it reads it. */
+enum class Encoding : uint8_t { FIXED = 0, COMPACT = 1, COMPRESSED = 2 };
+
+/** The newest encoding this build reads and writes. */
+#define ENCODING_LATEST Encoding::COMPRESSED
 
 /**************************************************************************
  * Serializable  ::
@@ -42,6 +59,14 @@ public:
             return val;
         }
 
+    /*
+     * The template method to read a value from a reader, which may be reading
+     * the compact encoding. By default it deserializes the fixed format at the
+     * reader's position; classes with a compact form specialize it.
+     */
+    template< typename T >
+        static T deserialize_from(ByteReader& r);
+
     /*
      * The template method to serialize a primitive type data.
      */
@@ -57,8 +82,292 @@ public:
     /** The pure virtual method to override to implement a custom serialize
      * function for subclasses. */
     virtual std::vector<uint8_t> serialize() const = 0;
+
+    /** Appends the same bytes serialize() returns to the writer. By default it
+     * copies the result of serialize(); classes which are serialized often
+     * override it to write in place, so that nested objects share one buffer. */
+    virtual void serialize_into(ByteWriter& w) const;
+
+    /** Returns the number of bytes serialize_into() writes, so the buffer can be
+     * allocated once up front. By default it serializes the object to find out. */
+    virtual size_t serialized_size() const;
+
+protected:
+    /** Serializes the object with serialize_into() into a buffer of exactly
+     * serialized_size() bytes. Classes overriding both implement serialize()
+     * with it. */
+    std::vector<uint8_t> _serialize_exact() const;
+};
+
+/**************************************************************************
+ * ByteWriter ::
+ * Appends serialized values to the end of a byte vector it does not own, in the
+ * same format as Serializable::serialize. Reserving the size of the whole
+ * payload first means every write is a copy into memory already allocated.
+ */
+class ByteWriter {
+private:
+    /** The vector written to. */
+    std::vector<uint8_t>& _out;
+    /** The encoding lengths and counts are written in. */
+    Encoding _enc;
+
+public:
+    /** Constructs a writer appending to the given vector in the given encoding. */
+    explicit ByteWriter(std::vector<uint8_t>& out, Encoding enc = Encoding::FIXED)
+        : _out(out), _enc(enc) {}
+
+    /** Returns the encoding this writer writes. */
+    inline Encoding encoding() const {
+        return _enc;
+    }
+
+    /** Reserves room for n more bytes. */
+    inline void reserve(size_t n) {
+        _out.reserve(_out.size() + n);
+    }
+
+    /** Returns the number of bytes in the vector. */
+    inline size_t size() const {
+        return _out.size();
+    }
+
+    /** Appends len raw bytes. */
+    inline void write_bytes(const void *bytes, size_t len) {
+        const uint8_t *b = static_cast<const uint8_t *>(bytes);
+        _out.insert(_out.end(), b, b + len);
+    }
+
+    /** Appends v as a LEB128 varint: 7 bits a byte, lowest first, with the
+     * high bit set on every byte but the last. */
+    inline void write_varint(uint64_t v) {
+        while(v >= 0x80) {
+            _out.push_back(uint8_t(v) | 0x80);
+            v >>= 7;
+        }
+        _out.push_back(uint8_t(v));
+    }
+
+    /** Appends a length or count: a size_t when FIXED, a varint otherwise. */
+    inline void write_size(size_t n) {
+        if(_enc != Encoding::FIXED) this->write_varint(n);
+        else this->write<size_t>(n);
+    }
+
+    /** Returns the number of bytes write_varint(v) appends. */
+    static inline size_t varint_size(uint64_t v) {
+        size_t n = 1;
+        for(; v >= 0x80; v >>= 7) ++n;
+        return n;
+    }
+
+    /** Maps a signed value to an unsigned one so that values close to zero,
+     * of either sign, have short varints: 0, -1, 1, -2 become 0, 1, 2, 3. */
+    static inline uint64_t zigzag(int64_t v) {
+        return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+    }
+
+    /** Appends a primitive value, a string, or a Serializable object. A
+     * string_view is written as the string it views. */
+    template< typename T >
+    inline void write(const T& t) {
+        if constexpr (std::is_fundamental_v<T>) {
+            this->write_bytes(&t, sizeof(T));
+        } else if constexpr (std::is_same_v<std::string, T> || std::is_same_v<std::string_view, T>) {
+            this->write_size(t.size());
+            this->write_bytes(t.data(), t.size());
+        } else {
+            static_assert(std::is_base_of_v<Serializable, T>, "Cannot write this type!");
+            t.serialize_into(*this);
+        }
+    }
+
+    /** Appends the length of the bits and the bits packed 8 to a byte, the
+     * first one in the lowest bit of the first byte. The bytes are filled in
+     * where they lie in the output. */
+    inline void write_bits(const std::vector<bool>& vb) {
+        this->write_size(vb.size());
+        pack_bits(vb, 0, vb.size(), this->extend((vb.size() + 7) / 8));
+    }
+
+    /** Appends n bytes and returns a pointer to them, to be filled in before
+     * anything else is written, as writing may move them. */
+    inline uint8_t *extend(size_t n) {
+        size_t start = _out.size();
+        _out.resize(start + n);
+        return _out.data() + start;
+    }
+
+    /** Appends each of the pieces in order, copying them in parallel to their
+     * offsets in the vector. */
+    inline void write_pieces(const std::vector<std::vector<uint8_t>>& pieces) {
+        std::vector<size_t> offsets(pieces.size() + 1, 0);
+        for(size_t i = 0; i < pieces.size(); ++i) offsets[i + 1] = offsets[i] + pieces[i].size();
+        uint8_t *out = this->extend(offsets.back());
+        parallel_for(pieces.size(), [out, &pieces, &offsets](size_t i) {
+            memcpy(out + offsets[i], pieces[i].data(), pieces[i].size());
+        });
+    }
+
+    /** Packs the bits in [start, end) as write_bits does into the bytes at out,
+     * where start is a multiple of 8. The bits are still read one at a time,
+     * as std::vector<bool> offers no access to its words. Disjoint ranges can
+     * be packed in parallel. */
+    static inline void pack_bits(const std::vector<bool>& vb, size_t start, size_t end,
+                                 uint8_t *out) {
+        assert(start % 8 == 0 && end <= vb.size());
+        for(size_t i = start; i < end; i += 8) {
+            uint8_t byte = 0;
+            size_t bits = std::min<size_t>(8, end - i);
+            for(size_t b = 0; b < bits; ++b) byte |= uint8_t(vb[i + b]) << b;
+            *out++ = byte;
+        }
+    }
+
+    /** Returns the number of bytes write(t) appends in the FIXED encoding,
+     * which is never less than what COMPACT appends. */
+    template< typename T >
+    static inline size_t size_of(const T& t) {
+        if constexpr (std::is_fundamental_v<T>) {
+            return sizeof(T);
+        } else if constexpr (std::is_same_v<std::string, T> || std::is_same_v<std::string_view, T>) {
+            return sizeof(size_t) + t.size();
+        } else {
+            static_assert(std::is_base_of_v<Serializable, T>, "Cannot write this type!");
+            return t.serialized_size();
+        }
+    }
+
+    /** Returns the number of bytes write_bits appends for the given number of
+     * bits. */
+    static inline size_t bits_size(size_t bits) {
+        return sizeof(size_t) + (bits + 7) / 8;
+    }
+};
+
+/**************************************************************************
+ * ByteReader ::
+ * Reads serialized values in order from a byte vector, advancing a position
+ * shared with the caller, so that it can be mixed with Serializable::deserialize.
+ * Reads the encoding it is given, which must be the one the data was written in.
+ * Throws ShortSerializedDataException if the data runs out.
+ */
+class ByteReader {
+private:
+    /** The data read from. */
+    const std::vector<uint8_t>& _data;
+    /** The position of the next byte to read. */
+    size_t& _pos;
+    /** The encoding lengths and counts are read in. */
+    Encoding _enc;
+
+    friend class Serializable;
+
+public:
+    /** Constructs a reader starting at pos, which it advances. */
+    ByteReader(const std::vector<uint8_t>& data, size_t& pos, Encoding enc = Encoding::FIXED)
+        : _data(data), _pos(pos), _enc(enc) {}
+
+    /** Returns the encoding this reader reads. */
+    inline Encoding encoding() const {
+        return _enc;
+    }
+
+    /** Returns the data read from. */
+    inline const std::vector<uint8_t>& data() const {
+        return _data;
+    }
+
+    /** Returns the position of the next byte to read. */
+    inline size_t pos() const {
+        return _pos;
+    }
+
+    /** Returns the number of bytes left to read. */
+    inline size_t remaining() const {
+        return _pos > _data.size() ? 0 : _data.size() - _pos;
+    }
+
+    /** Returns a pointer to the next len bytes and skips over them. */
+    inline const uint8_t *read_bytes(size_t len) {
+        if(this->remaining() < len) throw Serializable::ShortSerializedDataException();
+        const uint8_t *bytes = _data.data() + _pos;
+        _pos += len;
+        return bytes;
+    }
+
+    /** Reads a LEB128 varint written by ByteWriter::write_varint. */
+    inline uint64_t read_varint() {
+        uint64_t v = 0;
+        for(size_t shift = 0; shift < 64; shift += 7) {
+            uint8_t b = *this->read_bytes(1);
+            v |= uint64_t(b & 0x7f) << shift;
+            if(!(b & 0x80)) return v;
+        }
+        throw Serializable::ShortSerializedDataException(); // over long varint
+    }
+
+    /** Reads a length or count written by ByteWriter::write_size. */
+    inline size_t read_size() {
+        if(_enc != Encoding::FIXED) return this->read_varint();
+        return this->read<size_t>();
+    }
+
+    /** Inverts ByteWriter::zigzag. */
+    static inline int64_t unzigzag(uint64_t v) {
+        return int64_t(v >> 1) ^ -int64_t(v & 1);
+    }
+
+    /** Reads bits written by ByteWriter::write_bits. The length is checked
+     * against the bytes remaining before any room is made for the bits. */
+    inline std::vector<bool> read_bits() {
+        size_t len = this->read_size();
+        if(len / 8 + (len % 8 != 0) > this->remaining()) {
+            throw Serializable::ShortSerializedDataException();
+        }
+        std::vector<bool> vec(len);
+        unpack_bits(this->read_bytes((len + 7) / 8), 0, len, vec);
+        return vec;
+    }
+
+    /** Unpacks the bits in [start, end) of vb from the bytes at in, which hold
+     * them packed as ByteWriter::pack_bits does, where start is a multiple of
+     * 64, so that parallel ranges never share a word of vb. The bits are set
+     * one at a time. Disjoint ranges can be unpacked in parallel. */
+    static inline void unpack_bits(const uint8_t *in, size_t start, size_t end,
+                                   std::vector<bool>& vb) {
+        assert(start % 64 == 0 && end <= vb.size());
+        for(size_t i = start; i < end; i += 8) {
+            uint8_t byte = in[i / 8];
+            size_t bits = std::min<size_t>(8, end - i);
+            for(size_t b = 0; b < bits; ++b) vb[i + b] = (byte >> b) & 1;
+        }
+    }
+
+    /** Reads a primitive value, a string, bits, or any type with a
+     * specialization of deserialize. */
+    template< typename T >
+    inline T read() {
+        if constexpr (std::is_fundamental_v<T>) {
+            T val;
+            memcpy(&val, this->read_bytes(sizeof(T)), sizeof(T));
+            return val;
+        } else if constexpr (std::is_same_v<std::string, T>) {
+            size_t len = this->read_size();
+            return std::string(reinterpret_cast<const char *>(this->read_bytes(len)), len);
+        } else if constexpr (std::is_same_v<std::vector<bool>, T>) {
+            return this->read_bits();
+        } else {
+            return Serializable::deserialize_from<T>(*this);
+        }
+    }
 };
 
+template< typename T >
+inline T Serializable::deserialize_from(ByteReader& r) {
+    return Serializable::deserialize<T>(r._data, r._pos);
+}
+
 /*
  * Specializes serialize and deserialize for std::string. Converts it to a 
  * byte form representation.
@@ -66,67 +375,46 @@ public:
 template<>
 inline std::vector<uint8_t> Serializable::serialize<std::string>(std::string s){
     std::vector<uint8_t> vec = Serializable::serialize<size_t>(s.size());
-    for(size_t i = 0; i < s.size(); ++i){
-        std::vector<uint8_t> temp = Serializable::serialize<char>(s[i]);
-        vec.insert(vec.end(), temp.begin(), temp.end());
-    }
+    vec.insert(vec.end(), s.begin(), s.end());
     return vec;
 }
 
 template<>
 inline std::string Serializable::deserialize<std::string>(const std::vector<uint8_t>& data, size_t& pos) {
-    std::string s;
-    size_t len = Serializable::deserialize<size_t>(data, pos);
-    for(size_t i = 0; i < len; ++i) {
-        s += Serializable::deserialize<char>(data, pos);
-    }
-    return s;
+    return ByteReader(data, pos).read<std::string>();
 }
 
 /*
  * Specializes serialize and deserialize for std::vector<bool>. Converts it to a 
  * byte form representation of a bitset - that is each boolean is represented in
- * a single bit.
+ * a single bit, packed by ByteWriter::write_bits.
  */
 template<>
 inline std::vector<uint8_t> Serializable::serialize<std::vector<bool>>(std::vector<bool> vb){
-    std::vector<uint8_t> vec = Serializable::serialize<size_t>(vb.size());
-
-    uint8_t bm_byte = 0;
-    size_t pos = 0;
-    for(size_t i = 0; i < vb.size(); ++i){
-        if(pos == 8){
-            vec.push_back(bm_byte);
-            bm_byte = vb[i] & 1;
-            pos = 1;
-        } else {
-            bm_byte |= (vb[i] & 1) << (pos++);
-        }
-    }
-    if(pos > 0) vec.push_back(bm_byte);
-
+    std::vector<uint8_t> vec;
+    vec.reserve(ByteWriter::bits_size(vb.size()));
+    ByteWriter(vec).write_bits(vb);
     return vec;
 }
 
 template<>
 inline std::vector<bool> Serializable::deserialize<std::vector<bool>>(const std::vector<uint8_t>& data, size_t& pos) {
-    std::vector<bool> vec;
-
-    size_t len = Serializable::deserialize<size_t>(data, pos);
-    size_t byte_cnt = len / 8 + (len % 8 > 0 ? 1 : 0);
-    size_t byte_bound = byte_cnt + pos;
-     
-    size_t inner_pos = 0;
-    size_t data_pos = 0;
-    while(pos < byte_bound && data_pos < len) {
-        assert(pos < data.size());
-        vec.push_back(data[pos] & (1 << inner_pos++));
-        if(inner_pos == 8){
-            inner_pos = 0;
-            ++pos;
-        }
-        ++data_pos;
-    }
-    if(inner_pos != 0) ++pos;
-    return vec;
+    return ByteReader(data, pos).read_bits();
+}
+
+inline void Serializable::serialize_into(ByteWriter& w) const {
+    std::vector<uint8_t> serialized = this->serialize();
+    w.write_bytes(serialized.data(), serialized.size());
+}
+
+inline size_t Serializable::serialized_size() const {
+    return this->serialize().size();
+}
+
+inline std::vector<uint8_t> Serializable::_serialize_exact() const {
+    std::vector<uint8_t> serialized;
+    ByteWriter w(serialized);
+    w.reserve(this->serialized_size());
+    this->serialize_into(w);
+    return serialized;
 }
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <utility>
+#include <unordered_map>
+
+#include "util/serializable.h"
+#include "data/rower.h"
+#include "data/dataframe.h"
+#include "data/kvstore.h"
+
+/**************************************************************************
+ * HyperLogLog ::
+ * An approximate distinct counter. Values are hashed into 2^precision registers,
+ * each remembering the longest run of leading zeros seen, so memory is fixed no
+ * matter how many values are added. The relative error of count() is about
+ * 1.04 / sqrt(2^precision), eg. 0.8% for the default precision of 14 (16KB).
+ *
+ * Two sketches with the same precision are merged by taking the maximum of each
+ * register, which gives exactly the sketch of the union of their values.
+ */
+class HyperLogLog : public Serializable {
+private:
+    friend class Serializable;
+
+    /** The number of bits of the hash used to pick a register. */
+    uint8_t _precision;
+    /** One register per bucket, storing the maximum rank seen. */
+    std::vector<uint8_t> _registers;
+
+    /** Records the given 64 bit hash. */
+    void _add_hash(uint64_t h);
+
+public:
+    /** Constructs an empty sketch with 2^precision registers. The precision
+     * must be between 4 and 18. */
+    HyperLogLog(uint8_t precision = 14);
+
+    /** Adds a value to the sketch. */
+    void add(int val);
+    void add(double val);
+    void add(bool val);
+    void add(std::string_view val);
+
+    /** Returns the estimated number of distinct values added. */
+    size_t count() const;
+
+    /** Merges the other sketch into this one. Both must have the same precision. */
+    void merge(const HyperLogLog& other);
+
+    /** Resets the sketch to empty, keeping its precision. */
+    void clear();
+
+    size_t hash() const override;
+
+    bool equals(const Object *other) const override;
+
+    std::shared_ptr<Object> clone() const override;
+
+    std::vector<uint8_t> serialize() const override;
+
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
+};
+
+/**************************************************************************
+ * CountMinSketch ::
+ * An approximate frequency counter over strings. Each string increments one
+ * counter in each of depth rows of width counters, and its frequency is
+ * estimated as the smallest of those counters, so estimates are never too low
+ * and are too high by at most 2N / width with probability 1 - 2^-depth.
+ *
+ * Two sketches with the same dimensions are merged by adding their counters.
+ */
+class CountMinSketch : public Serializable {
+private:
+    friend class Serializable;
+
+    size_t _width;
+    size_t _depth;
+    /** depth rows of width counters, stored row after row. */
+    std::vector<uint64_t> _counters;
+    /** The sum of every count added. */
+    uint64_t _total;
+
+public:
+    /** Constructs an empty sketch with the given dimensions. */
+    CountMinSketch(size_t width = 2048, size_t depth = 4);
+
+    /** Adds the given count to the string's frequency, and returns the new
+     * estimated frequency of the string. */
+    uint64_t add(const std::string& val, uint64_t count = 1);
+
+    /** Returns the estimated frequency of the string. */
+    uint64_t estimate(const std::string& val) const;
+
+    /** Returns the sum of every count added. */
+    uint64_t total() const;
+
+    /** Merges the other sketch into this one. Both must have the same dimensions. */
+    void merge(const CountMinSketch& other);
+
+    /** Resets every counter to 0, keeping the dimensions. */
+    void clear();
+
+    size_t hash() const override;
+
+    bool equals(const Object *other) const override;
+
+    std::shared_ptr<Object> clone() const override;
+
+    std::vector<uint8_t> serialize() const override;
+
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
+};
+
+/**************************************************************************
+ * HeavyHitters ::
+ * Tracks the approximately k most frequent strings using a CountMinSketch for
+ * the frequencies and at most k candidate strings. A string replaces the least
+ * frequent candidate once its estimate passes it, so memory is O(k) plus the
+ * fixed size of the CountMinSketch no matter how many distinct strings there are.
+ */
+class HeavyHitters : public Serializable {
+private:
+    friend class Serializable;
+
+    /** The number of candidates kept. */
+    size_t _k;
+    CountMinSketch _cms;
+    /** The candidates and their estimated frequencies. */
+    std::unordered_map<std::string, uint64_t> _candidates;
+    /** The smallest estimate among the candidates, valid once there are k. */
+    uint64_t _min_estimate;
+
+    /** Recomputes _min_estimate from the candidates. */
+    void _update_min();
+
+public:
+    /** Constructs an empty tracker keeping k candidates. */
+    HeavyHitters(size_t k, size_t width = 2048, size_t depth = 4);
+
+    /** Adds an occurrence of the given string. */
+    void add(const std::string& val, uint64_t count = 1);
+
+    /** Returns the candidates and their estimated frequencies, most frequent
+     * first, with ties in alphabetical order. */
+    std::vector<std::pair<std::string, uint64_t>> top() const;
+
+    /** Merges the other tracker into this one. The candidates of both are
+     * re-estimated with the merged CountMinSketch and the best k are kept. */
+    void merge(const HeavyHitters& other);
+
+    /** Drops every candidate and count, keeping k and the dimensions. */
+    void clear();
+
+    size_t hash() const override;
+
+    bool equals(const Object *other) const override;
+
+    std::shared_ptr<Object> clone() const override;
+
+    std::vector<uint8_t> serialize() const override;
+
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
+};
+
+/**************************************************************************
+ * QuantileSketch ::
+ * An approximate quantile summary of numeric values, built from a stack of
+ * compactors. Level h holds values each standing for 2^h original values; when a
+ * level reaches capacity it is sorted and every other value is promoted to the
+ * level above. Memory is O(capacity * log(n / capacity)), and the rank error of
+ * quantile() is a small multiple of log2(n / capacity) / capacity.
+ *
+ * Two sketches with the same capacity are merged by concatenating their levels
+ * and compacting any level that is over capacity.
+ */
+class QuantileSketch : public Serializable {
+private:
+    friend class Serializable;
+
+    /** The number of values a level holds before it is compacted. */
+    size_t _capacity;
+    /** The number of values added. */
+    uint64_t _count;
+    /** Alternates which half of a level is promoted, so that compaction does
+     * not consistently bias the estimate up or down. */
+    bool _offset;
+    /** The compactors, lowest weight first. */
+    std::vector<std::vector<double>> _levels;
+
+    /** Compacts every level that is at or over capacity, bottom up. */
+    void _compact();
+
+public:
+    /** Constructs an empty sketch. */
+    QuantileSketch(size_t capacity = 256);
+
+    /** Adds a value to the sketch. NaNs are ignored. */
+    void add(double val);
+
+    /** Returns the number of values added. */
+    uint64_t count() const;
+
+    /** Returns the approximate value at the given quantile, between 0 and 1.
+     * Returns NaN if the sketch is empty. */
+    double quantile(double q) const;
+
+    /** Merges the other sketch into this one. Both must have the same capacity. */
+    void merge(const QuantileSketch& other);
+
+    /** Drops every value, keeping the capacity. */
+    void clear();
+
+    size_t hash() const override;
+
+    bool equals(const Object *other) const override;
+
+    std::shared_ptr<Object> clone() const override;
+
+    std::vector<uint8_t> serialize() const override;
+
+    void serialize_into(ByteWriter& w) const override;
+
+    size_t serialized_size() const override;
+};
+
+/** Stores the serialized sketch in the KVStore as a dataframe with a single
+ * string, so that other nodes can fetch it and merge it into their own. */
+template< typename S >
+inline void put_sketch(KVStore::Key k, const S& sketch) {
+    std::vector<uint8_t> bytes = sketch.serialize();
+    DataFrame::from_scalar(k, std::string(bytes.begin(), bytes.end()));
+}
+
+/** Fetches a sketch stored with put_sketch, waiting for it if it does not
+ * exist yet. */
+template< typename S >
+inline S get_sketch(const KVStore::Key& k) {
+    std::shared_ptr<DataFrame> df = KVStore::get_instance().get_or_wait(k);
+    std::string s = *df->get_string(0, 0);
+    std::vector<uint8_t> bytes(s.begin(), s.end());
+    size_t pos = 0;
+    return Serializable::deserialize<S>(bytes, pos);
+}
+
+/** Rower adding every value of one column of any type to a HyperLogLog.
+ * Clones start empty and are merged in join, which is associative. */
+class DistinctCountRower : public Rower {
+private:
+    size_t _col;
+    HyperLogLog _sketch;
+
+public:
+    DistinctCountRower(size_t col, uint8_t precision = 14);
+
+    bool accept(Row& r) override;
+
+    void join(std::shared_ptr<Rower> other) override;
+
+    bool join_is_associative() const override;
+
+    /** Returns the sketch built so far. */
+    const HyperLogLog& sketch() const;
+
+    size_t hash() const override;
+
+    bool equals(const Object *other) const override;
+
+    std::shared_ptr<Object> clone() const override;
+};
+
+/** Rower adding every value of one string column to a HeavyHitters tracker.
+ * Clones start empty and are merged in join. Which candidates survive a merge
+ * depends on the order of the merges, so the join is not associative, and the
+ * clones are joined in row order. */
+class HeavyHittersRower : public Rower {
+private:
+    size_t _col;
+    HeavyHitters _sketch;
+
+public:
+    HeavyHittersRower(size_t col, size_t k, size_t width = 2048, size_t depth = 4);
+
+    bool accept(Row& r) override;
+
+    void join(std::shared_ptr<Rower> other) override;
+
+    bool join_is_associative() const override;
+
+    /** Returns the tracker built so far. */
+    const HeavyHitters& sketch() const;
+
+    size_t hash() const override;
+
+    bool equals(const Object *other) const override;
+
+    std::shared_ptr<Object> clone() const override;
+};
+
+/** Rower adding every value of one int or float column to a QuantileSketch.
+ * Clones start empty and are merged in join. Which values a merge keeps
+ * depends on the order of the merges, so the join is not associative, and the
+ * clones are joined in row order. */
+class QuantileRower : public Rower {
+private:
+    size_t _col;
+    QuantileSketch _sketch;
+
+public:
+    QuantileRower(size_t col, size_t capacity = 256);
+
+    bool accept(Row& r) override;
+
+    void join(std::shared_ptr<Rower> other) override;
+
+    bool join_is_associative() const override;
+
+    /** Returns the sketch built so far. */
+    const QuantileSketch& sketch() const;
+
+    size_t hash() const override;
+
+    bool equals(const Object *other) const override;
+
+    std::shared_ptr<Object> clone() const override;
+};
+
+/** Specializations of deserialize_from for the sketches. Sketches are fetched
+ * from other nodes, so every size read is checked against the bytes remaining
+ * before anything is made for it, throwing a ShortSerializedDataException
+ * rather than reaching the checks of the constructors. */
+template<>
+inline HyperLogLog Serializable::deserialize_from<HyperLogLog>(ByteReader& r) {
+    uint8_t precision = r.read<uint8_t>();
+    if(precision < 4 || precision > 18 || (size_t(1) << precision) > r.remaining()) {
+        throw ShortSerializedDataException();
+    }
+    HyperLogLog hll(precision);
+    memcpy(hll._registers.data(), r.read_bytes(hll._registers.size()), hll._registers.size());
+    return hll;
+}
+
+template<>
+inline CountMinSketch Serializable::deserialize_from<CountMinSketch>(ByteReader& r) {
+    size_t width = r.read_size();
+    size_t depth = r.read_size();
+    if(width == 0 || depth == 0 || width > SIZE_MAX / depth
+            || width * depth > r.remaining() / sizeof(uint64_t)) {
+        throw ShortSerializedDataException();
+    }
+    CountMinSketch cms(width, depth);
+    cms._total = r.read<uint64_t>();
+    size_t bytes = cms._counters.size() * sizeof(uint64_t);
+    memcpy(cms._counters.data(), r.read_bytes(bytes), bytes);
+    return cms;
+}
+
+template<>
+inline HeavyHitters Serializable::deserialize_from<HeavyHitters>(ByteReader& r) {
+    size_t k = r.read_size();
+    HeavyHitters hh(k, 1, 1);
+    hh._cms = r.read<CountMinSketch>();
+    size_t cnt = r.read_size();
+    // there are at most k candidates, each a length, its bytes and a count
+    if(cnt > k || cnt > r.remaining() / (1 + sizeof(uint64_t))) throw ShortSerializedDataException();
+    for(size_t i = 0; i < cnt; ++i) {
+        std::string s = r.read<std::string>();
+        hh._candidates[std::move(s)] = r.read<uint64_t>();
+    }
+    hh._update_min();
+    return hh;
+}
+
+template<>
+inline QuantileSketch Serializable::deserialize_from<QuantileSketch>(ByteReader& r) {
+    size_t capacity = r.read_size();
+    if(capacity < 2) throw ShortSerializedDataException();
+    QuantileSketch qs(capacity);
+    qs._count = r.read<uint64_t>();
+    qs._offset = r.read<bool>();
+    // there is always a first level, and every level takes at least a byte
+    size_t levels = r.read_size();
+    if(levels == 0 || levels > r.remaining()) throw ShortSerializedDataException();
+    qs._levels.resize(levels);
+    for(size_t h = 0; h < qs._levels.size(); ++h) {
+        size_t len = r.read_size();
+        if(len > r.remaining() / sizeof(double)) throw ShortSerializedDataException();
+        const uint8_t *bytes = r.read_bytes(len * sizeof(double));
+        qs._levels[h].resize(len);
+        memcpy(qs._levels[h].data(), bytes, len * sizeof(double));
+    }
+    return qs;
+}
+
+/** Specializations of deserialize for the sketches. */
+template<>
+inline HyperLogLog Serializable::deserialize<HyperLogLog>(const std::vector<uint8_t>& data, size_t& pos) {
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<HyperLogLog>(r);
+}
+
+template<>
+inline CountMinSketch Serializable::deserialize<CountMinSketch>(const std::vector<uint8_t>& data, size_t& pos) {
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<CountMinSketch>(r);
+}
+
+template<>
+inline HeavyHitters Serializable::deserialize<HeavyHitters>(const std::vector<uint8_t>& data, size_t& pos) {
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<HeavyHitters>(r);
+}
+
+template<>
+inline QuantileSketch Serializable::deserialize<QuantileSketch>(const std::vector<uint8_t>& data, size_t& pos) {
+    ByteReader r(data, pos);
+    return Serializable::deserialize_from<QuantileSketch>(r);
+}
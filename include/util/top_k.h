@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+/**************************************************************************
+ * TopK ::
+ * A bounded heap which keeps the k best values pushed into it, where better(a, b)
+ * returns true if a is better than b. Memory is O(k) no matter how many values
+ * are pushed, and each push is O(log k). Worker threads each keep their own
+ * TopK, and merge them at the end, so the data never has to be sorted.
+ *
+ * The better function must be a strict weak ordering for the results to be
+ * meaningful. To get a deterministic result, it should break ties.
+ */
+template < typename T, typename Better = std::greater<T> >
+class TopK {
+private:
+    /** The maximum number of values kept. */
+    size_t _k;
+    /** A heap of the kept values, with the worst kept value at the front. */
+    std::vector<T> _heap;
+    /** Returns true if the first value is better than the second. */
+    Better _better;
+
+public:
+    /** Constructs an empty TopK. Nothing is reserved, since k may be far more
+     * than will ever be pushed, see reserve. */
+    TopK(size_t k, Better better = Better()) : _k(k), _heap(), _better(better) {}
+
+    /** Makes room for the values kept out of the given number pushed, which
+     * is at most k of them. */
+    inline void reserve(size_t pushed) {
+        _heap.reserve(std::min(_k, pushed));
+    }
+
+    /** Offers a value. It is kept if there are fewer than k values, or if it
+     * is better than the worst kept value, which is then dropped. */
+    inline void push(T val) {
+        if(_k == 0) return;
+        if(_heap.size() < _k) {
+            _heap.push_back(std::move(val));
+            std::push_heap(_heap.begin(), _heap.end(), _better);
+        } else if(_better(val, _heap.front())) {
+            std::pop_heap(_heap.begin(), _heap.end(), _better);
+            _heap.back() = std::move(val);
+            std::push_heap(_heap.begin(), _heap.end(), _better);
+        }
+    }
+
+    /** Offers every value kept by the other TopK, leaving it empty. */
+    inline void merge(TopK<T, Better>&& other) {
+        for(size_t i = 0; i < other._heap.size(); ++i) {
+            this->push(std::move(other._heap[i]));
+        }
+        other._heap.clear();
+    }
+
+    /** The number of values currently kept. */
+    inline size_t size() const {
+        return _heap.size();
+    }
+
+    /** Returns the kept values ordered best first, leaving this empty. */
+    inline std::vector<T> finish() {
+        std::sort_heap(_heap.begin(), _heap.end(), _better);
+        std::vector<T> out = std::move(_heap);
+        _heap = std::vector<T>();
+        return out;
+    }
+};
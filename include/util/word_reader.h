@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data/dataframe.h"
+#include "data/parallel_frame_builder.h"
+
+/** The fewest bytes of input worth giving a range, and so a thread, of their own. */
+#define WORD_MIN_RANGE_BYTES  (size_t(1) << 20)
+/** The bytes at the start of a range its words are counted in, to estimate
+ * how many words the whole range holds. */
+#define WORD_SAMPLE_BYTES     (size_t(1) << 16)
+
+/****************************************************************************
+ * WordReader::
+ *
+ * Reads the words of text files into a dataframe with a single string column,
+ * a word per row, in the order they appear. Words are separated by whitespace.
+ * Every file is mapped, and split at whitespace into ranges of about an even
+ * share of the bytes of all the files, so several files are read at once as
+ * well as the parts of a large one. Each range is tokenized on a thread of its
+ * own into its own segment of a ParallelFrameBuilder, which first reserves
+ * room for the words estimated from a sample at the start of the range, and
+ * the segments are spliced together in order.
+ */
+class WordReader {
+public:
+    /** Reads the words of every file, the files in the given order. Returns
+     * nullptr if any of them cannot be mapped. */
+    static std::shared_ptr<DataFrame> read(const std::vector<std::string>& paths);
+
+    /** Reads the words of the text in [begin, end), split between up to the
+     * given number of threads. */
+    static std::shared_ptr<DataFrame> parse(const char *begin, const char *end,
+                                            size_t max_threads = MAX_THREADS);
+
+private:
+    /** A part of the input tokenized by one thread. */
+    struct Range {
+        const char *begin;
+        const char *end;
+    };
+
+    /** Splits [begin, end) into the given number of ranges of about the same
+     * size, each ending at whitespace, and adds them to ranges. */
+    static void _split(const char *begin, const char *end, size_t parts,
+                       std::vector<Range>& ranges);
+
+    /** Tokenizes every range on its own thread, in order. */
+    static std::shared_ptr<DataFrame> _parse_ranges(const std::vector<Range>& ranges);
+
+    /** Returns the number of words in [begin, end). */
+    static size_t _count_words(const char *begin, const char *end);
+
+    /** Appends every word of the range onto the end of the segment. */
+    static void _parse_range(const Range& range, ParallelFrameBuilder::Segment& segment);
+};
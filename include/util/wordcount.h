@@ -1,7 +1,9 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "util/application.h"
 #include "data/dataframe.h"
@@ -46,11 +48,35 @@ private:
      is reponsible for cleaning up memory. */
         void join(std::shared_ptr<Rower> other) override;
 
+        /** Adding word counts is associative, so pmap can join in parallel. */
+        bool join_is_associative() const override;
+
+        /**
+         * Pre-sizes the word map for the given number of distinct words, so it
+         * does not rehash while it grows.
+         * @param words the expected number of distinct words.
+         */
+        void reserve(size_t words);
+
         /**
          * print the rower.
          */
         void print() const;
 
+        /**
+         * Returns the k most frequent words and their counts, most frequent
+         * first, with ties in alphabetical order. Uses a bounded heap, so the
+         * word map is never sorted.
+         * @param k the number of words to return.
+         */
+        std::vector<std::pair<std::string, size_t>> top_k(size_t k) const;
+
+        /**
+         * print the k most frequent words, most frequent first.
+         * @param k the number of words to print.
+         */
+        void print_top(size_t k) const;
+
         /**
          * clone the rower.
          * @return return the cloned result.
@@ -80,9 +106,9 @@ private:
      */
     const char *_server_ip;
     /*
-     * The file name that this word counter is working on.
+     * The names of the files that this word counter is working on.
      */
-    const char *_filename;
+    std::vector<std::string> _filenames;
     /**
      * The port of the server
      */
@@ -91,13 +117,19 @@ private:
      * The mode of this word counter.
      */
     Mode _mode;
+    /*
+     * The number of most frequent words the counter prints, or 0 to print
+     * every word.
+     */
+    size_t _top;
     /**
      * The key that is being tracked with the dataframe.
      */
     KVStore::Key _key;
 
     /**
-     * reads in the file as a column, and add into dataframe
+     * reads in the words of every file as a column with WordReader, and adds
+     * the dataframe to the KVStore
      */
     void _read_in_file() const;
 
@@ -0,0 +1,287 @@
+#include <cmath>
+#include <cstring>
+#include <charconv>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+
+#include "adapter/sor_reader.h"
+#include "adapter/sor_scanner.h"
+#include "util/mapped_file.h"
+#include "util/parallel.h"
+
+/** The column types from the least to the most general. */
+static const char *SOR_TYPES = "BIFS";
+
+/** Returns the more general of two column types. */
+static char wider(char a, char b) {
+    return strchr(SOR_TYPES, a) < strchr(SOR_TYPES, b) ? b : a;
+}
+
+/** Returns whether c is a space or a tab. */
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/** Skips a leading '+', which std::from_chars does not accept, unless a '-'
+ * follows it. Returns false if nothing is left after it. */
+static bool skip_plus(const char *&begin, const char *end) {
+    if(begin < end && *begin == '+') {
+        ++begin;
+        if(begin < end && *begin == '-') return false;
+    }
+    return begin < end;
+}
+
+/** Parses [begin, end) as an int. Returns false if it is not one, or is out
+ * of range. */
+static bool parse_int(const char *begin, const char *end, int& val) {
+    if(!skip_plus(begin, end)) return false;
+    auto res = std::from_chars(begin, end, val);
+    return res.ec == std::errc() && res.ptr == end;
+}
+
+/** Returns whether [begin, end), less any sign, starts like a decimal number,
+ * which std::from_chars does not check, as it also reads inf and nan. */
+static bool starts_decimal(const char *begin, const char *end) {
+    if(begin < end && *begin == '-') ++begin;
+    return begin < end && ((*begin >= '0' && *begin <= '9') || *begin == '.');
+}
+
+/** Parses [begin, end) as a double: an optional sign, digits with an optional
+ * decimal point, and an optional exponent. Returns false if it is not one, in
+ * which case out_of_range tells whether it only failed for being too large. */
+static bool parse_float(const char *begin, const char *end, double& val, bool& out_of_range) {
+    out_of_range = false;
+    if(!skip_plus(begin, end) || !starts_decimal(begin, end)) return false;
+    auto res = std::from_chars(begin, end, val, std::chars_format::general);
+    if(res.ptr != end) return false;
+    out_of_range = res.ec == std::errc::result_out_of_range;
+    return res.ec == std::errc();
+}
+
+static bool parse_float(const char *begin, const char *end, double& val) {
+    bool out_of_range;
+    return parse_float(begin, end, val, out_of_range);
+}
+
+// SorReader::Report
+double SorReader::Report::mbps() const {
+    return seconds <= 0 ? 0.0 : bytes / seconds / 1e6;
+}
+
+double SorReader::Report::rows_per_second() const {
+    return seconds <= 0 ? 0.0 : rows / seconds;
+}
+
+std::string SorReader::Report::to_string() const {
+    std::ostringstream out;
+    out <<std::fixed <<std::setprecision(2) <<bytes <<" bytes, " <<rows <<" rows in "
+        <<seconds <<"s on " <<threads <<" threads (" <<this->mbps() <<" MB/s, "
+        <<this->rows_per_second() <<" rows/s)";
+    return out.str();
+}
+
+// SorReader
+bool SorReader::_next_field(SorScanner& scan, const char *&s, Field& field) {
+    const char *end = scan.end();
+    while(s < end && *s != '<' && *s != '\n') s = scan.next();
+    if(s == end || *s == '\n') return false;
+
+    const char *p = s + 1;
+    while(p < end && is_blank(*p)) ++p;
+    field.quoted = p < end && *p == '"';
+    s = scan.next();
+    if(field.quoted) {
+        // s is the opening quote, so look for the closing one
+        s = scan.next();
+        while(s < end && *s != '"' && *s != '\n') s = scan.next();
+        if(s == end || *s == '\n') return false;
+        field.begin = p + 1;
+        field.end = s;
+        s = scan.next();
+    }
+    while(s < end && *s != '>' && *s != '\n') s = scan.next();
+    if(s == end || *s == '\n') return false;
+    if(!field.quoted) {
+        field.begin = p;
+        field.end = s;
+        while(field.end > field.begin && is_blank(field.end[-1])) --field.end;
+    }
+    s = scan.next();
+    return true;
+}
+
+char SorReader::_field_type(const Field& field) {
+    if(field.quoted) return 'S';
+    if(field.begin == field.end) return 0;
+    if(field.end - field.begin == 1 && (*field.begin == '0' || *field.begin == '1')) return 'B';
+    int i;
+    if(parse_int(field.begin, field.end, i)) return 'I';
+    double d;
+    bool out_of_range;
+    // ints too large for an int are floats
+    if(parse_float(field.begin, field.end, d, out_of_range) || out_of_range) return 'F';
+    return 'S';
+}
+
+size_t SorReader::_thread_count(size_t bytes, size_t max_threads) {
+    return std::max<size_t>(1, std::min(max_threads, bytes / SOR_MIN_THREAD_BYTES));
+}
+
+double SorReader::_bytes_per_line(const char *begin, const char *end) {
+    size_t size = end - begin;
+    size_t bytes = 0;
+    size_t lines = 0;
+    for(size_t point = 0; point < SOR_SAMPLE_POINTS; ++point) {
+        const char *p = begin + size * point / SOR_SAMPLE_POINTS;
+        // start at the first whole line after the point
+        if(p > begin) {
+            const char *eol = static_cast<const char *>(memchr(p - 1, '\n', end - p + 1));
+            p = eol ? eol + 1 : end;
+        }
+        const char *start = p;
+        size_t line = 0;
+        for(; line < SOR_SAMPLE_LINES && p < end; ++line) {
+            const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+            p = eol ? eol + 1 : end;
+        }
+        bytes += p - start;
+        lines += line;
+    }
+    return lines == 0 ? 1.0 : double(bytes) / lines;
+}
+
+size_t SorReader::estimate_rows(const char *begin, const char *end) {
+    return size_t(std::ceil((end - begin) / _bytes_per_line(begin, end)));
+}
+
+std::unique_ptr<Schema> SorReader::_infer_schema(const char *begin, const char *end) {
+    std::string types;
+    SorScanner scan(begin, end);
+    const char *s = scan.next();
+    for(size_t line = 0; line < SOR_SCHEMA_LINES && s < end; ++line) {
+        Field field;
+        for(size_t c = 0; _next_field(scan, s, field); ++c) {
+            if(c == types.size()) types += 'B'; // the type of a column with no values
+            char type = _field_type(field);
+            if(type) types[c] = wider(types[c], type);
+        }
+        // s is at the end of the line
+        s = scan.next();
+    }
+    return std::make_unique<Schema>(types);
+}
+
+void SorReader::_parse_range(const char *begin, const char *end, const Schema& schema,
+                             ParallelFrameBuilder::Segment& segment) {
+    size_t width = schema.width();
+    SorScanner scan(begin, end);
+    const char *s = scan.next();
+    while(s < end) {
+        Field field;
+        size_t c = 0;
+        for(; c < width && _next_field(scan, s, field); ++c) {
+            // each field is parsed straight as its column's type
+            switch(schema.col_type(c)) {
+                case 'B':
+                    {
+                        bool ok = !field.quoted && field.end - field.begin == 1
+                            && (*field.begin == '0' || *field.begin == '1');
+                        segment.push_back(c, ok ? std::optional<bool>(*field.begin == '1') : std::nullopt);
+                        break;
+                    }
+                case 'I':
+                    {
+                        int i;
+                        bool ok = !field.quoted && parse_int(field.begin, field.end, i);
+                        segment.push_back(c, ok ? std::optional<int>(i) : std::nullopt);
+                        break;
+                    }
+                case 'F':
+                    {
+                        double d;
+                        bool ok = !field.quoted && parse_float(field.begin, field.end, d);
+                        segment.push_back(c, ok ? std::optional<double>(d) : std::nullopt);
+                        break;
+                    }
+                case 'S':
+                    {
+                        bool ok = field.quoted || field.begin != field.end;
+                        segment.push_back(c, ok ? std::optional<std::string>(std::in_place, field.begin, field.end)
+                                                : std::nullopt);
+                        break;
+                    }
+            }
+        }
+        // skip the fields past the width of the schema
+        while(s < end && *s != '\n') s = scan.next();
+        // lines without any field are skipped, short lines are padded with missing values
+        for(; c > 0 && c < width; ++c) {
+            switch(schema.col_type(c)) {
+                case 'B':
+                    segment.push_back(c, std::optional<bool>());
+                    break;
+                case 'I':
+                    segment.push_back(c, std::optional<int>());
+                    break;
+                case 'F':
+                    segment.push_back(c, std::optional<double>());
+                    break;
+                case 'S':
+                    segment.push_back(c, std::optional<std::string>());
+                    break;
+            }
+        }
+        s = scan.next();
+    }
+}
+
+std::shared_ptr<DataFrame> SorReader::_parse_lines(const char *begin, const char *end,
+                                                   const Schema& schema, size_t max_threads) {
+    size_t size = end - begin;
+    size_t thread_cnt = _thread_count(size, max_threads);
+
+    // split at the line boundary after each even share of the bytes
+    std::vector<const char *> bounds(thread_cnt + 1, end);
+    bounds[0] = begin;
+    for(size_t t = 1; t < thread_cnt; ++t) {
+        const char *p = std::max(bounds[t - 1], begin + size * t / thread_cnt);
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        bounds[t] = eol ? eol + 1 : end;
+    }
+
+    double line_bytes = _bytes_per_line(begin, end);
+    ParallelFrameBuilder builder(schema);
+    builder.set_workers(thread_cnt);
+    parallel_for(thread_cnt, [&bounds, &schema, &builder, line_bytes](size_t t){
+        // a sixteenth more than the estimate, as lines vary in length
+        size_t rows = size_t((bounds[t + 1] - bounds[t]) / line_bytes);
+        builder.segment(t).reserve(rows + rows / 16 + 1);
+        _parse_range(bounds[t], bounds[t + 1], schema, builder.segment(t));
+    });
+    auto df = builder.finish();
+    df->shrink_to_fit();
+    return df;
+}
+
+std::shared_ptr<DataFrame> SorReader::parse(const char *begin, const char *end, size_t max_threads) {
+    std::unique_ptr<Schema> schema = _infer_schema(begin, end);
+    return _parse_lines(begin, end, *schema, max_threads);
+}
+
+std::shared_ptr<DataFrame> SorReader::read(const std::string& path, Report *report) {
+    auto start = std::chrono::steady_clock::now();
+    auto file = MappedFile::open(path);
+    if(!file) return nullptr;
+    file->advise_sequential(0, file->size());
+    const char *begin = reinterpret_cast<const char *>(file->data());
+    auto df = SorReader::parse(begin, begin + file->size());
+    if(report) {
+        report->bytes = file->size();
+        report->rows = df->nrows();
+        report->threads = _thread_count(file->size(), MAX_THREADS);
+        report->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return df;
+}
@@ -0,0 +1,102 @@
+#include <cstring>
+
+#include "adapter/sor_stream.h"
+#include "adapter/sor_reader.h"
+
+SorStream::SorStream(std::shared_ptr<MappedFile> file, size_t group_rows, size_t max_pending)
+    : _file(file), _schema(), _group_rows(std::max<size_t>(1, group_rows)),
+      _max_pending(max_pending), _mutex(), _cv(), _pending(), _groups(0), _rows(0),
+      _done(false), _closing(false), _parser() {
+    const char *begin = reinterpret_cast<const char *>(_file->data());
+    _schema = SorReader::_infer_schema(begin, begin + _file->size());
+}
+
+SorStream::~SorStream() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closing = true;
+    }
+    _cv.notify_all();
+    if(_parser.joinable()) _parser.join();
+}
+
+std::shared_ptr<SorStream> SorStream::open(const std::string& path, size_t group_rows,
+                                           size_t max_pending) {
+    auto file = MappedFile::open(path);
+    if(!file) return nullptr;
+    file->advise_sequential(0, file->size());
+    auto stream = std::shared_ptr<SorStream>(new SorStream(file, group_rows, max_pending));
+    // started once the stream is constructed, as it parses into its members
+    stream->_parser = std::thread(&SorStream::_parse, stream.get());
+    return stream;
+}
+
+void SorStream::_parse() {
+    const char *begin = reinterpret_cast<const char *>(_file->data());
+    const char *end = begin + _file->size();
+    const char *start = begin;
+    while(start < end) {
+        // the group ends after its last line
+        const char *stop = start;
+        for(size_t line = 0; line < _group_rows && stop < end; ++line) {
+            const char *eol = static_cast<const char *>(memchr(stop, '\n', end - stop));
+            stop = eol ? eol + 1 : end;
+        }
+        auto group = SorReader::_parse_lines(start, stop, *_schema, MAX_THREADS);
+        // the values were copied out, so the pages are not needed again
+        _file->advise_dontneed(start - begin, stop - start);
+        start = stop;
+        if(group->nrows() > 0 && !this->_publish(group)) return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _done = true;
+    }
+    _cv.notify_all();
+}
+
+bool SorStream::_publish(std::shared_ptr<DataFrame> group) {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this]{ return _closing || _max_pending == 0 || _pending.size() < _max_pending; });
+        if(_closing) return false;
+        _rows += group->nrows();
+        ++_groups;
+        _pending.push_back(group);
+    }
+    _cv.notify_all();
+    return true;
+}
+
+const Schema& SorStream::get_schema() const {
+    return *_schema;
+}
+
+std::shared_ptr<DataFrame> SorStream::next() {
+    std::shared_ptr<DataFrame> group;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this]{ return !_pending.empty() || _done; });
+        if(_pending.empty()) return nullptr;
+        group = _pending.front();
+        _pending.pop_front();
+    }
+    // there is room for another group
+    _cv.notify_all();
+    return group;
+}
+
+size_t SorStream::committed_rows() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _rows;
+}
+
+size_t SorStream::committed_groups() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _groups;
+}
+
+bool SorStream::done() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _done;
+}
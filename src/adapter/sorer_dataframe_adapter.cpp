@@ -1,121 +1,125 @@
-#include <iostream>
-#include <exception>
 #include <cstring>
+#include <climits>
+#include <cstdlib>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
-#include "libsorer.h"
 #include "adapter/sorer_dataframe_adapter.h"
-#include "data/schema.h"
+#include "adapter/sor_reader.h"
+#include "data/frame_file.h"
+#include "util/mapped_file.h"
+#include "util/parallel.h"
 
 namespace SorerDataframeAdapter {
     // anonymous namespace to simulate private
     namespace {
-        /** Given a parser initialized with a file, creates a schema from the
-         * file as identified by the parser. */
-        std::unique_ptr<Schema> initialize_schema(SoRParser& parser) {
-            // initialize schema
-            std::string s_format;
-            for(size_t i = 0; i < parser.ncols(); ++i){
-                switch(parser.getColType(i)) {
-                    case SoRType::BOOL:
-                        s_format += 'B';
-                        break;
-                    case SoRType::INT:
-                        s_format += 'I';
-                        break;
-                    case SoRType::FLOAT:
-                        s_format += 'F';
-                        break;
-                    case SoRType::STRING:
-                        s_format += 'S';
-                        break;
-                }
-            }
-            return std::make_unique<Schema>(s_format.c_str());
-        }
+        /** The number of bytes of the file hashed on each thread. */
+        constexpr size_t HASH_CHUNK_BYTES = size_t(1) << 22;
+
+        /** Identifies the file a cache was written from. It is written after
+         * the frame in the cache, where FrameFile does not look. */
+        struct CacheKey {
+            char magic[8];
+            uint64_t path_hash;
+            uint64_t size;
+            int64_t mtime_sec;
+            int64_t mtime_nsec;
+            uint64_t content_hash;
+        };
+
+        /** The magic at the start of a CacheKey. */
+        constexpr char CACHE_KEY_MAGIC[8] = {'L', 'T', 'G', 'T', 'S', 'R', 'C', 'K'};
 
-        /** Given an initialized parser, row, and column, attempts to parse
-         * it as an integer. */
-        std::optional<int> parse_int(SoRParser& parser, size_t col, size_t row) {
-            auto val = parser.getColIdx(col, row);
-            if(val) {
-                return std::optional<int>(std::stoi(*val));
+        /** Hashes len bytes, 8 at a time, with a multiply and rotate. */
+        uint64_t hash_bytes(const uint8_t *bytes, size_t len) {
+            uint64_t h = 0x9E3779B97F4A7C15ull ^ len;
+            size_t i = 0;
+            for(; i + 8 <= len; i += 8) {
+                uint64_t w;
+                memcpy(&w, bytes + i, sizeof(w));
+                h = ((h ^ w) * 0xFF51AFD7ED558CCDull);
+                h = (h << 31) | (h >> 33);
             }
-            return std::nullopt;
+            for(; i < len; ++i) h = (h ^ bytes[i]) * 0x100000001B3ull;
+            return h;
         }
 
-        /** Given an initialized parser, row, and column, attempts to parse
-         * it as a boolean. */
-        std::optional<bool> parse_bool(SoRParser& parser, size_t col, size_t row) {
-            auto val = parser.getColIdx(col, row);
-            if(val) {
-                return std::optional<bool>(std::stoi(*val));
-            }
-            return std::nullopt;
+        /** Hashes the contents of the file, a chunk on each thread. Returns
+         * false if the file cannot be mapped. */
+        bool hash_file(const std::string& filename, uint64_t& hash) {
+            auto file = MappedFile::open(filename);
+            if(!file) return false;
+            file->advise_sequential(0, file->size());
+            std::vector<uint64_t> hashes((file->size() + HASH_CHUNK_BYTES - 1) / HASH_CHUNK_BYTES);
+            parallel_for(hashes.size(), [&file, &hashes](size_t c){
+                size_t start = c * HASH_CHUNK_BYTES;
+                hashes[c] = hash_bytes(file->data() + start, std::min(HASH_CHUNK_BYTES, file->size() - start));
+            });
+            hash = file->size();
+            for(size_t c = 0; c < hashes.size(); ++c) hash = hash * 31 + hashes[c];
+            return true;
         }
 
-        /** Given an initialized parser, row, and column, attempts to parse
-         * it as a double. */
-        std::optional<double> parse_float(SoRParser& parser, size_t col, size_t row) {
-            auto val = parser.getColIdx(col, row);
-            if(val) {
-                return std::optional<double>(std::stod(*val));
-            }
-            return std::nullopt;
+        /** Fills in the key of the file as it is now. Returns false if the
+         * file cannot be read. */
+        bool key_of(const std::string& filename, CacheKey& key) {
+            memset(&key, 0, sizeof(key));
+            memcpy(key.magic, CACHE_KEY_MAGIC, sizeof(key.magic));
+            char path[PATH_MAX];
+            struct stat st;
+            if(!realpath(filename.c_str(), path) || stat(filename.c_str(), &st) != 0) return false;
+            key.path_hash = hash_bytes(reinterpret_cast<const uint8_t *>(path), strlen(path));
+            key.size = st.st_size;
+            key.mtime_sec = st.st_mtim.tv_sec;
+            key.mtime_nsec = st.st_mtim.tv_nsec;
+            return hash_file(filename, key.content_hash);
         }
 
-        /** Given an initialized parser, row, and column, attempts to parse
-         * it as a string. */
-        std::optional<std::string> parse_string(SoRParser& parser, size_t col, size_t row) {
-            // already in the correct format
-            return parser.getColIdx(col, row);
+        /** Maps the cache if it was written from the file with the given key.
+         * Returns nullptr otherwise. */
+        std::shared_ptr<DataFrame> read_cache(const std::string& cache, const CacheKey& key) {
+            int fd = open(cache.c_str(), O_RDONLY);
+            if(fd < 0) return nullptr;
+            struct stat st;
+            CacheKey cached;
+            bool ok = fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(cached)
+                && pread(fd, &cached, sizeof(cached), st.st_size - sizeof(cached)) == sizeof(cached);
+            close(fd);
+            if(!ok || memcmp(&cached, &key, sizeof(key)) != 0) return nullptr;
+            return DataFrame::open_mmap(cache);
         }
 
-        /** Given an intialized parser, the indice of a row, and a Row object
-         * constructed from the schema identified by the parser, attempts 
-         * to parse from the file into the row object. Returns true on success,
-         * false otherwise (including EOF). */
-        bool parse_and_fill_row(SoRParser& parser, size_t row, Row& row_obj){
-            row_obj.set_index(row);
-            for(size_t c = 0; c < parser.ncols(); ++c) {
-                // They use C++ exceptions to signal EOF
-                try {
-                    switch(parser.getColType(c)) {
-                        case SoRType::INT:
-                            row_obj.set(c, parse_int(parser, c, row));
-                            break;
-                        case SoRType::BOOL:
-                            row_obj.set(c, parse_bool(parser, c, row));
-                            break;
-                        case SoRType::FLOAT:
-                            row_obj.set(c, parse_float(parser, c, row));
-                            break;
-                        case SoRType::STRING:
-                            row_obj.set(c, parse_string(parser, c, row));
-                            break;
-                    }
-                } catch(std::exception& e) {
-                    const char *e_str = e.what();
-                    if(strcmp(e_str, "Invalid offset") != 0){
-                        std::cerr <<"Unexpected Exception: " <<e_str <<std::endl;
-                    }
-                    return false;
-                }
-            }
-            return true;
+        /** Saves the dataframe followed by the key over the cache, which
+         * FrameFile::save replaces whole, so that readers only ever see a whole
+         * cache. Failures are ignored, leaving the file to be parsed again. */
+        void write_cache(const std::string& cache, const CacheKey& key, const DataFrame& df) {
+            FrameFile::save(df, cache, &key, sizeof(key));
         }
     } // anonymous namespace
 
-    std::shared_ptr<DataFrame> parse_file(const std::string& filename) {
-        SoRParser parser;
-        if(!parser.initialize(filename)) return nullptr;
-
-        auto df = std::make_shared<DataFrame>(initialize_schema(parser));
+    std::string cache_path(const std::string& filename) {
+        return filename + SOR_CACHE_SUFFIX;
+    }
 
-        Row row(df->get_schema());
-        size_t r = 0;
-        while(parse_and_fill_row(parser, r++, row)){
-            df->add_row(row);
+    std::shared_ptr<DataFrame> parse_file(const std::string& filename, bool compute_stats,
+                                          bool force_parse, SorReader::Report *report) {
+        CacheKey key;
+        bool keyed = key_of(filename, key);
+        std::string cache = cache_path(filename);
+        if(keyed && !force_parse) {
+            auto df = read_cache(cache, key);
+            if(df) {
+                if(compute_stats && df->ncols() > 0 && !df->get_stats(0)) df->compute_stats();
+                return df;
+            }
         }
+
+        auto df = SorReader::read(filename, report);
+        if(!df) return nullptr;
+        if(compute_stats) df->compute_stats();
+        if(keyed) write_cache(cache, key, *df);
         return df;
     }
 }
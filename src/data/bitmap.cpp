@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <iterator>
+
+#include "data/bitmap.h"
+
+// Container
+bool Bitmap::Container::is_bitset() const {
+    return !words.empty();
+}
+
+bool Bitmap::Container::contains(uint16_t low) const {
+    if(is_bitset()) return (words[low >> 6] >> (low & 63)) & 1;
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+bool Bitmap::Container::add(uint16_t low) {
+    if(is_bitset()) {
+        uint64_t bit = uint64_t(1) << (low & 63);
+        if(words[low >> 6] & bit) return false;
+        words[low >> 6] |= bit;
+    } else if(array.empty() || array.back() < low) {
+        // common case when values are added in order
+        array.push_back(low);
+    } else {
+        auto iter = std::lower_bound(array.begin(), array.end(), low);
+        if(*iter == low) return false;
+        array.insert(iter, low);
+    }
+    ++cardinality;
+    if(cardinality == BITMAP_ARRAY_MAX + 1) normalize();
+    return true;
+}
+
+bool Bitmap::Container::remove(uint16_t low) {
+    if(is_bitset()) {
+        uint64_t bit = uint64_t(1) << (low & 63);
+        if(!(words[low >> 6] & bit)) return false;
+        words[low >> 6] &= ~bit;
+    } else {
+        auto iter = std::lower_bound(array.begin(), array.end(), low);
+        if(iter == array.end() || *iter != low) return false;
+        array.erase(iter);
+    }
+    --cardinality;
+    if(cardinality == BITMAP_ARRAY_MAX) normalize();
+    return true;
+}
+
+void Bitmap::Container::normalize() {
+    if(cardinality > BITMAP_ARRAY_MAX && !is_bitset()) {
+        words.assign(1024, 0);
+        for(size_t i = 0; i < array.size(); ++i) {
+            words[array[i] >> 6] |= uint64_t(1) << (array[i] & 63);
+        }
+        array = std::vector<uint16_t>();
+    } else if(cardinality <= BITMAP_ARRAY_MAX && is_bitset()) {
+        array.clear();
+        array.reserve(cardinality);
+        for(size_t w = 0; w < words.size(); ++w) {
+            uint64_t word = words[w];
+            while(word) {
+                array.push_back(uint16_t(w * 64 + __builtin_ctzll(word)));
+                word &= word - 1;
+            }
+        }
+        words = std::vector<uint64_t>();
+    }
+}
+
+bool Bitmap::Container::operator==(const Container& other) const {
+    return key == other.key && cardinality == other.cardinality
+        && array == other.array && words == other.words;
+}
+
+// Bitmap
+const Bitmap::Container *Bitmap::_find(uint16_t key) const {
+    auto iter = std::lower_bound(_containers.begin(), _containers.end(), key,
+                                 [](const Container& c, uint16_t k){ return c.key < k; });
+    if(iter == _containers.end() || iter->key != key) return nullptr;
+    return &*iter;
+}
+
+Bitmap::Container& Bitmap::_find_or_insert(uint16_t key) {
+    if(!_containers.empty() && _containers.back().key == key) return _containers.back();
+    auto iter = std::lower_bound(_containers.begin(), _containers.end(), key,
+                                 [](const Container& c, uint16_t k){ return c.key < k; });
+    if(iter == _containers.end() || iter->key != key) {
+        iter = _containers.insert(iter, Container());
+        iter->key = key;
+    }
+    return *iter;
+}
+
+Bitmap::Container Bitmap::_and(const Container& a, const Container& b) {
+    Container out;
+    out.key = a.key;
+    if(a.is_bitset() && b.is_bitset()) {
+        out.words.resize(1024);
+        for(size_t w = 0; w < 1024; ++w) {
+            out.words[w] = a.words[w] & b.words[w];
+            out.cardinality += __builtin_popcountll(out.words[w]);
+        }
+        out.normalize();
+    } else if(a.is_bitset() || b.is_bitset()) {
+        const Container& arr = a.is_bitset() ? b : a;
+        const Container& bits = a.is_bitset() ? a : b;
+        for(size_t i = 0; i < arr.array.size(); ++i) {
+            if(bits.contains(arr.array[i])) out.array.push_back(arr.array[i]);
+        }
+        out.cardinality = out.array.size();
+    } else {
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                              std::back_inserter(out.array));
+        out.cardinality = out.array.size();
+    }
+    return out;
+}
+
+Bitmap::Container Bitmap::_or(const Container& a, const Container& b) {
+    Container out;
+    out.key = a.key;
+    if(!a.is_bitset() && !b.is_bitset()) {
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                       std::back_inserter(out.array));
+        out.cardinality = out.array.size();
+        out.normalize();
+        return out;
+    }
+
+    out.words = a.is_bitset() ? a.words : b.words;
+    const Container& other = a.is_bitset() ? b : a;
+    if(other.is_bitset()) {
+        for(size_t w = 0; w < 1024; ++w) out.words[w] |= other.words[w];
+    } else {
+        for(size_t i = 0; i < other.array.size(); ++i) {
+            out.words[other.array[i] >> 6] |= uint64_t(1) << (other.array[i] & 63);
+        }
+    }
+    for(size_t w = 0; w < 1024; ++w) out.cardinality += __builtin_popcountll(out.words[w]);
+    return out;
+}
+
+Bitmap::Container Bitmap::_and_not(const Container& a, const Container& b) {
+    Container out;
+    out.key = a.key;
+    if(!a.is_bitset()) {
+        if(b.is_bitset()) {
+            for(size_t i = 0; i < a.array.size(); ++i) {
+                if(!b.contains(a.array[i])) out.array.push_back(a.array[i]);
+            }
+        } else {
+            std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                                std::back_inserter(out.array));
+        }
+        out.cardinality = out.array.size();
+        return out;
+    }
+
+    out.words = a.words;
+    if(b.is_bitset()) {
+        for(size_t w = 0; w < 1024; ++w) out.words[w] &= ~b.words[w];
+    } else {
+        for(size_t i = 0; i < b.array.size(); ++i) {
+            out.words[b.array[i] >> 6] &= ~(uint64_t(1) << (b.array[i] & 63));
+        }
+    }
+    for(size_t w = 0; w < 1024; ++w) out.cardinality += __builtin_popcountll(out.words[w]);
+    out.normalize();
+    return out;
+}
+
+Bitmap Bitmap::range(uint32_t start, uint32_t end) {
+    Bitmap bm;
+    uint64_t val = start;
+    while(val < end) {
+        uint16_t key = val >> 16;
+        uint64_t con_end = std::min<uint64_t>(end, (uint64_t(key) + 1) << 16);
+        Container con;
+        con.key = key;
+        con.cardinality = con_end - val;
+        if(con.cardinality > BITMAP_ARRAY_MAX) {
+            con.words.assign(1024, 0);
+            for(uint64_t v = val; v < con_end; ++v) {
+                con.words[(v & 0xFFFF) >> 6] |= uint64_t(1) << (v & 63);
+            }
+        } else {
+            for(uint64_t v = val; v < con_end; ++v) con.array.push_back(uint16_t(v));
+        }
+        bm._containers.push_back(std::move(con));
+        val = con_end;
+    }
+    return bm;
+}
+
+void Bitmap::add(uint32_t val) {
+    _find_or_insert(val >> 16).add(val & 0xFFFF);
+}
+
+bool Bitmap::remove(uint32_t val) {
+    uint16_t key = val >> 16;
+    auto iter = std::lower_bound(_containers.begin(), _containers.end(), key,
+                                 [](const Container& c, uint16_t k){ return c.key < k; });
+    if(iter == _containers.end() || iter->key != key) return false;
+    if(!iter->remove(val & 0xFFFF)) return false;
+    if(iter->cardinality == 0) _containers.erase(iter);
+    return true;
+}
+
+bool Bitmap::contains(uint32_t val) const {
+    const Container *con = _find(val >> 16);
+    return con && con->contains(val & 0xFFFF);
+}
+
+size_t Bitmap::cardinality() const {
+    size_t card = 0;
+    for(size_t c = 0; c < _containers.size(); ++c) {
+        card += _containers[c].cardinality;
+    }
+    return card;
+}
+
+bool Bitmap::empty() const {
+    return _containers.empty();
+}
+
+uint32_t Bitmap::min() const {
+    const Container& con = _containers.front();
+    uint32_t high = uint32_t(con.key) << 16;
+    if(!con.is_bitset()) return high | con.array.front();
+    size_t w = 0;
+    while(!con.words[w]) ++w;
+    return high | uint32_t(w * 64 + __builtin_ctzll(con.words[w]));
+}
+
+uint32_t Bitmap::max() const {
+    const Container& con = _containers.back();
+    uint32_t high = uint32_t(con.key) << 16;
+    if(!con.is_bitset()) return high | con.array.back();
+    size_t w = con.words.size() - 1;
+    while(!con.words[w]) --w;
+    return high | uint32_t(w * 64 + 63 - __builtin_clzll(con.words[w]));
+}
+
+Bitmap Bitmap::operator&(const Bitmap& other) const {
+    Bitmap out;
+    size_t i = 0, j = 0;
+    while(i < _containers.size() && j < other._containers.size()) {
+        const Container& a = _containers[i];
+        const Container& b = other._containers[j];
+        if(a.key < b.key) {
+            ++i;
+        } else if(b.key < a.key) {
+            ++j;
+        } else {
+            Container con = _and(a, b);
+            if(con.cardinality > 0) out._containers.push_back(std::move(con));
+            ++i;
+            ++j;
+        }
+    }
+    return out;
+}
+
+Bitmap Bitmap::operator|(const Bitmap& other) const {
+    Bitmap out;
+    size_t i = 0, j = 0;
+    while(i < _containers.size() || j < other._containers.size()) {
+        if(j == other._containers.size()
+                || (i < _containers.size() && _containers[i].key < other._containers[j].key)) {
+            out._containers.push_back(_containers[i++]);
+        } else if(i == _containers.size() || other._containers[j].key < _containers[i].key) {
+            out._containers.push_back(other._containers[j++]);
+        } else {
+            out._containers.push_back(_or(_containers[i++], other._containers[j++]));
+        }
+    }
+    return out;
+}
+
+Bitmap Bitmap::and_not(const Bitmap& other) const {
+    Bitmap out;
+    size_t j = 0;
+    for(size_t i = 0; i < _containers.size(); ++i) {
+        const Container& a = _containers[i];
+        while(j < other._containers.size() && other._containers[j].key < a.key) ++j;
+        if(j < other._containers.size() && other._containers[j].key == a.key) {
+            Container con = _and_not(a, other._containers[j]);
+            if(con.cardinality > 0) out._containers.push_back(std::move(con));
+        } else {
+            out._containers.push_back(a);
+        }
+    }
+    return out;
+}
+
+Bitmap Bitmap::negate(uint32_t universe) const {
+    return Bitmap::range(0, universe).and_not(*this);
+}
+
+std::vector<uint32_t> Bitmap::to_vector() const {
+    std::vector<uint32_t> vals;
+    vals.reserve(this->cardinality());
+    this->for_each([&vals](uint32_t v){ vals.push_back(v); });
+    return vals;
+}
+
+bool Bitmap::operator==(const Bitmap& other) const {
+    return _containers == other._containers;
+}
+
+bool Bitmap::equals(const Object *other) const {
+    auto obm = dynamic_cast<const Bitmap *>(other);
+    if(obm) return *this == *obm;
+    return false;
+}
+
+size_t Bitmap::hash() const {
+    size_t hash = _containers.size();
+    for(size_t c = 0; c < _containers.size(); ++c) {
+        hash = hash * 31 + (size_t(_containers[c].key) << 20) + _containers[c].cardinality;
+    }
+    return hash;
+}
+
+std::shared_ptr<Object> Bitmap::clone() const {
+    return std::make_shared<Bitmap>(*this);
+}
+
+std::vector<uint8_t> Bitmap::serialize() const {
+    return this->_serialize_exact();
+}
+
+void Bitmap::serialize_into(ByteWriter& w) const {
+    w.write_size(_containers.size());
+    for(size_t c = 0; c < _containers.size(); ++c) {
+        const Container& con = _containers[c];
+        w.write<uint16_t>(con.key);
+        w.write_size(con.cardinality);
+        if(con.is_bitset()) {
+            w.write_bytes(con.words.data(), con.words.size() * sizeof(uint64_t));
+        } else {
+            w.write_bytes(con.array.data(), con.array.size() * sizeof(uint16_t));
+        }
+    }
+}
+
+size_t Bitmap::serialized_size() const {
+    size_t size = sizeof(size_t);
+    for(size_t c = 0; c < _containers.size(); ++c) {
+        const Container& con = _containers[c];
+        size += sizeof(uint16_t) + sizeof(size_t)
+            + (con.is_bitset() ? con.words.size() * sizeof(uint64_t) : con.array.size() * sizeof(uint16_t));
+    }
+    return size;
+}
@@ -0,0 +1,137 @@
+#include <cassert>
+
+#include "data/bitmap_index.h"
+
+// EqualsPredicate
+EqualsPredicate::EqualsPredicate(size_t col, int value) : _col(col), _value(value) {}
+
+EqualsPredicate::EqualsPredicate(size_t col, bool value) : _col(col), _value(value) {}
+
+EqualsPredicate::EqualsPredicate(size_t col, std::string value) : _col(col), _value(std::move(value)) {}
+
+EqualsPredicate::EqualsPredicate(size_t col, const char *value) : _col(col), _value(std::string(value)) {}
+
+size_t EqualsPredicate::col() const {
+    return _col;
+}
+
+const EqualsPredicate::Value& EqualsPredicate::value() const {
+    return _value;
+}
+
+size_t EqualsPredicate::hash() const {
+    return _col ^ (std::hash<EqualsPredicate::Value>()(_value) << 1);
+}
+
+bool EqualsPredicate::equals(const Object *other) const {
+    auto oep = dynamic_cast<const EqualsPredicate *>(other);
+    if(oep) return _col == oep->_col && _value == oep->_value;
+    return false;
+}
+
+std::shared_ptr<Object> EqualsPredicate::clone() const {
+    return std::make_shared<EqualsPredicate>(*this);
+}
+
+// BitmapIndex
+namespace {
+    /** Adds each row of the array to the bitmap of its value, reading a
+     * mapped array where it lies. Returns false as soon as there are more than
+     * max_values distinct values. */
+    template< typename T >
+    bool index_rows(const NullableArray<T>& arr, size_t max_values,
+                    std::map<EqualsPredicate::Value, Bitmap>& values, Bitmap& missing) {
+        return arr.visit([&](const auto& bitmap, const auto& data){
+            // remember the bitmap of the previous value, since runs are common
+            Bitmap *last = nullptr;
+            T last_val{};
+            for(size_t r = 0; r < data.size(); ++r) {
+                if(!bitmap[r]) {
+                    missing.add(r);
+                    continue;
+                }
+                if(!last || !(last_val == data[r])) {
+                    last_val = data[r];
+                    last = &values[EqualsPredicate::Value(last_val)];
+                    if(values.size() > max_values) return false;
+                }
+                last->add(r);
+            }
+            return true;
+        });
+    }
+}
+
+BitmapIndex::BitmapIndex(char type, size_t rows) : _type(type), _rows(rows), _values(),
+_missing(), _empty() {}
+
+std::shared_ptr<BitmapIndex> BitmapIndex::build(const Column& col, size_t max_values) {
+    assert(col.size() <= UINT32_MAX);
+    auto index = std::shared_ptr<BitmapIndex>(new BitmapIndex(col.get_type(), col.size()));
+    bool ok = false;
+    switch(col.get_type()) {
+        case 'I':
+            ok = index_rows(static_cast<const IntColumn&>(col).get_array(), max_values,
+                            index->_values, index->_missing);
+            break;
+        case 'B':
+            ok = index_rows(static_cast<const BoolColumn&>(col).get_array(), max_values,
+                            index->_values, index->_missing);
+            break;
+        case 'S':
+            ok = index_rows(static_cast<const StringColumn&>(col).get_array(), max_values,
+                            index->_values, index->_missing);
+            break;
+        default:
+            break;
+    }
+    if(!ok) return nullptr;
+    return index;
+}
+
+char BitmapIndex::type() const {
+    return _type;
+}
+
+size_t BitmapIndex::rows() const {
+    return _rows;
+}
+
+size_t BitmapIndex::distinct() const {
+    return _values.size();
+}
+
+const Bitmap& BitmapIndex::rows_equal(const EqualsPredicate::Value& value) const {
+    auto iter = _values.find(value);
+    if(iter == _values.end()) return _empty;
+    return iter->second;
+}
+
+const Bitmap& BitmapIndex::missing() const {
+    return _missing;
+}
+
+size_t BitmapIndex::count(const EqualsPredicate::Value& value) const {
+    return this->rows_equal(value).cardinality();
+}
+
+size_t BitmapIndex::hash() const {
+    size_t hash = _type + _rows * 31 + _missing.hash();
+    for(auto iter = _values.begin(); iter != _values.end(); ++iter) {
+        hash = hash * 31 + iter->second.hash();
+    }
+    return hash;
+}
+
+bool BitmapIndex::equals(const Object *other) const {
+    auto obi = dynamic_cast<const BitmapIndex *>(other);
+    if(obi) {
+        return _type == obi->_type && _rows == obi->_rows
+            && _missing == obi->_missing && _values == obi->_values;
+    }
+    return false;
+}
+
+std::shared_ptr<Object> BitmapIndex::clone() const {
+    return std::make_shared<BitmapIndex>(*this);
+}
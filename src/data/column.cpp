@@ -2,6 +2,21 @@
 
 Column::~Column(){}
 
+std::unique_ptr<Column> Column::from_type(char type) {
+    switch(type) {
+        case 'I':
+            return std::make_unique<IntColumn>();
+        case 'F':
+            return std::make_unique<FloatColumn>();
+        case 'B':
+            return std::make_unique<BoolColumn>();
+        case 'S':
+            return std::make_unique<StringColumn>();
+        default:
+            return std::unique_ptr<Column>(nullptr);
+    }
+}
+
 /** Type converters: Return same column under its actual type, or
 *  nullptr if of the wrong type.  */
 IntColumn* Column::as_int() { return nullptr; }
@@ -26,13 +41,19 @@ IntColumn::IntColumn(int n, ...) : _data() {
     va_start(args, n);
 
     for(int i = 0; i < n; ++i) {
-        _data.push_back(va_arg(args, int));
+        this->push_back(va_arg(args, int));
     }
     va_end(args);
 }
 
+IntColumn::IntColumn(NullableArray<int>&& data, ZoneMap<int>&& zones)
+: _data(std::move(data)), _zones(std::move(zones)) {
+    if(_zones.rows() != _data.size()) _zones.rebuild_from(_data, 0);
+}
+
 void IntColumn::push_back(std::optional<int> val) {
-  _data.push_back(val);
+  _zones.push_back(val);
+  _data.push_back(std::move(val));
 }
 
 std::optional<int> IntColumn::get(size_t idx) const {
@@ -43,14 +64,44 @@ IntColumn* IntColumn::as_int() {
   return this;
 }
 
+const NullableArray<int>& IntColumn::get_array() const {
+  return _data;
+}
+
+const ZoneMap<int>& IntColumn::get_zones() const {
+  return _zones;
+}
+
 std::optional<int> IntColumn::set(size_t idx, std::optional<int> val) {
-    return _data.set(idx, val);
+    std::optional<int> old = _data.set(idx, val);
+    _zones.update(idx, old, val, _data);
+    return old;
 }
 
 size_t IntColumn::size() const {
   return _data.size();
 }
 
+void IntColumn::reserve(size_t n) {
+    _data.reserve(n);
+    _zones.reserve(n);
+}
+
+void IntColumn::shrink_to_fit() {
+    _data.shrink_to_fit();
+    _zones.shrink_to_fit();
+}
+
+
+void IntColumn::append(Column&& other) {
+    IntColumn *oc = other.as_int();
+    exit_if_not(oc, "Appended column is not of the same type.");
+    size_t old_size = _data.size();
+    _data.append(std::move(oc->_data));
+    _zones.rebuild_from(_data, old_size);
+    // the other column is left empty, and so must its zones be
+    oc->_zones = ZoneMap<int>();
+}
 
 char IntColumn::get_type() const {
   return 'I';
@@ -73,7 +124,16 @@ std::shared_ptr<Object> IntColumn::clone() const {
 }
 
 std::vector<uint8_t> IntColumn::serialize() const {
-    return _data.serialize();
+    return this->_serialize_exact();
+}
+
+void IntColumn::serialize_into(ByteWriter& w) const {
+    _data.serialize_into(w);
+    _zones.serialize_into(w);
+}
+
+size_t IntColumn::serialized_size() const {
+    return _data.serialized_size() + _zones.serialized_size();
 }
 
 // Float Column
@@ -82,13 +142,19 @@ FloatColumn::FloatColumn(int n, ...) : _data() {
     va_start(args, n);
 
     for(int i = 0; i < n; ++i) {
-        _data.push_back(va_arg(args, double));
+        this->push_back(va_arg(args, double));
     }
     va_end(args);
 }
 
+FloatColumn::FloatColumn(NullableArray<double>&& data, ZoneMap<double>&& zones)
+: _data(std::move(data)), _zones(std::move(zones)) {
+    if(_zones.rows() != _data.size()) _zones.rebuild_from(_data, 0);
+}
+
 void FloatColumn::push_back(std::optional<double> val) {
-  _data.push_back(val);
+  _zones.push_back(val);
+  _data.push_back(std::move(val));
 }
 
 std::optional<double> FloatColumn::get(size_t idx) const {
@@ -99,14 +165,44 @@ FloatColumn* FloatColumn::as_float() {
   return this;
 }
 
+const NullableArray<double>& FloatColumn::get_array() const {
+  return _data;
+}
+
+const ZoneMap<double>& FloatColumn::get_zones() const {
+  return _zones;
+}
+
 std::optional<double> FloatColumn::set(size_t idx, std::optional<double> val) {
-    return _data.set(idx, val);
+    std::optional<double> old = _data.set(idx, val);
+    _zones.update(idx, old, val, _data);
+    return old;
 }
 
 size_t FloatColumn::size() const {
   return _data.size();
 }
 
+void FloatColumn::reserve(size_t n) {
+    _data.reserve(n);
+    _zones.reserve(n);
+}
+
+void FloatColumn::shrink_to_fit() {
+    _data.shrink_to_fit();
+    _zones.shrink_to_fit();
+}
+
+
+void FloatColumn::append(Column&& other) {
+    FloatColumn *oc = other.as_float();
+    exit_if_not(oc, "Appended column is not of the same type.");
+    size_t old_size = _data.size();
+    _data.append(std::move(oc->_data));
+    _zones.rebuild_from(_data, old_size);
+    // the other column is left empty, and so must its zones be
+    oc->_zones = ZoneMap<double>();
+}
 
 char FloatColumn::get_type() const {
   return 'F';
@@ -129,7 +225,16 @@ std::shared_ptr<Object> FloatColumn::clone() const {
 }
 
 std::vector<uint8_t> FloatColumn::serialize() const {
-    return _data.serialize();
+    return this->_serialize_exact();
+}
+
+void FloatColumn::serialize_into(ByteWriter& w) const {
+    _data.serialize_into(w);
+    _zones.serialize_into(w);
+}
+
+size_t FloatColumn::serialized_size() const {
+    return _data.serialized_size() + _zones.serialized_size();
 }
 
 // Bool Column
@@ -138,13 +243,19 @@ BoolColumn::BoolColumn(int n, ...) : _data() {
     va_start(args, n);
 
     for(int i = 0; i < n; ++i) {
-        _data.push_back(va_arg(args, double));
+        this->push_back(va_arg(args, double));
     }
     va_end(args);
 }
 
+BoolColumn::BoolColumn(NullableArray<bool>&& data, ZoneMap<bool>&& zones)
+: _data(std::move(data)), _zones(std::move(zones)) {
+    if(_zones.rows() != _data.size()) _zones.rebuild_from(_data, 0);
+}
+
 void BoolColumn::push_back(std::optional<bool> val) {
-  _data.push_back(val);
+  _zones.push_back(val);
+  _data.push_back(std::move(val));
 }
 
 std::optional<bool> BoolColumn::get(size_t idx) const {
@@ -155,14 +266,44 @@ BoolColumn* BoolColumn::as_bool() {
   return this;
 }
 
+const NullableArray<bool>& BoolColumn::get_array() const {
+  return _data;
+}
+
+const ZoneMap<bool>& BoolColumn::get_zones() const {
+  return _zones;
+}
+
 std::optional<bool> BoolColumn::set(size_t idx, std::optional<bool> val) {
-    return _data.set(idx, val);
+    std::optional<bool> old = _data.set(idx, val);
+    _zones.update(idx, old, val, _data);
+    return old;
 }
 
 size_t BoolColumn::size() const {
   return _data.size();
 }
 
+void BoolColumn::reserve(size_t n) {
+    _data.reserve(n);
+    _zones.reserve(n);
+}
+
+void BoolColumn::shrink_to_fit() {
+    _data.shrink_to_fit();
+    _zones.shrink_to_fit();
+}
+
+
+void BoolColumn::append(Column&& other) {
+    BoolColumn *oc = other.as_bool();
+    exit_if_not(oc, "Appended column is not of the same type.");
+    size_t old_size = _data.size();
+    _data.append(std::move(oc->_data));
+    _zones.rebuild_from(_data, old_size);
+    // the other column is left empty, and so must its zones be
+    oc->_zones = ZoneMap<bool>();
+}
 
 char BoolColumn::get_type() const {
   return 'B';
@@ -185,7 +326,16 @@ std::shared_ptr<Object> BoolColumn::clone() const {
 }
 
 std::vector<uint8_t> BoolColumn::serialize() const {
-    return _data.serialize();
+    return this->_serialize_exact();
+}
+
+void BoolColumn::serialize_into(ByteWriter& w) const {
+    _data.serialize_into(w);
+    _zones.serialize_into(w);
+}
+
+size_t BoolColumn::serialized_size() const {
+    return _data.serialized_size() + _zones.serialized_size();
 }
 
 // String Column
@@ -194,13 +344,19 @@ StringColumn::StringColumn(int n, ...) : _data() {
     va_start(args, n);
 
     for(int i = 0; i < n; ++i) {
-        _data.push_back(std::optional<std::string>(va_arg(args, const char *)));
+        this->push_back(std::optional<std::string>(va_arg(args, const char *)));
     }
     va_end(args);
 }
 
+StringColumn::StringColumn(NullableArray<std::string>&& data, ZoneMap<std::string>&& zones)
+: _data(std::move(data)), _zones(std::move(zones)) {
+    if(_zones.rows() != _data.size()) _zones.rebuild_from(_data, 0);
+}
+
 void StringColumn::push_back(std::optional<std::string> val) {
-  _data.push_back(val);
+  _zones.push_back(val);
+  _data.push_back(std::move(val));
 }
 
 std::optional<std::string> StringColumn::get(size_t idx) {
@@ -211,14 +367,44 @@ StringColumn* StringColumn::as_string() {
   return this;
 }
 
+const NullableArray<std::string>& StringColumn::get_array() const {
+  return _data;
+}
+
+const ZoneMap<std::string>& StringColumn::get_zones() const {
+  return _zones;
+}
+
 std::optional<std::string> StringColumn::set(size_t idx, std::optional<std::string> val) {
-    return _data.set(idx, val);
+    std::optional<std::string> old = _data.set(idx, val);
+    _zones.update(idx, old, val, _data);
+    return old;
 }
 
 size_t StringColumn::size() const {
   return _data.size();
 }
 
+void StringColumn::reserve(size_t n) {
+    _data.reserve(n);
+    _zones.reserve(n);
+}
+
+void StringColumn::shrink_to_fit() {
+    _data.shrink_to_fit();
+    _zones.shrink_to_fit();
+}
+
+
+void StringColumn::append(Column&& other) {
+    StringColumn *oc = other.as_string();
+    exit_if_not(oc, "Appended column is not of the same type.");
+    size_t old_size = _data.size();
+    _data.append(std::move(oc->_data));
+    _zones.rebuild_from(_data, old_size);
+    // the other column is left empty, and so must its zones be
+    oc->_zones = ZoneMap<std::string>();
+}
 
 char StringColumn::get_type() const {
   return 'S';
@@ -241,5 +427,14 @@ std::shared_ptr<Object> StringColumn::clone() const {
 }
 
 std::vector<uint8_t> StringColumn::serialize() const {
-    return _data.serialize();
+    return this->_serialize_exact();
+}
+
+void StringColumn::serialize_into(ByteWriter& w) const {
+    _data.serialize_into(w);
+    _zones.serialize_into(w);
+}
+
+size_t StringColumn::serialized_size() const {
+    return _data.serialized_size() + _zones.serialized_size();
 }
@@ -0,0 +1,150 @@
+#include <cmath>
+#include <algorithm>
+
+#include "data/column_stats.h"
+#include "util/sketch.h"
+
+namespace {
+    /** Adds every value of the array to the sketches, and counts the missing
+     * values and the total length of strings. A mapped array is read where it
+     * lies. */
+    template< typename T >
+    void scan(const NullableArray<T>& arr, HyperLogLog& hll, QuantileSketch& qs,
+              size_t& null_count, size_t& total_length) {
+        arr.visit([&](const auto& bitmap, const auto& data){
+            for(size_t r = 0; r < data.size(); ++r) {
+                if(!bitmap[r]) {
+                    ++null_count;
+                    continue;
+                }
+                hll.add(data[r]);
+                if constexpr (std::is_same_v<T, std::string>) {
+                    total_length += data[r].size();
+                } else {
+                    qs.add(data[r]);
+                }
+            }
+        });
+    }
+}
+
+ColumnStats::ColumnStats(char type) : _type(type), _rows(0), _null_count(0), _distinct(0),
+_avg_length(0), _bounds() {}
+
+std::shared_ptr<ColumnStats> ColumnStats::compute(const Column& col, size_t buckets) {
+    auto stats = std::shared_ptr<ColumnStats>(new ColumnStats(col.get_type()));
+    stats->_rows = col.size();
+
+    HyperLogLog hll;
+    QuantileSketch qs;
+    size_t total_length = 0;
+    switch(col.get_type()) {
+        case 'I':
+            scan(static_cast<const IntColumn&>(col).get_array(), hll, qs, stats->_null_count, total_length);
+            break;
+        case 'F':
+            scan(static_cast<const FloatColumn&>(col).get_array(), hll, qs, stats->_null_count, total_length);
+            break;
+        case 'B':
+            scan(static_cast<const BoolColumn&>(col).get_array(), hll, qs, stats->_null_count, total_length);
+            break;
+        case 'S':
+            scan(static_cast<const StringColumn&>(col).get_array(), hll, qs, stats->_null_count, total_length);
+            break;
+    }
+
+    size_t values = stats->_rows - stats->_null_count;
+    // the estimate can never be more than the number of values
+    stats->_distinct = std::min(hll.count(), values);
+    if(values > 0) stats->_avg_length = double(total_length) / values;
+    if(qs.count() > 0 && buckets > 0) {
+        for(size_t b = 0; b <= buckets; ++b) {
+            stats->_bounds.push_back(qs.quantile(double(b) / buckets));
+        }
+    }
+    return stats;
+}
+
+char ColumnStats::type() const {
+    return _type;
+}
+
+size_t ColumnStats::rows() const {
+    return _rows;
+}
+
+size_t ColumnStats::null_count() const {
+    return _null_count;
+}
+
+size_t ColumnStats::distinct() const {
+    return _distinct;
+}
+
+double ColumnStats::avg_length() const {
+    return _avg_length;
+}
+
+const std::vector<double>& ColumnStats::histogram() const {
+    return _bounds;
+}
+
+double ColumnStats::selectivity(double lo, double hi) const {
+    if(_bounds.size() < 2) return 1;
+    if(hi < lo) return 0;
+
+    double selected = 0;
+    size_t buckets = _bounds.size() - 1;
+    for(size_t b = 0; b < buckets; ++b) {
+        double start = _bounds[b];
+        double end = _bounds[b + 1];
+        if(end <= start) {
+            // every value in the bucket is the same
+            if(lo <= start && start <= hi) selected += 1;
+        } else {
+            double overlap = std::min(hi, end) - std::max(lo, start);
+            if(overlap > 0) selected += overlap / (end - start);
+        }
+    }
+    return selected / buckets;
+}
+
+size_t ColumnStats::hash() const {
+    size_t hash = _type + _rows * 31 + _null_count * 17 + _distinct;
+    for(size_t i = 0; i < _bounds.size(); ++i) {
+        hash = hash * 31 + std::hash<double>()(_bounds[i]);
+    }
+    return hash;
+}
+
+bool ColumnStats::equals(const Object *other) const {
+    auto ocs = dynamic_cast<const ColumnStats *>(other);
+    if(ocs) {
+        return _type == ocs->_type && _rows == ocs->_rows && _null_count == ocs->_null_count
+            && _distinct == ocs->_distinct && _avg_length == ocs->_avg_length
+            && _bounds == ocs->_bounds;
+    }
+    return false;
+}
+
+std::shared_ptr<Object> ColumnStats::clone() const {
+    return std::make_shared<ColumnStats>(*this);
+}
+
+std::vector<uint8_t> ColumnStats::serialize() const {
+    return this->_serialize_exact();
+}
+
+void ColumnStats::serialize_into(ByteWriter& w) const {
+    w.write<char>(_type);
+    w.write_size(_rows);
+    w.write_size(_null_count);
+    w.write_size(_distinct);
+    w.write<double>(_avg_length);
+    w.write_size(_bounds.size());
+    w.write_bytes(_bounds.data(), _bounds.size() * sizeof(double));
+}
+
+size_t ColumnStats::serialized_size() const {
+    return sizeof(char) + 4 * sizeof(size_t) + sizeof(double) + _bounds.size() * sizeof(double);
+}
@@ -1,6 +1,13 @@
+#include <unistd.h>
 #include <cstring>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
 
 #include "data/dataframe.h"
+#include "data/frame_file.h"
+#include "data/frame_writer.h"
+#include "util/top_k.h"
 
 // static functions
 std::shared_ptr<DataFrame> DataFrame::from_array(KVStore::Key k, bool *arr, size_t arr_len) {
@@ -92,22 +99,24 @@ DataFrame::DataFrame(std::unique_ptr<Schema> schema) : _schema(std::move(schema)
     }
 }
 
+DataFrame::DataFrame(std::unique_ptr<Schema> schema, std::vector<std::unique_ptr<Column>> columns)
+: _schema(std::move(schema)), _columns(std::move(columns)) {
+    exit_if_not(_schema->width() == _columns.size(), "Column count does not match schema.");
+    for(size_t i = 0; i < _columns.size(); ++i){
+        exit_if_not(_columns[i] && _columns[i]->get_type() == _schema->col_type(i),
+                    "Column type does not match schema.");
+        exit_if_not(_columns[i]->size() == _columns[0]->size(), "Columns are not the same length.");
+    }
+}
+
 DataFrame::~DataFrame() {}
 
 std::unique_ptr<Column> DataFrame::_get_col_from_type(char type) const {
-    switch(type) {
-        case 'I':
-            return std::make_unique<IntColumn>();
-        case 'F':
-            return std::make_unique<FloatColumn>();
-        case 'B':
-            return std::make_unique<BoolColumn>();
-        case 'S':
-            return std::make_unique<StringColumn>();
-        default:
-            p("Unknown Column Type: ").p(type).p('(').p((int) type).p(')').pln();
-            return std::unique_ptr<Column>(nullptr);
+    auto col = Column::from_type(type);
+    if(!col) {
+        p("Unknown Column Type: ").p(type).p('(').p((int) type).p(')').pln();
     }
+    return col;
 }
 
 const Schema& DataFrame::get_schema() const {
@@ -123,6 +132,26 @@ void DataFrame::add_column(std::unique_ptr<Column> col, std::optional<std::strin
     _columns.push_back(std::move(col));
 }
 
+void DataFrame::compute_stats() {
+    std::vector<std::shared_ptr<ColumnStats>> stats(_columns.size());
+    parallel_for(_columns.size(), [this, &stats](size_t c){
+        stats[c] = ColumnStats::compute(*_columns[c]);
+    });
+    for(size_t c = 0; c < stats.size(); ++c) {
+        _schema->set_col_stats(c, stats[c]);
+    }
+}
+
+std::shared_ptr<const ColumnStats> DataFrame::get_stats(size_t col) const {
+    exit_if_not(col < _columns.size(), "Col index out of range.");
+    return _schema->col_stats(col);
+}
+
+const Column& DataFrame::get_column(size_t col) const {
+    assert(col < _columns.size());
+    return *_columns[col];
+}
+
 /** Return the value at the given column and row. Accessing rows or
 *  columns out of bounds, or request the wrong type is undefined.*/
 std::optional<int> DataFrame::get_int(size_t col, size_t row) const {
@@ -163,18 +192,26 @@ int DataFrame::get_row(const std::string& row) const {
 
 void DataFrame::set(size_t col, size_t row, std::optional<int> val) {
     _columns[col]->as_int()->set(row, val);
+    _drop_index(col);
 }
 
 void DataFrame::set(size_t col, size_t row, std::optional<bool> val) {
     _columns[col]->as_bool()->set(row, val);
+    _drop_index(col);
 }
 
 void DataFrame::set(size_t col, size_t row, std::optional<double> val) {
     _columns[col]->as_float()->set(row, val);
+    _drop_index(col);
 }
 
 void DataFrame::set(size_t col, size_t row, std::optional<std::string> val) {
     _columns[col]->as_string()->set(row, val);
+    _drop_index(col);
+}
+
+void DataFrame::_drop_index(size_t col) {
+    if(col < _indexes.size()) _indexes[col] = nullptr;
 }
 
 void DataFrame::fill_row(size_t idx, Row& row) const {
@@ -201,6 +238,7 @@ void DataFrame::fill_row(size_t idx, Row& row) const {
 }
 
 void DataFrame::add_row(Row& row) {
+    _indexes.clear();
     for(size_t c = 0; c < _columns.size(); ++c){
         switch(_columns[c]->get_type()){
             case 'I':
@@ -234,38 +272,100 @@ size_t DataFrame::ncols() const {
     return _columns.size();
 }
 
+void DataFrame::reserve(size_t rows) {
+    _schema->reserve_rows(rows);
+    for(auto& col : _columns) col->reserve(rows);
+}
+
+void DataFrame::shrink_to_fit() {
+    _schema->shrink_to_fit();
+    parallel_for(_columns.size(), [this](size_t c){
+        _columns[c]->shrink_to_fit();
+    });
+}
+
 void DataFrame::map(Rower& r) const {
-    Row row(*_schema);
-    for(size_t i = 0; i < this->nrows(); ++i) {
-        this->fill_row(i, row);
-        r.accept(row);
+    std::vector<Rower*> rowers = {&r};
+    this->map_many(rowers);
+}
+
+void DataFrame::map(Rower& r, const RangePredicate& pred) const {
+    std::vector<Rower*> rowers = {&r};
+    this->map_many(rowers, &pred);
+}
+
+void DataFrame::map_many(const std::vector<Rower*>& rowers, const RangePredicate *pred) const {
+    exit_if_not(!pred || pred->col() < _columns.size(), "Col index out of range.");
+    for(size_t k = 0; k < rowers.size(); ++k) {
+        rowers[k]->start_worker(0, 1);
     }
+    this->_pmap_helper(0, this->nrows(), rowers, pred);
 }
 
 /** This method is used to execute a map in parallel. The row_start
- * is the starting row for the rower in this thread, the row_end is
- * the non-inclusive end row for the rower in this thread. This method
+ * is the starting row for the rowers in this thread, the row_end is
+ * the non-inclusive end row for the rowers in this thread. This method
  * should be passed to a thread as the method it is executing.
  *
  * If the rower is mutating shared objects or data, it must 
  * do that in a thread safe manner internally, or reults are
  * undefined behavior.
  */
-void DataFrame::_pmap_helper(size_t row_start, size_t row_end, Rower& rower) const {
-    for(size_t r = row_start; r < row_end; ++r) {
-        Row row(*_schema);
+void DataFrame::_pmap_helper(size_t row_start, size_t row_end, const std::vector<Rower*>& rowers,
+                             const RangePredicate *pred) const {
+    Row row(*_schema);
+    size_t r = this->_skip_zones(row_start, row_end, pred);
+    while(r < row_end) {
         this->fill_row(r, row);
-        rower.accept(row);
+        for(size_t k = 0; k < rowers.size(); ++k) {
+            rowers[k]->accept(row);
+        }
+        ++r;
+        if(r % ZONE_ROWS == 0) r = this->_skip_zones(r, row_end, pred);
     }
 }
 
+size_t DataFrame::_skip_zones(size_t row, size_t row_end, const RangePredicate *pred) const {
+    if(!pred) return row;
+    const Column& col = *_columns[pred->col()];
+    while(row < row_end && !pred->may_match(col, row / ZONE_ROWS)) {
+        row = (row / ZONE_ROWS + 1) * ZONE_ROWS;
+    }
+    return std::min(row, row_end);
+}
+
+void DataFrame::_pmap_tree_join(size_t worker, Rower& rower,
+                                std::vector<std::shared_ptr<Rower>>& rower_clones,
+                                std::vector<std::promise<void>>& merged) {
+    size_t worker_cnt = merged.size();
+    for(size_t stride = 1; stride < worker_cnt && worker % (2 * stride) == 0; stride *= 2) {
+        size_t partner = worker + stride;
+        if(partner >= worker_cnt) continue;
+        // wait for the partner to finish merging everything after it
+        merged[partner].get_future().wait();
+        rower.join(rower_clones[partner - 1]);
+    }
+    merged[worker].set_value();
+}
+
 void DataFrame::pmap(Rower& rower) const {
+    std::vector<Rower*> rowers = {&rower};
+    this->pmap_many(rowers);
+}
+
+void DataFrame::pmap(Rower& rower, const RangePredicate& pred) const {
+    std::vector<Rower*> rowers = {&rower};
+    this->pmap_many(rowers, &pred);
+}
+
+void DataFrame::pmap_many(const std::vector<Rower*>& rowers, const RangePredicate *pred) const {
+    exit_if_not(!pred || pred->col() < _columns.size(), "Col index out of range.");
     size_t row_cnt = this->nrows();
     // decide how many threads to use
     size_t thread_cnt = row_cnt / THREAD_ROWS;
     if(thread_cnt <= 1){
         // don't bother multi-threading, it will be faster to single thread
-        this->map(rower);
+        this->map_many(rowers, pred);
         return;
     }
     size_t step_size = THREAD_ROWS;
@@ -274,19 +374,37 @@ void DataFrame::pmap(Rower& rower) const {
         step_size = row_cnt / thread_cnt;
     }
 
-    std::vector<std::shared_ptr<Rower>> rower_clones;
-    for(size_t i = 0; i < thread_cnt - 1; ++i){
-        auto rc = std::dynamic_pointer_cast<Rower>(rower.clone());
-        if(i == 1 && !rc){
-            // clone failed - fallback to single threading
-            map(rower);
-            return;
-        } else {
-            assert(rc); // make sure clone suceeds
+    // rower_clones[k][i - 1] is the clone of rower k used by worker i
+    std::vector<std::vector<std::shared_ptr<Rower>>> rower_clones(rowers.size());
+    for(size_t k = 0; k < rowers.size(); ++k) {
+        for(size_t i = 0; i < thread_cnt - 1; ++i){
+            auto rc = std::dynamic_pointer_cast<Rower>(rowers[k]->clone());
+            if(!rc){
+                // clone failed - fallback to single threading
+                this->map_many(rowers, pred);
+                return;
+            }
+            rower_clones[k].push_back(rc);
+        }
+        assert(thread_cnt - 1 == rower_clones[k].size());
+    }
+
+    // tell every rower which worker it is before any of them start
+    for(size_t k = 0; k < rowers.size(); ++k) {
+        rowers[k]->start_worker(0, thread_cnt);
+        for(size_t i = 0; i < rower_clones[k].size(); ++i){
+            rower_clones[k][i]->start_worker(i + 1, thread_cnt);
+        }
+    }
+
+    // used to signal when a worker has been merged with the workers after it,
+    // only for rowers that are joined as a tree
+    std::vector<std::vector<std::promise<void>>> merged(rowers.size());
+    for(size_t k = 0; k < rowers.size(); ++k) {
+        if(rowers[k]->join_is_associative()) {
+            merged[k] = std::vector<std::promise<void>>(thread_cnt);
         }
-        rower_clones.push_back(rc);
     }
-    assert(thread_cnt - 1 == rower_clones.size());
 
     std::vector<std::thread> threads;
 
@@ -297,8 +415,15 @@ void DataFrame::pmap(Rower& rower) const {
         size_t row_end = (i == (thread_cnt - 1)) ? this->nrows() : row_start + step_size;
         assert(row_end <= row_cnt);
         // this function constructs the thread at the end of the array
-        threads.emplace_back([this, row_start, row_end, i, &rower_clones, &rower]{
-                this->_pmap_helper(row_start, row_end, (i > 0 ? *rower_clones[i - 1] : rower));
+        threads.emplace_back([this, row_start, row_end, i, pred, &rowers, &rower_clones, &merged]{
+                std::vector<Rower*> workers;
+                for(size_t k = 0; k < rowers.size(); ++k) {
+                    workers.push_back(i > 0 ? rower_clones[k][i - 1].get() : rowers[k]);
+                }
+                this->_pmap_helper(row_start, row_end, workers, pred);
+                for(size_t k = 0; k < workers.size(); ++k) {
+                    if(!merged[k].empty()) _pmap_tree_join(i, *workers[k], rower_clones[k], merged[k]);
+                }
         });
         row_start = row_end;
     }
@@ -310,36 +435,242 @@ void DataFrame::pmap(Rower& rower) const {
     }
     
     // merge rower results and clean-up allocated memory
-    for(size_t i = 0; i < rower_clones.size(); ++i) {
-        rower.join(rower_clones[i]);
+    for(size_t k = 0; k < rowers.size(); ++k) {
+        if(!merged[k].empty()) continue; // already joined by the workers
+        for(size_t i = 0; i < rower_clones[k].size(); ++i) {
+            rowers[k]->join(rower_clones[k][i]);
+        }
     }
 }
 
 std::shared_ptr<DataFrame> DataFrame::filter(Rower& r) const {
+    return this->_filter(r, nullptr);
+}
+
+std::shared_ptr<DataFrame> DataFrame::filter(Rower& r, const RangePredicate& pred) const {
+    exit_if_not(pred.col() < _columns.size(), "Col index out of range.");
+    return this->_filter(r, &pred);
+}
+
+std::shared_ptr<DataFrame> DataFrame::_filter(Rower& r, const RangePredicate *pred) const {
     auto df = std::make_shared<DataFrame>(*this);
 
-    for(size_t i = 0; i < _schema->length(); ++i) {
-        Row row(*_schema);
+    size_t row_cnt = this->nrows();
+    Row row(*_schema);
+    size_t i = this->_skip_zones(0, row_cnt, pred);
+    while(i < row_cnt) {
         this->fill_row(i, row);
         if(r.accept(row)) {
             df->add_row(row);
         }
+        ++i;
+        if(i % ZONE_ROWS == 0) i = this->_skip_zones(i, row_cnt, pred);
+    }
+    return df;
+}
+
+template< typename T >
+std::vector<size_t> DataFrame::_top_k_rows(const NullableArray<T>& arr, size_t k) const {
+    // a mapped array is read where it lies
+    return arr.visit([this, &arr, k](const auto& bitmap, const auto& data) {
+        // a row is better if its value is larger, or if the values are equal and it is earlier
+        auto better = [&data](size_t a, size_t b) {
+            return data[b] < data[a] || (!(data[a] < data[b]) && a < b);
+        };
+        using Heap = TopK<size_t, decltype(better)>;
+
+        // decide how many threads to use, the same way as pmap
+        size_t row_cnt = arr.size();
+        size_t thread_cnt = row_cnt / THREAD_ROWS;
+        size_t step_size = THREAD_ROWS;
+        if(thread_cnt <= 1) {
+            thread_cnt = 1;
+            step_size = row_cnt;
+        } else if(thread_cnt > MAX_THREADS) {
+            thread_cnt = MAX_THREADS;
+            step_size = row_cnt / thread_cnt;
+        }
+
+        std::vector<Heap> heaps(thread_cnt, Heap(k, better));
+        auto scan = [&data, &bitmap, &heaps](size_t i, size_t row_start, size_t row_end) {
+            heaps[i].reserve(row_end - row_start);
+            for(size_t r = row_start; r < row_end; ++r) {
+                if(!bitmap[r]) continue;
+                if constexpr (std::is_floating_point_v<T>) {
+                    if(std::isnan(data[r])) continue;
+                }
+                heaps[i].push(r);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        size_t row_start = 0;
+        for(size_t i = 0; i < thread_cnt; ++i) {
+            size_t row_end = (i == (thread_cnt - 1)) ? row_cnt : row_start + step_size;
+            if(thread_cnt == 1) {
+                scan(i, row_start, row_end);
+            } else {
+                threads.emplace_back(scan, i, row_start, row_end);
+            }
+            row_start = row_end;
+        }
+        for(size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+
+        for(size_t i = 1; i < heaps.size(); ++i) {
+            heaps[0].merge(std::move(heaps[i]));
+        }
+        return heaps[0].finish();
+    });
+}
+
+std::shared_ptr<DataFrame> DataFrame::top_k(size_t col, size_t k) const {
+    exit_if_not(col < _columns.size(), "Col index out of range.");
+    std::vector<size_t> rows;
+    switch(_schema->col_type(col)) {
+        case 'I':
+            rows = _top_k_rows(_columns[col]->as_int()->get_array(), k);
+            break;
+        case 'F':
+            rows = _top_k_rows(_columns[col]->as_float()->get_array(), k);
+            break;
+        case 'B':
+            rows = _top_k_rows(_columns[col]->as_bool()->get_array(), k);
+            break;
+        case 'S':
+            rows = _top_k_rows(_columns[col]->as_string()->get_array(), k);
+            break;
+        default:
+            p("Unexpected Column Type At Index ").p(col).p(": ").pln(_schema->col_type(col));
+            assert(false); // unreachable
     }
+
+    auto df = std::make_shared<DataFrame>(*this);
+    Row row(*_schema);
+    for(size_t i = 0; i < rows.size(); ++i) {
+        this->fill_row(rows[i], row);
+        df->add_row(row);
+    }
+    return df;
+}
+
+bool DataFrame::build_index(size_t col, size_t max_values) {
+    exit_if_not(col < _columns.size(), "Col index out of range.");
+    auto index = BitmapIndex::build(*_columns[col], max_values);
+    if(!index) return false;
+    if(_indexes.size() < _columns.size()) _indexes.resize(_columns.size());
+    _indexes[col] = index;
+    return true;
+}
+
+std::shared_ptr<const BitmapIndex> DataFrame::get_index(size_t col) const {
+    exit_if_not(col < _columns.size(), "Col index out of range.");
+    if(col >= _indexes.size()) return nullptr;
+    return _indexes[col];
+}
+
+namespace {
+    /** Adds the rows of the array equal to the value to the bitmap, either
+     * every row or only the candidate rows. Mapped arrays are read in place. */
+    template< typename T >
+    void scan_equal(const NullableArray<T>& arr, const T& value, const Bitmap *candidates, Bitmap& out) {
+        arr.visit([&](auto& bitmap, auto& data){
+            if(candidates) {
+                candidates->for_each([&](uint32_t r){
+                    if(bitmap[r] && data[r] == value) out.add(r);
+                });
+            } else {
+                for(size_t r = 0; r < data.size(); ++r) {
+                    if(bitmap[r] && data[r] == value) out.add(r);
+                }
+            }
+        });
+    }
+}
+
+Bitmap DataFrame::_scan_equal(const EqualsPredicate& pred, const Bitmap *candidates) const {
+    const Column& col = *_columns[pred.col()];
+    const EqualsPredicate::Value& value = pred.value();
+    Bitmap out;
+    if(col.get_type() == 'I' && std::holds_alternative<int>(value)) {
+        scan_equal(static_cast<const IntColumn&>(col).get_array(), std::get<int>(value), candidates, out);
+    } else if(col.get_type() == 'B' && std::holds_alternative<bool>(value)) {
+        scan_equal(static_cast<const BoolColumn&>(col).get_array(), std::get<bool>(value), candidates, out);
+    } else if(col.get_type() == 'S' && std::holds_alternative<std::string>(value)) {
+        scan_equal(static_cast<const StringColumn&>(col).get_array(), std::get<std::string>(value), candidates, out);
+    } else {
+        exit_if_not(false, "Predicate type does not match the column type.");
+    }
+    return out;
+}
+
+Bitmap DataFrame::select(const std::vector<EqualsPredicate>& preds) const {
+    size_t row_cnt = this->nrows();
+    exit_if_not(row_cnt <= UINT32_MAX, "Dataframe is too long to select from.");
+    for(size_t i = 0; i < preds.size(); ++i) {
+        exit_if_not(preds[i].col() < _columns.size(), "Col index out of range.");
+    }
+
+    // intersect the bitmaps of the indexed columns first, without reading any data
+    std::optional<Bitmap> rows;
+    for(size_t i = 0; i < preds.size(); ++i) {
+        auto index = this->get_index(preds[i].col());
+        if(!index) continue;
+        const Bitmap& matching = index->rows_equal(preds[i].value());
+        rows = rows ? (*rows & matching) : matching;
+    }
+    // then only read the rows left in the other columns
+    for(size_t i = 0; i < preds.size(); ++i) {
+        if(this->get_index(preds[i].col())) continue;
+        rows = this->_scan_equal(preds[i], rows ? &*rows : nullptr);
+    }
+    if(!rows) return Bitmap::range(0, row_cnt);
+    return *rows;
+}
+
+size_t DataFrame::count(const std::vector<EqualsPredicate>& preds) const {
+    return this->select(preds).cardinality();
+}
+
+std::shared_ptr<DataFrame> DataFrame::filter(const std::vector<EqualsPredicate>& preds) const {
+    auto df = std::make_shared<DataFrame>(*this);
+    Row row(*_schema);
+    this->select(preds).for_each([this, &row, &df](uint32_t r){
+        this->fill_row(r, row);
+        df->add_row(row);
+    });
     return df;
 }
 
+bool DataFrame::write_sor(int fd) const {
+    return FrameWriter::write_sor(*this, fd);
+}
+
+bool DataFrame::write_csv(int fd) const {
+    return FrameWriter::write_csv(*this, fd);
+}
+
 void DataFrame::print() const {
-    PrintRower pr;
-    this->map(pr);
+    // anything already printed through cout must come first
+    std::cout.flush();
+    this->write_sor(STDOUT_FILENO);
 }
 
 bool DataFrame::equals(const Object* other) const {
     const DataFrame *df_other = dynamic_cast<const DataFrame*>(other);
     if(df_other && _columns.size() == df_other->_columns.size() && _schema->equals(df_other->_schema.get())){
-        for(size_t c = 0; c < _columns.size(); ++c) {
-            if(!_columns[c]->equals(df_other->_columns[c].get())) return false;
+        if(!this->_fan_out_columns()) {
+            for(size_t c = 0; c < _columns.size(); ++c) {
+                if(!_columns[c]->equals(df_other->_columns[c].get())) return false;
+            }
+            return true;
         }
-        return true;
+        std::vector<char> equal(_columns.size());
+        parallel_for(_columns.size(), [this, df_other, &equal](size_t c){
+            equal[c] = _columns[c]->equals(df_other->_columns[c].get());
+        });
+        return std::all_of(equal.begin(), equal.end(), [](char e){ return e; });
     }
     return false;
 }
@@ -349,9 +680,16 @@ std::shared_ptr<Object> DataFrame::clone() const {
 }
 
 size_t DataFrame::hash() const {
+    std::vector<size_t> hashes(_columns.size());
+    auto hash_column = [this, &hashes](size_t i){ hashes[i] = _columns[i]->hash(); };
+    if(this->_fan_out_columns()) {
+        parallel_for(_columns.size(), hash_column);
+    } else {
+        for(size_t i = 0; i < _columns.size(); ++i) hash_column(i);
+    }
     size_t hash = _schema->hash();
-    for(size_t i = 0; i < _columns.size(); ++i){
-        hash += _columns[i]->hash();
+    for(size_t i = 0; i < hashes.size(); ++i){
+        hash += hashes[i];
     }
     return hash;
 }
@@ -361,82 +699,155 @@ bool DataFrame::operator==(const DataFrame& other) const {
 }
 
 std::vector<uint8_t> DataFrame::serialize() const {
-    std::vector<uint8_t> serialized = _schema->serialize();
-    size_t col_cnt = _columns.size();
-    auto temp =  Serializable::serialize<size_t>(col_cnt);
-    serialized.insert(serialized.end(), temp.begin(), temp.end());
-    for(size_t i = 0; i < col_cnt; ++i){
-        temp = _columns[i]->serialize();
-        serialized.insert(serialized.end(), temp.begin(), temp.end());
+    return this->_serialize_exact();
+}
+
+void DataFrame::serialize_into(ByteWriter& w) const {
+    _schema->serialize_into(w);
+    w.write_size(_columns.size());
+    if(w.encoding() == Encoding::COMPRESSED) {
+        this->_serialize_compressed_columns(w);
+    } else if(this->_fan_out_columns()) {
+        // each column is written to its own buffer, then they are copied in
+        std::vector<std::vector<uint8_t>> pieces(_columns.size());
+        parallel_for(_columns.size(), [this, &w, &pieces](size_t i){
+            ByteWriter pw(pieces[i], w.encoding());
+            pw.reserve(_columns[i]->serialized_size());
+            _columns[i]->serialize_into(pw);
+        });
+        w.write_pieces(pieces);
+    } else {
+        for(size_t i = 0; i < _columns.size(); ++i){
+            _columns[i]->serialize_into(w);
+        }
+    }
+    // column statistics, each preceded by whether it exists
+    for(size_t i = 0; i < _columns.size(); ++i){
+        auto stats = _schema->col_stats(i);
+        w.write<bool>(stats != nullptr);
+        if(stats) stats->serialize_into(w);
     }
-    return serialized;
-}
-
-
-// Print Rower
-bool DataFrame::PrintRower::accept(Row& r){
-    r.visit(r.get_index(), this->pf);
-    return true;
-}
-
-void DataFrame::PrintRower::join([[maybe_unused]]std::shared_ptr<Rower> other) {
-    assert(false);
-}
-
-size_t DataFrame::PrintRower::hash() const {
-    return 100;
-}
-
-bool DataFrame::PrintRower::equals(const Object *other) const {
-    return dynamic_cast<const DataFrame::PrintRower*>(other);
-}
-
-std::shared_ptr<Object> DataFrame::PrintRower::clone() const {
-    return nullptr;
 }
 
-// Print Fielder
-/* void DataFrame::PrintRower::PrintFielder::start(size_t r){} */
-/** Called for fields of the argument's type with the value of the field. */
-void DataFrame::PrintRower::PrintFielder::accept(std::optional<bool> b){
-    p('<');
-    if(b) p(*b);
-    p('>');
+size_t DataFrame::serialized_size() const {
+    size_t size = _schema->serialized_size() + sizeof(size_t);
+    for(size_t i = 0; i < _columns.size(); ++i){
+        size += _columns[i]->serialized_size() + sizeof(bool);
+        auto stats = _schema->col_stats(i);
+        if(stats) size += stats->serialized_size();
+    }
+    return size;
 }
 
-void DataFrame::PrintRower::PrintFielder::accept(std::optional<double> f){
-    p('<');
-    if(f) p(*f);
-    p('>');
+bool DataFrame::_fan_out_columns() const {
+    size_t rows = this->nrows();
+    if(_columns.size() < 2 || rows * _columns.size() < PARALLEL_CHUNK_ROWS) return false;
+    return _columns.size() >= MAX_THREADS || rows < 2 * PARALLEL_CHUNK_ROWS;
 }
 
-void DataFrame::PrintRower::PrintFielder::accept(std::optional<int> i){
-    p('<');
-    if(i) p(*i);
-    p('>');
+std::unique_ptr<Column> DataFrame::_read_column(char type, ByteReader& r) {
+    std::unique_ptr<Column> col = nullptr;
+    switch(type){
+        case 'I':
+            col = std::make_unique<IntColumn>(r.read<IntColumn>());
+            break;
+        case 'F':
+            col = std::make_unique<FloatColumn>(r.read<FloatColumn>());
+            break;
+        case 'B':
+            col = std::make_unique<BoolColumn>(r.read<BoolColumn>());
+            break;
+        case 'S':
+            col = std::make_unique<StringColumn>(r.read<StringColumn>());
+            break;
+    }
+    assert(col);
+    return col;
+}
+
+void DataFrame::_serialize_compressed_columns(ByteWriter& w) const {
+    std::vector<std::vector<uint8_t>> raw(_columns.size());
+    std::vector<std::vector<uint8_t>> compressed(_columns.size());
+    std::vector<CodecId> codecs(_columns.size());
+    parallel_for(_columns.size(), [this, &raw, &compressed, &codecs](size_t c){
+        ByteWriter cw(raw[c], Encoding::COMPACT);
+        cw.reserve(_columns[c]->serialized_size());
+        _columns[c]->serialize_into(cw);
+        codecs[c] = Codec::choose(raw[c].data(), raw[c].size(), compressed[c]).id();
+    });
+    for(size_t c = 0; c < _columns.size(); ++c) {
+        const std::vector<uint8_t>& block = codecs[c] == CodecId::NONE ? raw[c] : compressed[c];
+        w.write<uint8_t>(uint8_t(codecs[c]));
+        w.write_size(raw[c].size());
+        w.write_size(block.size());
+        w.write_bytes(block.data(), block.size());
+    }
 }
 
-void DataFrame::PrintRower::PrintFielder::accept(std::optional<std::string> s){
-    p('<');
-    if(s) {
-        p(s->c_str());
+std::vector<std::unique_ptr<Column>> DataFrame::_read_compressed_columns(const Schema& schema,
+                                                                         ByteReader& r) {
+    // find every block first, so that they can be read in parallel
+    struct Block {
+        CodecId codec;
+        size_t raw_len;
+        size_t start;
+        size_t len;
+    };
+    std::vector<Block> blocks(schema.width());
+    for(size_t c = 0; c < blocks.size(); ++c) {
+        blocks[c].codec = CodecId(r.read<uint8_t>());
+        blocks[c].raw_len = r.read_size();
+        blocks[c].len = r.read_size();
+        blocks[c].start = r.pos();
+        r.read_bytes(blocks[c].len);
     }
-    p('>');
-}
 
-std::shared_ptr<Object> DataFrame::PrintRower::PrintFielder::clone() const {
-    return nullptr;
+    std::vector<std::unique_ptr<Column>> columns(blocks.size());
+    parallel_for(blocks.size(), [&schema, &r, &blocks, &columns](size_t c){
+        const Block& b = blocks[c];
+        if(b.codec == CodecId::NONE) {
+            // read the column where it is, without copying it
+            if(b.raw_len != b.len) throw Codec::CorruptDataException();
+            size_t pos = b.start;
+            ByteReader cr(r.data(), pos, Encoding::COMPACT);
+            columns[c] = DataFrame::_read_column(schema.col_type(c), cr);
+            if(pos != b.start + b.len) throw Codec::CorruptDataException();
+        } else {
+            const Codec& codec = Codec::get(b.codec);
+            // the length is the peer's claim, so it is checked before making room
+            if(b.raw_len > codec.max_decompressed(b.len)) throw Codec::CorruptDataException();
+            std::vector<uint8_t> raw(b.raw_len);
+            codec.decompress(r.data().data() + b.start, b.len, raw.data(), raw.size());
+            size_t pos = 0;
+            ByteReader cr(raw, pos, Encoding::COMPACT);
+            columns[c] = DataFrame::_read_column(schema.col_type(c), cr);
+            if(cr.remaining() != 0) throw Codec::CorruptDataException();
+        }
+    });
+    return columns;
+}
+
+std::vector<Codec::Report> DataFrame::codec_report() const {
+    std::vector<Codec::Report> reports;
+    for(size_t c = 0; c < _columns.size(); ++c) {
+        std::vector<uint8_t> raw;
+        ByteWriter cw(raw, Encoding::COMPACT);
+        _columns[c]->serialize_into(cw);
+        for(CodecId id : {CodecId::NONE, CodecId::LZ}) {
+            reports.push_back(Codec::measure(Codec::get(id), raw));
+        }
+    }
+    return reports;
 }
 
-/** Called when all fields have been seen. */
-void DataFrame::PrintRower::PrintFielder::done(){
-    pln();
+bool DataFrame::save(const std::string& path) const {
+    return FrameFile::save(*this, path);
 }
 
-size_t DataFrame::PrintRower::PrintFielder::hash() const {
-    return 100;
+std::shared_ptr<DataFrame> DataFrame::load(const std::string& path, const std::vector<size_t>& cols) {
+    return FrameFile::load(path, cols);
 }
 
-bool DataFrame::PrintRower::PrintFielder::equals(const Object *other) const {
-    return dynamic_cast<const DataFrame::PrintRower::PrintFielder *>(other);
+std::shared_ptr<DataFrame> DataFrame::open_mmap(const std::string& path, const std::vector<size_t>& cols) {
+    return FrameFile::open_mmap(path, cols);
 }
@@ -0,0 +1,459 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <cstdlib>
+
+#include "data/frame_file.h"
+
+/** Rounds n up to a multiple of FRAME_FILE_ALIGN. */
+static uint64_t align_up(uint64_t n) {
+    return (n + FRAME_FILE_ALIGN - 1) / FRAME_FILE_ALIGN * FRAME_FILE_ALIGN;
+}
+
+/** Writes len bytes at the given offset of the file. */
+static bool write_at(int fd, const void *buf, size_t len, uint64_t offset) {
+    const uint8_t *b = static_cast<const uint8_t *>(buf);
+    while(len > 0) {
+        ssize_t written = pwrite(fd, b, len, offset);
+        if(written < 0) return false;
+        b += written;
+        len -= written;
+        offset += written;
+    }
+    return true;
+}
+
+/** Reads len bytes from the given offset of the file. */
+static bool read_at(int fd, void *buf, size_t len, uint64_t offset) {
+    uint8_t *b = static_cast<uint8_t *>(buf);
+    while(len > 0) {
+        ssize_t got = pread(fd, b, len, offset);
+        if(got <= 0) return false;
+        b += got;
+        len -= got;
+        offset += got;
+    }
+    return true;
+}
+
+/** Returns the bits packed 8 to a byte, a chunk on each thread. */
+static std::vector<uint8_t> pack(const std::vector<bool>& vb) {
+    std::vector<uint8_t> bytes((vb.size() + 7) / 8);
+    parallel_for((vb.size() + PARALLEL_CHUNK_ROWS - 1) / PARALLEL_CHUNK_ROWS, [&vb, &bytes](size_t c){
+        size_t start = c * PARALLEL_CHUNK_ROWS;
+        size_t end = std::min(vb.size(), start + PARALLEL_CHUNK_ROWS);
+        ByteWriter::pack_bits(vb, start, end, bytes.data() + start / 8);
+    });
+    return bytes;
+}
+
+/** Reads the section holding the given number of packed bits. */
+static bool read_bits(int fd, const FrameFile::Section& section, size_t bits,
+                      std::vector<bool>& vb) {
+    if(section.length != (bits + 7) / 8) return false;
+    std::vector<uint8_t> bytes(section.length);
+    if(!read_at(fd, bytes.data(), bytes.size(), section.offset)) return false;
+    vb.resize(bits);
+    for(size_t start = 0; start < bits; start += PARALLEL_CHUNK_ROWS) {
+        ByteReader::unpack_bits(bytes.data(), start, std::min(bits, start + PARALLEL_CHUNK_ROWS), vb);
+    }
+    return true;
+}
+
+/** Returns the number of bytes of the values section of a column. */
+static uint64_t values_length(const Column& col, size_t nrows) {
+    switch(col.get_type()) {
+        case 'I':
+            return nrows * sizeof(int);
+        case 'F':
+            return nrows * sizeof(double);
+        case 'B':
+            return (nrows + 7) / 8;
+        case 'S':
+            {
+                uint64_t len = 0;
+                const std::vector<std::string>& data
+                    = static_cast<const StringColumn&>(col).get_array().data();
+                for(size_t i = 0; i < data.size(); ++i) len += data[i].size();
+                return len;
+            }
+    }
+    assert(false);
+    return 0;
+}
+
+/** Returns the meta section of a column: its zone map and its statistics. */
+static std::vector<uint8_t> column_meta(const Column& col, const ColumnStats *stats) {
+    std::vector<uint8_t> meta;
+    ByteWriter w(meta);
+    switch(col.get_type()) {
+        case 'I':
+            w.write(static_cast<const IntColumn&>(col).get_zones());
+            break;
+        case 'F':
+            w.write(static_cast<const FloatColumn&>(col).get_zones());
+            break;
+        case 'B':
+            w.write(static_cast<const BoolColumn&>(col).get_zones());
+            break;
+        case 'S':
+            w.write(static_cast<const StringColumn&>(col).get_zones());
+            break;
+    }
+    if(stats) w.write(*stats);
+    return meta;
+}
+
+std::vector<FrameFile::ColumnEntry> FrameFile::_layout(const DataFrame& df, uint64_t offset,
+                                                       std::vector<std::vector<uint8_t>>& metas) {
+    size_t nrows = df.nrows();
+    std::vector<ColumnEntry> entries(df.ncols());
+    metas.resize(df.ncols());
+    for(size_t c = 0; c < entries.size(); ++c) {
+        const Column& col = df.get_column(c);
+        auto stats = df.get_stats(c);
+        metas[c] = column_meta(col, stats.get());
+
+        ColumnEntry& e = entries[c];
+        memset(&e, 0, sizeof(e));
+        e.type = col.get_type();
+        e.has_stats = stats != nullptr;
+        e.validity = {offset = align_up(offset), (nrows + 7) / 8};
+        offset += e.validity.length;
+        e.values = {offset = align_up(offset), values_length(col, nrows)};
+        offset += e.values.length;
+        e.offsets = {offset = align_up(offset), e.type == 'S' ? (nrows + 1) * sizeof(uint64_t) : 0};
+        offset += e.offsets.length;
+        e.meta = {offset = align_up(offset), metas[c].size()};
+        offset += e.meta.length;
+    }
+    return entries;
+}
+
+/** Returns the array backing a column of the given type. */
+template< typename C >
+static auto& array_of(const Column& col) {
+    return static_cast<const C&>(col).get_array();
+}
+
+bool FrameFile::_write_column(int fd, const Column& col, const ColumnEntry& entry,
+                              const std::vector<uint8_t>& meta) {
+    std::vector<uint8_t> validity;
+    bool ok = true;
+    switch(col.get_type()) {
+        case 'I':
+            {
+                const NullableArray<int>& arr = array_of<IntColumn>(col);
+                validity = pack(arr.bitmap());
+                ok = write_at(fd, arr.data().data(), entry.values.length, entry.values.offset);
+                break;
+            }
+        case 'F':
+            {
+                const NullableArray<double>& arr = array_of<FloatColumn>(col);
+                validity = pack(arr.bitmap());
+                ok = write_at(fd, arr.data().data(), entry.values.length, entry.values.offset);
+                break;
+            }
+        case 'B':
+            {
+                const NullableArray<bool>& arr = array_of<BoolColumn>(col);
+                validity = pack(arr.bitmap());
+                std::vector<uint8_t> values = pack(arr.data());
+                ok = write_at(fd, values.data(), values.size(), entry.values.offset);
+                break;
+            }
+        case 'S':
+            {
+                const NullableArray<std::string>& arr = array_of<StringColumn>(col);
+                validity = pack(arr.bitmap());
+                const std::vector<std::string>& data = arr.data();
+                std::vector<uint64_t> offsets(data.size() + 1, 0);
+                std::vector<uint8_t> values;
+                values.reserve(entry.values.length);
+                for(size_t i = 0; i < data.size(); ++i) {
+                    values.insert(values.end(), data[i].begin(), data[i].end());
+                    offsets[i + 1] = values.size();
+                }
+                ok = write_at(fd, values.data(), values.size(), entry.values.offset)
+                    && write_at(fd, offsets.data(), entry.offsets.length, entry.offsets.offset);
+                break;
+            }
+    }
+    return ok && write_at(fd, validity.data(), validity.size(), entry.validity.offset)
+        && write_at(fd, meta.data(), meta.size(), entry.meta.offset);
+}
+
+bool FrameFile::save(const DataFrame& df, const std::string& path,
+                     const void *trailer, size_t trailer_len) {
+    Header header;
+    memcpy(header.magic, FRAME_FILE_MAGIC, sizeof(header.magic));
+    header.version = FRAME_FILE_VERSION;
+    header.alignment = FRAME_FILE_ALIGN;
+    header.nrows = df.nrows();
+    header.ncols = df.ncols();
+
+    std::vector<std::vector<uint8_t>> metas;
+    std::vector<ColumnEntry> entries = _layout(df, sizeof(Header) + df.ncols() * sizeof(ColumnEntry),
+                                               metas);
+    uint64_t end = entries.empty() ? sizeof(Header) : entries.back().meta.offset + entries.back().meta.length;
+
+    std::string tmp = path + ".XXXXXX";
+    int fd = mkstemp(&tmp[0]);
+    if(fd < 0) return false;
+    bool ok = fchmod(fd, 0644) == 0
+        && write_at(fd, &header, sizeof(header), 0)
+        && write_at(fd, entries.data(), entries.size() * sizeof(ColumnEntry), sizeof(Header))
+        && ftruncate(fd, end) == 0; // the padding between sections reads as zeros
+    std::vector<char> written(entries.size(), ok);
+    if(ok) {
+        parallel_for(entries.size(), [fd, &df, &entries, &metas, &written](size_t c){
+            written[c] = _write_column(fd, df.get_column(c), entries[c], metas[c]);
+        });
+    }
+    ok = std::all_of(written.begin(), written.end(), [](char w){ return w; })
+        && write_at(fd, trailer, trailer_len, end);
+    ok = close(fd) == 0 && ok;
+    if(!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+/** Reads the values section of fixed width values straight into data. */
+template< typename T >
+static bool read_fixed(int fd, const FrameFile::ColumnEntry& entry, size_t nrows,
+                       std::vector<T>& data) {
+    if(entry.values.length != nrows * sizeof(T)) return false;
+    data.resize(nrows);
+    return read_at(fd, data.data(), entry.values.length, entry.values.offset);
+}
+
+/** Parses the meta section of a column: its zone map and statistics. */
+template< typename T >
+static bool parse_meta(const FrameFile::ColumnEntry& entry, const std::vector<uint8_t>& meta,
+                       ZoneMap<T>& zones, std::shared_ptr<ColumnStats>& stats) {
+    try {
+        size_t pos = 0;
+        zones = ZoneMap<T>::deserialize(meta, pos);
+        if(entry.has_stats) {
+            stats = std::make_shared<ColumnStats>(Serializable::deserialize<ColumnStats>(meta, pos));
+        }
+        return pos == meta.size();
+    } catch(Serializable::ShortSerializedDataException& e) {
+        return false;
+    }
+}
+
+/** Reads the meta section of a column: its zone map and statistics. */
+template< typename T >
+static bool read_meta(int fd, const FrameFile::ColumnEntry& entry, ZoneMap<T>& zones,
+                      std::shared_ptr<ColumnStats>& stats) {
+    std::vector<uint8_t> meta(entry.meta.length);
+    return read_at(fd, meta.data(), meta.size(), entry.meta.offset)
+        && parse_meta(entry, meta, zones, stats);
+}
+
+std::unique_ptr<Column> FrameFile::_read_column(int fd, const ColumnEntry& entry, size_t nrows,
+                                                std::shared_ptr<ColumnStats>& stats) {
+    std::vector<bool> bitmap;
+    if(!read_bits(fd, entry.validity, nrows, bitmap)) return nullptr;
+    switch(entry.type) {
+        case 'I':
+            {
+                std::vector<int> data;
+                ZoneMap<int> zones;
+                if(!read_fixed(fd, entry, nrows, data)
+                        || !read_meta(fd, entry, zones, stats)) return nullptr;
+                NullableArray<int> arr(std::move(bitmap), std::move(data));
+                return std::unique_ptr<Column>(new IntColumn(std::move(arr), std::move(zones)));
+            }
+        case 'F':
+            {
+                std::vector<double> data;
+                ZoneMap<double> zones;
+                if(!read_fixed(fd, entry, nrows, data)
+                        || !read_meta(fd, entry, zones, stats)) return nullptr;
+                NullableArray<double> arr(std::move(bitmap), std::move(data));
+                return std::unique_ptr<Column>(new FloatColumn(std::move(arr), std::move(zones)));
+            }
+        case 'B':
+            {
+                std::vector<bool> data;
+                ZoneMap<bool> zones;
+                if(!read_bits(fd, entry.values, nrows, data)
+                        || !read_meta(fd, entry, zones, stats)) return nullptr;
+                NullableArray<bool> arr(std::move(bitmap), std::move(data));
+                return std::unique_ptr<Column>(new BoolColumn(std::move(arr), std::move(zones)));
+            }
+        case 'S':
+            {
+                if(entry.offsets.length != (nrows + 1) * sizeof(uint64_t)) return nullptr;
+                std::vector<uint64_t> offsets(nrows + 1);
+                std::vector<char> values(entry.values.length);
+                ZoneMap<std::string> zones;
+                if(!read_at(fd, offsets.data(), entry.offsets.length, entry.offsets.offset)
+                        || !read_at(fd, values.data(), values.size(), entry.values.offset)
+                        || !read_meta(fd, entry, zones, stats)) return nullptr;
+                std::vector<std::string> data(nrows);
+                for(size_t i = 0; i < nrows; ++i) {
+                    if(offsets[i] > offsets[i + 1] || offsets[i + 1] > values.size()) return nullptr;
+                    data[i].assign(values.data() + offsets[i], offsets[i + 1] - offsets[i]);
+                }
+                NullableArray<std::string> arr(std::move(bitmap), std::move(data));
+                return std::unique_ptr<Column>(new StringColumn(std::move(arr), std::move(zones)));
+            }
+    }
+    return nullptr;
+}
+
+bool FrameFile::_check_header(const Header& header, uint64_t file_size) {
+    return file_size >= sizeof(Header)
+        && memcmp(header.magic, FRAME_FILE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == FRAME_FILE_VERSION && header.alignment == FRAME_FILE_ALIGN
+        && header.ncols <= (file_size - sizeof(Header)) / sizeof(ColumnEntry);
+}
+
+bool FrameFile::_check_entry(const ColumnEntry& entry, uint64_t nrows, uint64_t file_size) {
+    for(const Section *s : {&entry.validity, &entry.values, &entry.offsets, &entry.meta}) {
+        if(s->offset % FRAME_FILE_ALIGN != 0 || s->offset > file_size
+                || s->length > file_size - s->offset) return false;
+    }
+    if(entry.validity.length != (nrows + 7) / 8) return false;
+    switch(entry.type) {
+        case 'I':
+            return entry.values.length == nrows * sizeof(int) && entry.offsets.length == 0;
+        case 'F':
+            return entry.values.length == nrows * sizeof(double) && entry.offsets.length == 0;
+        case 'B':
+            return entry.values.length == (nrows + 7) / 8 && entry.offsets.length == 0;
+        case 'S':
+            return entry.offsets.length == (nrows + 1) * sizeof(uint64_t);
+    }
+    return false;
+}
+
+bool FrameFile::_select(const Header& header, const std::vector<ColumnEntry>& entries,
+                        uint64_t file_size, const std::vector<size_t>& cols,
+                        std::vector<size_t>& selected, std::string& types) {
+    selected = cols;
+    if(selected.empty()) {
+        for(size_t c = 0; c < entries.size(); ++c) selected.push_back(c);
+    }
+    for(size_t i = 0; i < selected.size(); ++i) {
+        if(selected[i] >= entries.size()
+                || !_check_entry(entries[selected[i]], header.nrows, file_size)) return false;
+        types += entries[selected[i]].type;
+    }
+    return true;
+}
+
+/** Returns a dataframe of the given columns, or nullptr if any is missing. */
+static std::shared_ptr<DataFrame> make_frame(const std::string& types,
+                                             std::vector<std::unique_ptr<Column>>&& columns,
+                                             const std::vector<std::shared_ptr<ColumnStats>>& stats) {
+    for(size_t i = 0; i < columns.size(); ++i) {
+        if(!columns[i]) return nullptr;
+    }
+    auto schema = std::make_unique<Schema>(types);
+    for(size_t i = 0; i < stats.size(); ++i) {
+        if(stats[i]) schema->set_col_stats(i, stats[i]);
+    }
+    return std::make_shared<DataFrame>(std::move(schema), std::move(columns));
+}
+
+std::shared_ptr<DataFrame> FrameFile::load(const std::string& path, const std::vector<size_t>& cols) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) return nullptr;
+    struct stat st;
+    Header header;
+    std::vector<ColumnEntry> entries;
+    std::vector<size_t> selected;
+    std::string types;
+    bool ok = fstat(fd, &st) == 0 && read_at(fd, &header, sizeof(header), 0)
+        && _check_header(header, st.st_size);
+    if(ok) {
+        entries.resize(header.ncols);
+        ok = read_at(fd, entries.data(), entries.size() * sizeof(ColumnEntry), sizeof(Header))
+            && _select(header, entries, st.st_size, cols, selected, types);
+    }
+
+    std::vector<std::unique_ptr<Column>> columns(selected.size());
+    std::vector<std::shared_ptr<ColumnStats>> stats(selected.size());
+    if(ok) {
+        parallel_for(selected.size(), [fd, &header, &entries, &selected, &columns, &stats](size_t i){
+            columns[i] = _read_column(fd, entries[selected[i]], header.nrows, stats[i]);
+        });
+    }
+    close(fd);
+    if(!ok) return nullptr;
+    return make_frame(types, std::move(columns), stats);
+}
+
+std::unique_ptr<Column> FrameFile::_map_column(const std::shared_ptr<const MappedFile>& file,
+                                               const ColumnEntry& entry, size_t nrows,
+                                               std::shared_ptr<ColumnStats>& stats) {
+    const uint8_t *base = file->data();
+    const uint8_t *bits = base + entry.validity.offset;
+    const uint8_t *values = base + entry.values.offset;
+    size_t length = entry.values.length;
+    // scans read the bitmap and values front to back, so read ahead of them
+    file->advise_sequential(entry.validity.offset, entry.validity.length);
+    file->advise_sequential(entry.values.offset, entry.values.length);
+    std::vector<uint8_t> meta(base + entry.meta.offset, base + entry.meta.offset + entry.meta.length);
+    switch(entry.type) {
+        case 'I':
+            {
+                ZoneMap<int> zones;
+                if(!parse_meta(entry, meta, zones, stats)) return nullptr;
+                auto arr = NullableArray<int>::mapped(file, nrows, bits, values, length);
+                return std::unique_ptr<Column>(new IntColumn(std::move(arr), std::move(zones)));
+            }
+        case 'F':
+            {
+                ZoneMap<double> zones;
+                if(!parse_meta(entry, meta, zones, stats)) return nullptr;
+                auto arr = NullableArray<double>::mapped(file, nrows, bits, values, length);
+                return std::unique_ptr<Column>(new FloatColumn(std::move(arr), std::move(zones)));
+            }
+        case 'B':
+            {
+                ZoneMap<bool> zones;
+                if(!parse_meta(entry, meta, zones, stats)) return nullptr;
+                auto arr = NullableArray<bool>::mapped(file, nrows, bits, values, length);
+                return std::unique_ptr<Column>(new BoolColumn(std::move(arr), std::move(zones)));
+            }
+        case 'S':
+            {
+                ZoneMap<std::string> zones;
+                if(!parse_meta(entry, meta, zones, stats)) return nullptr;
+                file->advise_sequential(entry.offsets.offset, entry.offsets.length);
+                const uint64_t *offsets = reinterpret_cast<const uint64_t *>(base + entry.offsets.offset);
+                auto arr = NullableArray<std::string>::mapped(file, nrows, bits, values, length, offsets);
+                return std::unique_ptr<Column>(new StringColumn(std::move(arr), std::move(zones)));
+            }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<DataFrame> FrameFile::open_mmap(const std::string& path, const std::vector<size_t>& cols) {
+    std::shared_ptr<const MappedFile> file = MappedFile::open(path);
+    if(!file || file->size() < sizeof(Header)) return nullptr;
+    Header header;
+    memcpy(&header, file->data(), sizeof(header));
+    if(!_check_header(header, file->size())) return nullptr;
+    std::vector<ColumnEntry> entries(header.ncols);
+    memcpy(entries.data(), file->data() + sizeof(Header), entries.size() * sizeof(ColumnEntry));
+    std::vector<size_t> selected;
+    std::string types;
+    if(!_select(header, entries, file->size(), cols, selected, types)) return nullptr;
+
+    std::vector<std::unique_ptr<Column>> columns(selected.size());
+    std::vector<std::shared_ptr<ColumnStats>> stats(selected.size());
+    for(size_t i = 0; i < selected.size(); ++i) {
+        columns[i] = _map_column(file, entries[selected[i]], header.nrows, stats[i]);
+    }
+    return make_frame(types, std::move(columns), stats);
+}
@@ -0,0 +1,122 @@
+#include <unistd.h>
+#include <cerrno>
+#include <charconv>
+#include <string_view>
+#include <algorithm>
+
+#include "data/frame_writer.h"
+
+/** Writes the whole buffer to the file descriptor. */
+static bool write_all(int fd, const std::string& buf) {
+    const char *b = buf.data();
+    size_t len = buf.size();
+    while(len > 0) {
+        ssize_t written = write(fd, b, len);
+        if(written < 0 && errno == EINTR) continue;
+        if(written <= 0) return false;
+        b += written;
+        len -= written;
+    }
+    return true;
+}
+
+static void append_value(std::string& out, bool val, [[maybe_unused]] bool csv) {
+    out += val ? '1' : '0';
+}
+
+static void append_value(std::string& out, int val, [[maybe_unused]] bool csv) {
+    char buf[16];
+    auto res = std::to_chars(buf, buf + sizeof(buf), val);
+    out.append(buf, res.ptr);
+}
+
+static void append_value(std::string& out, double val, [[maybe_unused]] bool csv) {
+    char buf[32];
+    auto res = std::to_chars(buf, buf + sizeof(buf), val);
+    out.append(buf, res.ptr);
+    // keep whole numbers from being read back as ints
+    if(std::find_if(buf, res.ptr, [](char c){ return c == '.' || c == 'e' || c == 'n'; }) == res.ptr) {
+        out += ".0";
+    }
+}
+
+static void append_value(std::string& out, std::string_view val, bool csv) {
+    if(!csv) {
+        out += '"';
+        out += val;
+        out += '"';
+    } else if(val.empty() || val.find_first_of(",\"\n\r") != std::string_view::npos) {
+        out += '"';
+        for(char c : val) {
+            if(c == '"') out += '"';
+            out += c;
+        }
+        out += '"';
+    } else {
+        out += val;
+    }
+}
+
+/** Appends the value of the column at the given row, if it exists. */
+template< typename C >
+static void append_field(std::string& out, const Column& col, size_t row, bool csv) {
+    static_cast<const C&>(col).get_array().visit([&out, row, csv](const auto& bits, const auto& values){
+        if(bits[row]) append_value(out, values[row], csv);
+    });
+}
+
+bool FrameWriter::write_sor(const DataFrame& df, int fd) {
+    return _write(df, fd, Format::SOR);
+}
+
+bool FrameWriter::write_csv(const DataFrame& df, int fd) {
+    return _write(df, fd, Format::CSV);
+}
+
+void FrameWriter::_format_rows(const DataFrame& df, size_t start, size_t end, Format format,
+                               std::string& out) {
+    bool csv = format == Format::CSV;
+    size_t ncols = df.ncols();
+    for(size_t r = start; r < end; ++r) {
+        for(size_t c = 0; c < ncols; ++c) {
+            if(csv && c > 0) out += ',';
+            if(!csv) out += '<';
+            const Column& col = df.get_column(c);
+            switch(col.get_type()) {
+                case 'I':
+                    append_field<IntColumn>(out, col, r, csv);
+                    break;
+                case 'F':
+                    append_field<FloatColumn>(out, col, r, csv);
+                    break;
+                case 'B':
+                    append_field<BoolColumn>(out, col, r, csv);
+                    break;
+                case 'S':
+                    append_field<StringColumn>(out, col, r, csv);
+                    break;
+            }
+            if(!csv) out += '>';
+        }
+        out += '\n';
+    }
+}
+
+bool FrameWriter::_write(const DataFrame& df, int fd, Format format) {
+    size_t nrows = df.nrows();
+    size_t chunks = (nrows + PARALLEL_CHUNK_ROWS - 1) / PARALLEL_CHUNK_ROWS;
+    // the buffers keep their capacity from one wave to the next
+    std::vector<std::string> buffers(std::min<size_t>(chunks, MAX_THREADS));
+    for(size_t wave = 0; wave < chunks; wave += buffers.size()) {
+        size_t count = std::min(buffers.size(), chunks - wave);
+        parallel_for(count, [&df, &buffers, format, nrows, wave](size_t i){
+            size_t start = (wave + i) * PARALLEL_CHUNK_ROWS;
+            buffers[i].clear();
+            _format_rows(df, start, std::min(nrows, start + PARALLEL_CHUNK_ROWS), format, buffers[i]);
+        });
+        for(size_t i = 0; i < count; ++i) {
+            if(!write_all(fd, buffers[i])) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,119 @@
+#include <cassert>
+
+#include "data/int_set.h"
+
+uint32_t IntSet::_key(int v) {
+    return uint32_t(v) ^ 0x80000000u;
+}
+
+int IntSet::_value(uint32_t k) {
+    return int(k ^ 0x80000000u);
+}
+
+IntSet::IntSet() : _bits() {}
+
+IntSet::IntSet(Bitmap&& bits) : _bits(std::move(bits)) {}
+
+std::shared_ptr<IntSet> IntSet::from_frame(const DataFrame& df, size_t col) {
+    auto set = std::make_shared<IntSet>();
+    const Column& column = df.get_column(col);
+    assert(column.get_type() == 'I');
+    const NullableArray<int>& arr = static_cast<const IntColumn&>(column).get_array();
+    arr.visit([&set](auto& bitmap, auto& data){
+        for(size_t r = 0; r < data.size(); ++r) {
+            if(bitmap[r]) set->add(data[r]);
+        }
+    });
+    return set;
+}
+
+void IntSet::add(int v) {
+    _bits.add(_key(v));
+}
+
+bool IntSet::remove(int v) {
+    return _bits.remove(_key(v));
+}
+
+bool IntSet::contains(int v) const {
+    return _bits.contains(_key(v));
+}
+
+size_t IntSet::size() const {
+    return _bits.cardinality();
+}
+
+bool IntSet::empty() const {
+    return _bits.empty();
+}
+
+int IntSet::min() const {
+    return _value(_bits.min());
+}
+
+int IntSet::max() const {
+    return _value(_bits.max());
+}
+
+IntSet IntSet::operator&(const IntSet& other) const {
+    return IntSet(_bits & other._bits);
+}
+
+IntSet IntSet::operator|(const IntSet& other) const {
+    return IntSet(_bits | other._bits);
+}
+
+IntSet& IntSet::operator|=(const IntSet& other) {
+    _bits = _bits | other._bits;
+    return *this;
+}
+
+IntSet IntSet::and_not(const IntSet& other) const {
+    return IntSet(_bits.and_not(other._bits));
+}
+
+std::vector<int> IntSet::to_vector() const {
+    std::vector<int> vals;
+    vals.reserve(this->size());
+    this->for_each([&vals](int v){ vals.push_back(v); });
+    return vals;
+}
+
+bool IntSet::equals(const Object *other) const {
+    auto ois = dynamic_cast<const IntSet *>(other);
+    if(ois) return _bits == ois->_bits;
+    return false;
+}
+
+size_t IntSet::hash() const {
+    return _bits.hash();
+}
+
+std::shared_ptr<Object> IntSet::clone() const {
+    return std::make_shared<IntSet>(*this);
+}
+
+std::vector<uint8_t> IntSet::serialize() const {
+    return _bits.serialize();
+}
+
+void IntSet::serialize_into(ByteWriter& w) const {
+    _bits.serialize_into(w);
+}
+
+size_t IntSet::serialized_size() const {
+    return _bits.serialized_size();
+}
+
+void put_int_set(KVStore::Key k, const IntSet& set) {
+    std::vector<uint8_t> bytes = set.serialize();
+    DataFrame::from_scalar(k, std::string(bytes.begin(), bytes.end()));
+}
+
+std::shared_ptr<IntSet> get_int_set(const KVStore::Key& k) {
+    std::shared_ptr<DataFrame> df = KVStore::get_instance().get_or_wait(k);
+    std::string s = *df->get_string(0, 0);
+    std::vector<uint8_t> bytes(s.begin(), s.end());
+    size_t pos = 0;
+    return std::make_shared<IntSet>(Serializable::deserialize<IntSet>(bytes, pos));
+}
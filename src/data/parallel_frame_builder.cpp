@@ -0,0 +1,118 @@
+#include "data/parallel_frame_builder.h"
+#include "data/dataframe.h"
+
+// Segment
+ParallelFrameBuilder::Segment::Segment(const Schema& schema) : _columns() {
+    for(size_t i = 0; i < schema.width(); ++i) {
+        auto col = Column::from_type(schema.col_type(i));
+        assert(col);
+        _columns.push_back(std::move(col));
+    }
+}
+
+void ParallelFrameBuilder::Segment::push_back(size_t col, std::optional<int> val) {
+    assert(col < _columns.size());
+    _columns[col]->push_back(val);
+}
+
+void ParallelFrameBuilder::Segment::push_back(size_t col, std::optional<double> val) {
+    assert(col < _columns.size());
+    _columns[col]->push_back(val);
+}
+
+void ParallelFrameBuilder::Segment::push_back(size_t col, std::optional<bool> val) {
+    assert(col < _columns.size());
+    _columns[col]->push_back(val);
+}
+
+void ParallelFrameBuilder::Segment::push_back(size_t col, std::optional<std::string> val) {
+    assert(col < _columns.size());
+    _columns[col]->push_back(std::move(val));
+}
+
+void ParallelFrameBuilder::Segment::add_row(const Row& row) {
+    for(size_t c = 0; c < _columns.size(); ++c){
+        switch(row.col_type(c)){
+            case 'I':
+                _columns[c]->push_back(row.get_int(c));
+                break;
+            case 'F':
+                _columns[c]->push_back(row.get_double(c));
+                break;
+            case 'B':
+                _columns[c]->push_back(row.get_bool(c));
+                break;
+            case 'S':
+                _columns[c]->push_back(row.get_string(c));
+                break;
+            default:
+                assert(false); // unreachable
+        }
+    }
+}
+
+size_t ParallelFrameBuilder::Segment::nrows() const {
+    return _columns.empty() ? 0 : _columns[0]->size();
+}
+
+void ParallelFrameBuilder::Segment::reserve(size_t rows) {
+    for(auto& col : _columns) col->reserve(rows);
+}
+
+// ParallelFrameBuilder
+ParallelFrameBuilder::ParallelFrameBuilder(const Schema& schema) : _schema(schema), _segments() {
+    this->set_workers(1);
+}
+
+void ParallelFrameBuilder::set_workers(size_t worker_cnt) {
+    while(_segments.size() < worker_cnt) {
+        _segments.push_back(std::make_unique<Segment>(_schema));
+    }
+}
+
+size_t ParallelFrameBuilder::workers() const {
+    return _segments.size();
+}
+
+ParallelFrameBuilder::Segment& ParallelFrameBuilder::segment(size_t worker) {
+    assert(worker < _segments.size());
+    return *_segments[worker];
+}
+
+size_t ParallelFrameBuilder::nrows() const {
+    size_t rows = 0;
+    for(size_t i = 0; i < _segments.size(); ++i) {
+        rows += _segments[i]->nrows();
+    }
+    return rows;
+}
+
+std::shared_ptr<DataFrame> ParallelFrameBuilder::finish() {
+    // the first segment becomes the base, every other one is spliced onto it
+    size_t rows = this->nrows();
+    std::vector<std::unique_ptr<Column>> columns = std::move(_segments[0]->_columns);
+    if(_segments.size() > 1) {
+        for(auto& col : columns) col->reserve(rows);
+    }
+    for(size_t s = 1; s < _segments.size(); ++s) {
+        for(size_t c = 0; c < columns.size(); ++c) {
+            columns[c]->append(std::move(*_segments[s]->_columns[c]));
+        }
+    }
+
+    _segments.clear();
+    this->set_workers(1);
+    return std::make_shared<DataFrame>(std::make_unique<Schema>(_schema), std::move(columns));
+}
+
+size_t ParallelFrameBuilder::hash() const {
+    return reinterpret_cast<size_t>(this);
+}
+
+bool ParallelFrameBuilder::equals(const Object *other) const {
+    return this == other;
+}
+
+std::shared_ptr<Object> ParallelFrameBuilder::clone() const {
+    return nullptr;
+}
@@ -0,0 +1,51 @@
+#include "data/range_predicate.h"
+
+RangePredicate::RangePredicate(size_t col, int lo, int hi) : _col(col), _range(std::make_pair(lo, hi)) {}
+
+RangePredicate::RangePredicate(size_t col, double lo, double hi) : _col(col), _range(std::make_pair(lo, hi)) {}
+
+RangePredicate::RangePredicate(size_t col, std::string lo, std::string hi)
+: _col(col), _range(std::make_pair(std::move(lo), std::move(hi))) {}
+
+size_t RangePredicate::col() const {
+    return _col;
+}
+
+bool RangePredicate::may_match(const Column& col, size_t zone) const {
+    switch(col.get_type()) {
+        case 'I': {
+            auto range = std::get_if<std::pair<int, int>>(&_range);
+            exit_if_not(range, "Range type does not match the column type.");
+            return static_cast<const IntColumn&>(col).get_zones().may_contain(zone, range->first, range->second);
+        }
+        case 'F': {
+            auto range = std::get_if<std::pair<double, double>>(&_range);
+            exit_if_not(range, "Range type does not match the column type.");
+            return static_cast<const FloatColumn&>(col).get_zones().may_contain(zone, range->first, range->second);
+        }
+        case 'S': {
+            auto range = std::get_if<std::pair<std::string, std::string>>(&_range);
+            exit_if_not(range, "Range type does not match the column type.");
+            return static_cast<const StringColumn&>(col).get_zones().may_contain(zone, range->first, range->second);
+        }
+        default:
+            exit_if_not(false, "Range type does not match the column type.");
+            return true; // unreachable
+    }
+}
+
+size_t RangePredicate::hash() const {
+    return _col ^ (_range.index() << 8);
+}
+
+bool RangePredicate::equals(const Object *other) const {
+    auto orp = dynamic_cast<const RangePredicate *>(other);
+    if(orp) {
+        return _col == orp->_col && _range == orp->_range;
+    }
+    return false;
+}
+
+std::shared_ptr<Object> RangePredicate::clone() const {
+    return std::make_shared<RangePredicate>(*this);
+}
@@ -0,0 +1,10 @@
+#include "data/rower.h"
+
+/** Called by map and pmap before traversal starts with the index of the
+worker this rower is going to run on. Does nothing by default. */
+void Rower::start_worker([[maybe_unused]]size_t worker, [[maybe_unused]]size_t worker_cnt){}
+
+/** Returns true if joining is associative. Returns false by default. */
+bool Rower::join_is_associative() const {
+    return false;
+}
@@ -3,10 +3,10 @@
 /** Copying constructor */
 Schema::Schema(const Schema& from) : _columnNames(),_rowNames(),
  _columnTypes(from._columnTypes), _width(from._width),
-_length(from._length) {}
+_length(from._length), _stats() {}
 
 /** Create an empty schema **/
-Schema::Schema() : _columnNames(), _rowNames(), _columnTypes(), _width(0), _length(0) {}
+Schema::Schema() : _columnNames(), _rowNames(), _columnTypes(), _width(0), _length(0), _stats() {}
 
 /** Create a schema from a string of types. A string that contains
 * characters other than those identifying the four type results in
@@ -15,7 +15,7 @@ Schema::Schema() : _columnNames(), _rowNames(), _columnTypes(), _width(0), _leng
 Schema::Schema(const std::string& types) : Schema(types.c_str()) {}
 
 Schema::Schema(const char* types) : _columnNames(), _rowNames(),
-_columnTypes(), _width(0), _length(0) {
+_columnTypes(), _width(0), _length(0), _stats() {
     const char *c = types;
     while(*c != '\0') {
         if(*c != ' '){
@@ -49,6 +49,14 @@ void Schema::add_row(std::optional<std::string> name) {
     ++_length;
 }
 
+void Schema::reserve_rows(size_t rows) {
+    _rowNames.reserve(rows);
+}
+
+void Schema::shrink_to_fit() {
+    _rowNames.shrink_to_fit();
+}
+
 /** Return name of row at idx; nullptr indicates no name. An idx >= width
 * is undefined. */
 std::optional<std::string> Schema::row_name(size_t idx) const {
@@ -97,6 +105,17 @@ size_t Schema::length() const {
     return _length;
 }
 
+std::shared_ptr<const ColumnStats> Schema::col_stats(size_t idx) const {
+    if(idx >= _stats.size()) return nullptr;
+    return _stats[idx];
+}
+
+void Schema::set_col_stats(size_t idx, std::shared_ptr<const ColumnStats> stats) {
+    assert(idx < _width);
+    if(_stats.size() < _width) _stats.resize(_width);
+    _stats[idx] = std::move(stats);
+}
+
 std::shared_ptr<Object> Schema::clone() const {
     return std::make_shared<Schema>(*this);
 }
@@ -147,13 +166,16 @@ size_t Schema::hash() const {
 }
 
 std::vector<uint8_t> Schema::serialize() const {
-    auto serialized = Serializable::serialize<size_t>(this->_width);
+    return this->_serialize_exact();
+}
 
+void Schema::serialize_into(ByteWriter& w) const {
+    w.write_size(this->_width);
     // schema type
-    for(size_t i = 0; i < this->_width; ++i) {
-        auto temp = Serializable::serialize<char>(_columnTypes[i]);
-        serialized.insert(serialized.end(), temp.begin(), temp.end());
-    }
-    return serialized;
+    w.write_bytes(_columnTypes.data(), this->_width);
+}
+
+size_t Schema::serialized_size() const {
+    return sizeof(size_t) + this->_width;
 }
 
@@ -68,7 +68,18 @@ void Connection::_send_shutdown() {
 }
 
 bool Connection::_send_packet(Packet& packet) {
-    std::vector packed = packet.pack();
+    // send the header and the value together, without copying the value
+    uint8_t header[PACKET_HEADER_LEN];
+    packet.pack_header(header);
+    iovec parts[2];
+    parts[0].iov_base = header;
+    parts[0].iov_len = PACKET_HEADER_LEN;
+    parts[1].iov_base = packet.value.data();
+    parts[1].iov_len = packet.value.size();
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = parts;
+    msg.msg_iovlen = 2;
     int attempt = 0;
     ssize_t sent = 0;
 
@@ -84,7 +95,7 @@ bool Connection::_send_packet(Packet& packet) {
         }
         fd_lock.lock();
 
-        if((sent = send(_conn_fd, packed.data(), packed.size(), 0)) < 0){
+        if((sent = sendmsg(_conn_fd, &msg, 0)) < 0){
             if(errno != EWOULDBLOCK && errno != EAGAIN) {
                 perror("Error sending packet: ");
                 return false;
@@ -1,14 +1,16 @@
 #include <cstring>
+#include <algorithm>
 #include <assert.h>
 
 #include "data/dataframe.h"
 #include "network/ctc_connection.h"
 #include "network/socket_util.h"
+#include "util/codec.h"
 
 CtCConnection::ValueRequest::ValueRequest(std::string k) : key(k), mutex(), cv(), value(nullptr) {}
 
 CtCConnection::CtCConnection(int fd, sockaddr_in other, Client& c, bool r) : Connection(fd, other),
-_client(c), _receiver(r) {
+_client(c), _receiver(r), _peer_encoding(Encoding::FIXED) {
     p("CTC Created!").p('\n');
 }
 
@@ -70,6 +72,7 @@ void CtCConnection::run() {
     } else {
         this->_as_client();
     }
+    this->_send_encoding();
 
     while(!this->is_finished() && this->dog_is_alive()){
         if(this->receive_and_parse()) {
@@ -102,17 +105,25 @@ void CtCConnection::_as_receiver(){
     p("As Receiver").p('\n');
 }
 
+void CtCConnection::_send_encoding(){
+    Packet packet;
+    packet.type = Packet::Type::ENCODING;
+    packet.value.push_back(uint8_t(ENCODING_LATEST));
+    if(!this->_send_packet(packet)){
+        pln("Failed to send encoding!");
+        this->_finished = true;
+    }
+}
+
 void CtCConnection::_send_keys(){
     auto key_set = KVStore::get_instance().get_local_keys();
 
+    // key lists are too small to be worth compressing
+    Encoding enc = _peer_encoding == Encoding::FIXED ? Encoding::FIXED : Encoding::COMPACT;
     Packet key_packet;
-    key_packet.type = Packet::Type::KEY_LIST;
-    for(std::string key : key_set) {
-        std::vector<uint8_t> serialized = Serializable::serialize<std::string>(key);
-        key_packet.value.insert(key_packet.value.end(),
-                                serialized.begin(),
-                                serialized.end());
-    }
+    key_packet.type = enc == Encoding::COMPACT ? Packet::Type::KEY_LIST_COMPACT
+                                               : Packet::Type::KEY_LIST;
+    key_packet.value = pack_keys(key_set, enc);
 
     if(!this->_send_packet(key_packet)){
         pln("Failed to send keys!");
@@ -120,27 +131,99 @@ void CtCConnection::_send_keys(){
     }
 }
 
+std::vector<uint8_t> CtCConnection::pack_keys(const std::unordered_set<std::string>& keys,
+                                              Encoding enc) {
+    std::vector<uint8_t> value;
+    ByteWriter w(value, enc);
+    if(enc == Encoding::FIXED) {
+        for(const std::string& key : keys) w.write(key);
+        return value;
+    }
+
+    // sorted, keys such as "uuids_degree_1" and "uuids_degree_2" only send
+    // what differs from the key before
+    std::vector<const std::string *> sorted;
+    sorted.reserve(keys.size());
+    for(const std::string& key : keys) sorted.push_back(&key);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::string *a, const std::string *b){ return *a < *b; });
+    const std::string *prev = nullptr;
+    for(const std::string *key : sorted) {
+        size_t shared = 0;
+        if(prev) {
+            size_t max = std::min(prev->size(), key->size());
+            while(shared < max && (*prev)[shared] == (*key)[shared]) ++shared;
+        }
+        w.write_varint(shared);
+        w.write_varint(key->size() - shared);
+        w.write_bytes(key->data() + shared, key->size() - shared);
+        prev = key;
+    }
+    return value;
+}
+
+std::vector<std::string> CtCConnection::unpack_keys(const std::vector<uint8_t>& value,
+                                                    Encoding enc) {
+    std::vector<std::string> keys;
+    size_t pos = 0;
+    ByteReader r(value, pos, enc);
+    while(r.remaining() > 0) {
+        if(enc == Encoding::FIXED) {
+            keys.push_back(r.read<std::string>());
+            continue;
+        }
+        size_t shared = r.read_varint();
+        size_t len = r.read_varint();
+        if(keys.empty() ? shared > 0 : shared > keys.back().size()) {
+            throw Serializable::ShortSerializedDataException();
+        }
+        std::string key = keys.empty() ? std::string() : keys.back().substr(0, shared);
+        key.append(reinterpret_cast<const char *>(r.read_bytes(len)), len);
+        keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
 ParseResult CtCConnection::_parse_data(Packet& packet) {
-    if(packet.type == Packet::Type::VALUE_RESPONSE) {
+    if(packet.type == Packet::Type::VALUE_RESPONSE
+            || packet.type == Packet::Type::VALUE_RESPONSE_COMPACT
+            || packet.type == Packet::Type::VALUE_RESPONSE_COMPRESSED) {
         return this->_parse_request_response(packet);
     } else if(packet.type == Packet::Type::VALUE_REQUEST) {
         return ParseResult::Response;
-    } else if(packet.type == Packet::Type::KEY_LIST){
+    } else if(packet.type == Packet::Type::KEY_LIST
+            || packet.type == Packet::Type::KEY_LIST_COMPACT){
         return this->_update_keys(packet);
+    } else if(packet.type == Packet::Type::ENCODING){
+        if(packet.value.size() != sizeof(uint8_t)) return ParseResult::ParseError;
+        // use the newest encoding both ends read
+        _peer_encoding = std::min(Encoding(packet.value[0]), ENCODING_LATEST);
+        return ParseResult::Success;
     }
 
     return Connection::_parse_data(packet);
 }
 
 ParseResult CtCConnection::_parse_request_response(Packet &packet) {
-    if(packet.type != Packet::Type::VALUE_RESPONSE) return ParseResult::ParseError;
+    Encoding enc = Encoding::FIXED;
+    if(packet.type == Packet::Type::VALUE_RESPONSE_COMPACT) enc = Encoding::COMPACT;
+    else if(packet.type == Packet::Type::VALUE_RESPONSE_COMPRESSED) enc = Encoding::COMPRESSED;
+    else if(packet.type != Packet::Type::VALUE_RESPONSE) return ParseResult::ParseError;
     // format of response: Key, Value
-    bool success = packet.value[0];
-    size_t pos = 1;
-    std::string k = Serializable::deserialize<std::string>(packet.value, pos);
+    size_t pos = 0;
+    ByteReader r(packet.value, pos, enc);
+    std::string k;
     std::shared_ptr<DataFrame> df = nullptr;
-    if(success) {
-        df = std::make_shared<DataFrame>(Serializable::deserialize<DataFrame>(packet.value, pos));
+    try {
+        bool success = r.read<bool>();
+        k = r.read<std::string>();
+        if(success) {
+            df = std::make_shared<DataFrame>(r.read<DataFrame>());
+        }
+    } catch(Serializable::ShortSerializedDataException& e) {
+        return ParseResult::ParseError;
+    } catch(Codec::CorruptDataException& e) {
+        return ParseResult::ParseError;
     }
 
     std::lock_guard<std::mutex> request_lock(_waiting_requests_mutex);
@@ -158,12 +241,18 @@ ParseResult CtCConnection::_parse_request_response(Packet &packet) {
 
 ParseResult CtCConnection::_update_keys(Packet& packet){
     /* pln("_update_keys"); */
-    if(packet.type != Packet::Type::KEY_LIST) return ParseResult::ParseError;
-    size_t pos = 0;
+    Encoding enc = Encoding::FIXED;
+    if(packet.type == Packet::Type::KEY_LIST_COMPACT) enc = Encoding::COMPACT;
+    else if(packet.type != Packet::Type::KEY_LIST) return ParseResult::ParseError;
 
-    while(pos < packet.value.size()){
-        KVStore::Key key(Serializable::deserialize<std::string>(packet.value, pos),
-                         this->get_conn_other());
+    std::vector<std::string> keys;
+    try {
+        keys = unpack_keys(packet.value, enc);
+    } catch(Serializable::ShortSerializedDataException& e) {
+        return ParseResult::ParseError;
+    }
+    for(const std::string& k : keys){
+        KVStore::Key key(k, this->get_conn_other());
         KVStore::get_instance().add_nonlocal(key);
     }
     return ParseResult::Success;
@@ -194,14 +283,24 @@ Packet CtCConnection::_get_requested_value(std::string key) {
     auto value = KVStore::get_instance().get_local(KVStore::Key(key));
 
     Packet response;
-    response.type = Packet::Type::VALUE_RESPONSE;
-    response.value.push_back(!!value);
-    auto serialized_key = Serializable::serialize<std::string>(key);
-    response.value.insert(response.value.end(), serialized_key.begin(), serialized_key.end());
-    if(value) {
-        auto serialized_value = value->serialize();
-        response.value.insert(response.value.end(), serialized_value.begin(), serialized_value.end());
+    switch(_peer_encoding) {
+        case Encoding::FIXED:
+            response.type = Packet::Type::VALUE_RESPONSE;
+            break;
+        case Encoding::COMPACT:
+            response.type = Packet::Type::VALUE_RESPONSE_COMPACT;
+            break;
+        case Encoding::COMPRESSED:
+            response.type = Packet::Type::VALUE_RESPONSE_COMPRESSED;
+            break;
     }
+    // serialize straight into the packet, allocating it once; the fixed size
+    // is about an upper bound of the others
+    ByteWriter w(response.value, _peer_encoding);
+    w.reserve(sizeof(bool) + ByteWriter::size_of(key) + (value ? value->serialized_size() : 0));
+    w.write<bool>(!!value);
+    w.write(key);
+    if(value) value->serialize_into(w);
     return response;
 }
 
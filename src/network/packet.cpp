@@ -1,4 +1,5 @@
 #include <cstring>
+#include <algorithm>
 
 #include "network/packet.h"
 
@@ -9,15 +10,9 @@ size_t Packet::get_size() const {
 }
 
 std::vector<uint8_t> Packet::pack() const {
-    std::vector<uint8_t> packed;
-
-    // add type of data
-    packed.push_back(this->type);
-
-    // add length of data (encoded as a 64 bit unsigned integer)
-    uint64_t len = this->value.size();
-    uint8_t *f_ptr = reinterpret_cast<uint8_t *>(&len);
-    packed.insert(packed.end(), f_ptr, f_ptr + sizeof(len));
+    std::vector<uint8_t> packed(PACKET_HEADER_LEN);
+    packed.reserve(PACKET_HEADER_LEN + this->value.size());
+    this->pack_header(packed.data());
 
     // add data
     packed.insert(packed.end(), this->value.begin(), this->value.end());
@@ -25,6 +20,15 @@ std::vector<uint8_t> Packet::pack() const {
     return packed;
 }
 
+void Packet::pack_header(uint8_t *header) const {
+    // add type of data
+    header[0] = this->type;
+
+    // add length of data (encoded as a 64 bit unsigned integer)
+    uint64_t len = this->value.size();
+    memcpy(header + sizeof(uint8_t), &len, sizeof(len));
+}
+
 int Packet::unpack(uint8_t *buffer, size_t buflen){
     /* p("unpack, buflen: ").p(buflen).p('\n'); */
     size_t pos = 0;
@@ -90,6 +94,8 @@ size_t Packet::partial_unpack(bool front, uint8_t *buffer, size_t buflen, bool&
         } else {
             memcpy(&remaining_len, buffer + pos, sizeof(remaining_len));
             pos += sizeof(remaining_len);
+            // allocate the value once instead of growing it a buffer at a time
+            this->value.reserve(std::min<uint64_t>(remaining_len, PACKET_MAX_RESERVE));
         }
     }
     
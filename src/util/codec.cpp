@@ -0,0 +1,207 @@
+#include <cstring>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "util/codec.h"
+
+// Codec::Report
+double Codec::Report::ratio() const {
+    return compressed_bytes == 0 ? 1.0 : double(raw_bytes) / double(compressed_bytes);
+}
+
+double Codec::Report::compress_mbps() const {
+    return compress_seconds <= 0 ? 0.0 : raw_bytes / compress_seconds / 1e6;
+}
+
+double Codec::Report::decompress_mbps() const {
+    return decompress_seconds <= 0 ? 0.0 : raw_bytes / decompress_seconds / 1e6;
+}
+
+std::string Codec::Report::to_string() const {
+    std::ostringstream out;
+    out <<std::fixed <<std::setprecision(2) <<Codec::get(codec).name() <<": "
+        <<raw_bytes <<" -> " <<compressed_bytes <<" bytes (" <<this->ratio() <<"x), "
+        <<this->compress_mbps() <<" MB/s compress, "
+        <<this->decompress_mbps() <<" MB/s decompress";
+    return out.str();
+}
+
+// Codec
+const Codec& Codec::get(CodecId id) {
+    static const NoneCodec none;
+    static const LzCodec lz;
+    switch(id) {
+        case CodecId::NONE:
+            return none;
+        case CodecId::LZ:
+            return lz;
+    }
+    throw CorruptDataException();
+}
+
+const Codec& Codec::choose(const uint8_t *in, size_t len, std::vector<uint8_t>& out) {
+    out.clear();
+    if(len < CODEC_MIN_BYTES) return Codec::get(CodecId::NONE);
+    const Codec& lz = Codec::get(CodecId::LZ);
+    lz.compress(in, len, out);
+    if(out.size() > len - len / 8) {
+        out.clear();
+        return Codec::get(CodecId::NONE);
+    }
+    return lz;
+}
+
+Codec::Report Codec::measure(const Codec& codec, const std::vector<uint8_t>& data) {
+    Report report;
+    report.codec = codec.id();
+    report.raw_bytes = data.size();
+
+    std::vector<uint8_t> compressed;
+    auto start = std::chrono::steady_clock::now();
+    codec.compress(data.data(), data.size(), compressed);
+    auto mid = std::chrono::steady_clock::now();
+    std::vector<uint8_t> decompressed(data.size());
+    codec.decompress(compressed.data(), compressed.size(), decompressed.data(), decompressed.size());
+    auto end = std::chrono::steady_clock::now();
+
+    report.compressed_bytes = compressed.size();
+    report.compress_seconds = std::chrono::duration<double>(mid - start).count();
+    report.decompress_seconds = std::chrono::duration<double>(end - mid).count();
+    return report;
+}
+
+// NoneCodec
+CodecId NoneCodec::id() const {
+    return CodecId::NONE;
+}
+
+const char *NoneCodec::name() const {
+    return "none";
+}
+
+void NoneCodec::compress(const uint8_t *in, size_t len, std::vector<uint8_t>& out) const {
+    out.insert(out.end(), in, in + len);
+}
+
+size_t NoneCodec::max_decompressed(size_t len) const {
+    return len;
+}
+
+void NoneCodec::decompress(const uint8_t *in, size_t len, uint8_t *out, size_t out_len) const {
+    if(len != out_len) throw CorruptDataException();
+    memcpy(out, in, len);
+}
+
+// LzCodec
+/** Appends the part of a length that does not fit in its 4 bits of the token. */
+static void lz_write_length(std::vector<uint8_t>& out, size_t n) {
+    for(; n >= 255; n -= 255) out.push_back(255);
+    out.push_back(uint8_t(n));
+}
+
+/** Appends a sequence of literals followed by a match, or only the literals if
+ * match_len is 0. */
+static void lz_write_sequence(std::vector<uint8_t>& out, const uint8_t *lits, size_t lit_len,
+                              size_t offset, size_t match_len) {
+    size_t extra = match_len == 0 ? 0 : match_len - LZ_MIN_MATCH;
+    out.push_back(uint8_t((std::min<size_t>(lit_len, 15) << 4) | std::min<size_t>(extra, 15)));
+    if(lit_len >= 15) lz_write_length(out, lit_len - 15);
+    out.insert(out.end(), lits, lits + lit_len);
+    if(match_len == 0) return;
+    out.push_back(uint8_t(offset));
+    out.push_back(uint8_t(offset >> 8));
+    if(extra >= 15) lz_write_length(out, extra - 15);
+}
+
+/** Reads the continuation of a length, adding it to n. */
+static void lz_read_length(const uint8_t *&in, const uint8_t *end, size_t& n) {
+    uint8_t b;
+    do {
+        if(in >= end) throw Codec::CorruptDataException();
+        b = *in++;
+        n += b;
+    } while(b == 255);
+}
+
+CodecId LzCodec::id() const {
+    return CodecId::LZ;
+}
+
+const char *LzCodec::name() const {
+    return "lz";
+}
+
+void LzCodec::compress(const uint8_t *in, size_t len, std::vector<uint8_t>& out) const {
+    // positions are stored plus one, so that 0 is empty
+    std::vector<uint32_t> table(size_t(1) << LZ_HASH_BITS, 0);
+    size_t anchor = 0; // the start of the literals not yet written
+    size_t i = 0;
+    while(i + LZ_MIN_MATCH <= len) {
+        uint32_t seq;
+        memcpy(&seq, in + i, sizeof(seq));
+        size_t h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+        size_t candidate = table[h];
+        table[h] = uint32_t(i + 1);
+
+        if(candidate == 0 || i - (candidate - 1) > LZ_MAX_OFFSET
+                || memcmp(in + candidate - 1, in + i, LZ_MIN_MATCH) != 0) {
+            i += 1 + ((i - anchor) >> 6);
+            continue;
+        }
+        size_t match = candidate - 1;
+        size_t match_len = LZ_MIN_MATCH;
+        while(i + match_len < len && in[match + match_len] == in[i + match_len]) ++match_len;
+
+        lz_write_sequence(out, in + anchor, i - anchor, i - match, match_len);
+        i += match_len;
+        anchor = i;
+    }
+    lz_write_sequence(out, in + anchor, len - anchor, 0, 0);
+}
+
+size_t LzCodec::max_decompressed(size_t len) const {
+    if(len > SIZE_MAX / LZ_MAX_EXPANSION) return SIZE_MAX;
+    return len * LZ_MAX_EXPANSION;
+}
+
+void LzCodec::decompress(const uint8_t *in, size_t len, uint8_t *out, size_t out_len) const {
+    const uint8_t *in_end = in + len;
+    uint8_t *op = out;
+    uint8_t *out_end = out + out_len;
+    while(true) {
+        if(in >= in_end) throw CorruptDataException();
+        uint8_t token = *in++;
+
+        size_t lit_len = token >> 4;
+        if(lit_len == 15) lz_read_length(in, in_end, lit_len);
+        if(lit_len > size_t(in_end - in) || lit_len > size_t(out_end - op)) {
+            throw CorruptDataException();
+        }
+        memcpy(op, in, lit_len);
+        op += lit_len;
+        in += lit_len;
+        if(in == in_end) break; // the last sequence has no match
+
+        if(in_end - in < 2) throw CorruptDataException();
+        size_t offset = size_t(in[0]) | (size_t(in[1]) << 8);
+        in += 2;
+        size_t match_len = token & 15;
+        if(match_len == 15) lz_read_length(in, in_end, match_len);
+        match_len += LZ_MIN_MATCH;
+        if(offset == 0 || offset > size_t(op - out) || match_len > size_t(out_end - op)) {
+            throw CorruptDataException();
+        }
+
+        const uint8_t *match = op - offset;
+        if(offset >= match_len) {
+            memcpy(op, match, match_len);
+            op += match_len;
+        } else {
+            // the match overlaps what it is writing, repeating the last offset bytes
+            for(size_t b = 0; b < match_len; ++b) *op++ = *match++;
+        }
+    }
+    if(op != out_end) throw CorruptDataException();
+}
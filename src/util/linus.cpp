@@ -4,21 +4,49 @@
 #include "network/network.h"
 #include "util/linus.h"
 #include "util/linus_rowers.h"
+#include "data/typed_frame.h"
 #include "adapter/sorer_dataframe_adapter.h"
 
 Linus::Linus() : Application(), _ip(nullptr), _server_ip(nullptr), _filename(),
-_server_port(SERVER_PORT), _mode(Mode::NONE) {}
+_server_port(SERVER_PORT), _mode(Mode::NONE), _stream(false) {}
+
+/** Maps the rower over every group in turn, skipping the blocks of rows
+ * outside pred if it is given. */
+static void pmap_groups(const std::vector<std::shared_ptr<DataFrame>>& groups, Rower& r,
+                        const RangePredicate *pred = nullptr) {
+    for(auto& group : groups) {
+        if(pred) group->pmap(r, *pred);
+        else group->pmap(r);
+    }
+}
 
 std::shared_ptr<DataFrame> Linus::_read_in_file(KVStore::Key k, std::string fn) const {
     std::cout <<"Reading in file: " <<fn <<std::endl;
-    auto df = SorerDataframeAdapter::parse_file(fn);
+    SorReader::Report report;
+    auto df = SorerDataframeAdapter::parse_file(fn, false, false, &report);
     std::cout <<"File Read in!" <<std::endl;
+    if(report.rows > 0) std::cout <<"Parsed " <<report.to_string() <<std::endl;
     assert(df);
     std::cout <<"Valid DF created!" <<std::endl;
     KVStore::get_instance().set(k, df);
     return df;
 }
 
+std::vector<std::shared_ptr<DataFrame>> Linus::_publish_groups(KVStore::Key k, SorStream& stream,
+                                                               Rower& r) const {
+    std::vector<std::shared_ptr<DataFrame>> groups;
+    for(auto group = stream.next(); group; group = stream.next()) {
+        KVStore::get_instance().set(KVStore::Key(k.get_name() + "/" + std::to_string(groups.size())),
+                                    group);
+        group->pmap(r);
+        groups.push_back(group);
+    }
+    DataFrame::from_scalar(KVStore::Key(k.get_name() + "/groups"), int(groups.size()));
+    std::cout <<"Streamed " <<stream.committed_rows() <<" rows in " <<groups.size()
+        <<" groups" <<std::endl;
+    return groups;
+}
+
 void Linus::_projects() {
     std::cout <<"Projects" <<std::endl;
     // read in projects file
@@ -38,12 +66,12 @@ void Linus::_users() {
     std::thread network_thread([]{ Client::get_instance().lock()->listen_on_socket(30); });
 
     // find linus and add him to a local dataframe
-    for(size_t r = 0; r < udf->nrows(); ++r) {
+    TypedFrame<int, std::string> users(*udf);
+    for(size_t r = 0; r < users.nrows(); ++r) {
         // look for linus
-        auto name = udf->get_string(1, r);
-        if(name && *name == std::string("torvalds")) {
-            std::cout <<"Linus UUID: " <<*udf->get_int(0, r) <<std::endl;
-            DataFrame::from_scalar(KVStore::Key("linus_uuid"), *udf->get_int(0, r));
+        if(users.exists<1>(r) && users.value<1>(r) == "torvalds") {
+            std::cout <<"Linus UUID: " <<users.value<0>(r) <<std::endl;
+            DataFrame::from_scalar(KVStore::Key("linus_uuid"), users.value<0>(r));
             break; // found linus
         }
     }
@@ -53,13 +81,12 @@ void Linus::_users() {
     std::string uuk = std::string("uuids_degree_");
     std::string uk = std::string("degree");
     for(size_t degree = 1; degree <= 7; ++degree) {
-        auto uudf = KVStore::get_instance().get_or_wait(KVStore::Key(uuk + std::to_string(degree)));
-        assert(uudf);
+        auto uuids = get_int_set(KVStore::Key(uuk + std::to_string(degree)));
         std::cout <<"Got UUIDs for degree " <<degree <<std::endl;
 
         // generate list of user names
-        UUIDsToNamesFilter uunf(uudf);
-        udf->pmap(uunf);
+        UUIDsToNamesFilter uunf(uuids);
+        udf->pmap(uunf, uunf.set_range(0));
         auto degree_names = uunf.finish_filter();
         KVStore::get_instance().set(KVStore::Key(uk + std::to_string(degree)),
                                     degree_names);
@@ -73,9 +100,18 @@ void Linus::_users() {
 
 void Linus::_commits() {
     std::cout <<"Commits" <<std::endl;
-    // read in commits file
-    auto cdf = this->_read_in_file(KVStore::Key("commits"), _filename);
-    std::cout <<"Commits read in!" <<std::endl;
+    KVStore::Key key("commits");
+    std::vector<std::shared_ptr<DataFrame>> groups;
+    std::shared_ptr<SorStream> stream;
+    if(_stream) {
+        // every group is kept for the later degrees, so the parser is never held back
+        stream = SorStream::open(_filename, SOR_GROUP_ROWS, 0);
+        assert(stream);
+    } else {
+        // read in commits file
+        groups.push_back(this->_read_in_file(key, _filename));
+        std::cout <<"Commits read in!" <<std::endl;
+    }
     std::thread network_thread([]{ Client::get_instance().lock()->listen_on_socket(30); });
     // get linus uuid
     auto luuid_df = KVStore::get_instance().get_or_wait(KVStore::Key("linus_uuid"));
@@ -84,9 +120,14 @@ void Linus::_commits() {
 
     // generate set of projects linus worked on
     UUIDsToProjectsFilter lpf(luuid_df);
-    cdf->pmap(lpf);
-    auto project_frame = lpf.finish_filter();
-    KVStore::get_instance().set(KVStore::Key("linus_projects"), project_frame);
+    if(stream) {
+        groups = this->_publish_groups(key, *stream, lpf);
+        std::cout <<"Commits read in!" <<std::endl;
+    } else {
+        pmap_groups(groups, lpf);
+    }
+    std::shared_ptr<const IntSet> projects = lpf.finish_set();
+    put_int_set(KVStore::Key("linus_projects"), *projects);
     std::cout <<"Linus Projects Generated!" <<std::endl;
 
     // now we generate the user degrees
@@ -94,21 +135,20 @@ void Linus::_commits() {
     std::string pk = std::string("projects_degree_");
     for(size_t degree = 1; degree <= 7; ++degree) {
         // store the list of uuids for each degree
-        ProjectsToUUIDsFilter ptuuf(project_frame);
-        cdf->pmap(ptuuf);
-        auto degree_uuids = ptuuf.finish_filter();
-        KVStore::get_instance().set(KVStore::Key(uuk + std::to_string(degree)),
-                                    degree_uuids);
+        ProjectsToUUIDsFilter ptuuf(projects);
+        RangePredicate range = ptuuf.set_range(0);
+        pmap_groups(groups, ptuuf, &range);
+        std::shared_ptr<const IntSet> degree_uuids = ptuuf.finish_set();
+        put_int_set(KVStore::Key(uuk + std::to_string(degree)), *degree_uuids);
         std::cout <<"UUIDs Degree " <<degree <<" Generated!" <<std::endl;
 
         if(degree == 7) break;
 
         // now we regenerate the larger list of projects for the next degree
         UUIDsToProjectsFilter uutpf(degree_uuids);
-        cdf->pmap(uutpf);
-        project_frame = uutpf.finish_filter();
-        KVStore::get_instance().set(KVStore::Key(pk + std::to_string(degree)),
-                                    project_frame);
+        pmap_groups(groups, uutpf);
+        projects = uutpf.finish_set();
+        put_int_set(KVStore::Key(pk + std::to_string(degree)), *projects);
         std::cout <<"Projects Degree " <<degree + 1 <<" Generated!" <<std::endl;
     }
 
@@ -143,6 +183,8 @@ void Linus::parse_arguments(int argc, char **argv) {
         } else if(strcmp(argv[i], "--file") == 0
                 || strcmp(argv[i], "-f") == 0){
             _filename = std::string(argv[++i]);
+        } else if(strcmp(argv[i], "--stream") == 0){
+            _stream = true;
         } else {
             std::cout <<"Unrecognized Option: " <<argv[i] <<std::endl;
         }
@@ -168,6 +210,8 @@ void Linus::_help(const char* bin_name) const {
         <<std::setw(20) <<"Set the port of the server (Default: " <<DEFAULT_SERVER_PORT <<")." <<std::endl;
     std::cout <<std::left <<std::setw(20) <<"--file, -f:" 
         <<std::setw(20) <<"Set the file to be read in." <<std::endl;
+    std::cout <<std::left <<std::setw(20) <<"--stream:" 
+        <<std::setw(20) <<"Stream the commits file in row groups, using each group as soon as it is parsed." <<std::endl;
     exit(0);
 }
 
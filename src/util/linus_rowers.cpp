@@ -1,109 +1,113 @@
 #include "util/linus_rowers.h"
 
 // IntSetGenerator
-IntSetGenerator::IntSetGenerator() : _mutex(std::make_shared<std::mutex>()),
-_set(std::make_shared<std::unordered_set<int>>()) {}
-
-IntSetGenerator::IntSetGenerator(std::shared_ptr<std::mutex> m, std::shared_ptr<std::unordered_set<int>> s) : _mutex(m), _set(s) {}
+IntSetGenerator::IntSetGenerator() : _set() {}
 
 bool IntSetGenerator::accept(Row& row) {
     for(size_t c = 0; c < row.width(); ++c) {
         if(row.col_type(c) == 'I') {
-            std::lock_guard<std::mutex> guard(*_mutex);
-            _set->insert(*row.get_int(c));
+            std::optional<int> v = row.get_int(c);
+            if(v) _set.add(*v);
         }
     }
     return true;
 }
 
-// we don't need to do anything
-void IntSetGenerator::join([[maybe_unused]] std::shared_ptr<Rower> other) {}
+void IntSetGenerator::join(std::shared_ptr<Rower> other) {
+    auto isg = std::dynamic_pointer_cast<IntSetGenerator>(other);
+    assert(isg);
+    _set |= isg->_set;
+}
+
+bool IntSetGenerator::join_is_associative() const {
+    return true;
+}
 
-std::shared_ptr<std::unordered_set<int>> IntSetGenerator::finish_set() {
-    std::lock_guard<std::mutex> guard(*_mutex);
-    assert(_set.use_count() == 1);
-    auto r = _set;
-    _set = std::make_shared<std::unordered_set<int>>();
+std::shared_ptr<IntSet> IntSetGenerator::finish_set() {
+    auto r = std::make_shared<IntSet>(std::move(_set));
+    _set = IntSet();
     return r;
 }
 
 size_t IntSetGenerator::hash() const {
-    return reinterpret_cast<size_t>(_mutex.get()) ^ reinterpret_cast<size_t>(_set.get());
+    return _set.hash();
 }
 
 bool IntSetGenerator::equals(const Object *other) const {
     auto other_isg = dynamic_cast<const IntSetGenerator *>(other);
-    if(other_isg) {
-        return _mutex == other_isg->_mutex && _set == other_isg->_set;
-    }
+    if(other_isg) return _set.equals(&other_isg->_set);
     return false;
 }
 
 std::shared_ptr<Object> IntSetGenerator::clone() const {
-    return std::make_shared<IntSetGenerator>(_mutex, _set);
+    return std::make_shared<IntSetGenerator>();
 }
 
 // UnorderedFilter
-UnorderedFilter::UnorderedFilter(std::unique_ptr<Schema> s) : _df_mutex(std::make_shared<std::mutex>()), _gen_df(std::make_shared<DataFrame>(std::move(s))), _set(std::make_shared<std::unordered_set<int>>()), _row(_gen_df->get_schema()) {}
+UnorderedFilter::UnorderedFilter(std::unique_ptr<Schema> s, std::shared_ptr<const IntSet> set)
+: _builder(std::make_shared<ParallelFrameBuilder>(*s)), _segment(&_builder->segment(0)),
+_set(set) {}
 
-UnorderedFilter::UnorderedFilter(std::shared_ptr<std::mutex> dfm,
-                                 std::shared_ptr<DataFrame> df,
-                                 std::shared_ptr<std::unordered_set<int>> s)
-: _df_mutex(dfm), _gen_df(df), _set(s), _row(_gen_df->get_schema()) {}
+UnorderedFilter::UnorderedFilter(std::shared_ptr<ParallelFrameBuilder> builder,
+                                 std::shared_ptr<const IntSet> s)
+: _builder(builder), _segment(&_builder->segment(0)), _set(s) {}
 
-bool UnorderedFilter::_set_contains(int v) {
+bool UnorderedFilter::_set_contains(int v) const {
     // read only so can avoid locking
-    return _set->find(v) != _set->end();
+    return _set->contains(v);
 }
 
 void UnorderedFilter::_add_to_df(int v) {
-    std::lock_guard<std::mutex> guard(*_df_mutex);
-    assert(_row.col_type(0) == 'I');
-    _row.set(0, std::optional<int>(v));
-    _gen_df->add_row(_row);
+    _segment->push_back(0, std::optional<int>(v));
 }
 
 void UnorderedFilter::_add_to_df(std::string v) {
-    std::lock_guard<std::mutex> guard(*_df_mutex);
-    assert(_row.col_type(0) == 'S');
-    _row.set(0, std::optional<std::string>(v));
-    _gen_df->add_row(_row);
+    _segment->push_back(0, std::optional<std::string>(std::move(v)));
+}
+
+RangePredicate UnorderedFilter::set_range(size_t col) const {
+    if(_set->empty()) return RangePredicate(col, 1, 0); // matches nothing
+    return RangePredicate(col, _set->min(), _set->max());
 }
 
 std::shared_ptr<DataFrame> UnorderedFilter::finish_filter() {
-    std::lock_guard<std::mutex> guard(*_df_mutex);
-    assert(_gen_df.use_count() == 1); // must only have one reference to finish
-    auto r = _gen_df;
-    _gen_df = std::make_shared<DataFrame>(std::make_unique<Schema>(r->get_schema()));
+    assert(_builder.use_count() == 1); // must only have one reference to finish
+    auto r = _builder->finish();
+    _segment = &_builder->segment(0);
     return r;
 }
 
+std::shared_ptr<IntSet> UnorderedFilter::finish_set() {
+    return IntSet::from_frame(*this->finish_filter());
+}
+
 // we don't need to do anything
 void UnorderedFilter::join([[maybe_unused]] std::shared_ptr<Rower> other) {}
 
+void UnorderedFilter::start_worker(size_t worker, size_t worker_cnt) {
+    _builder->set_workers(worker_cnt);
+    _segment = &_builder->segment(worker);
+}
+
 size_t UnorderedFilter::hash() const {
-    return reinterpret_cast<size_t>(_df_mutex.get()) 
-            ^ reinterpret_cast<size_t>(_gen_df.get())
+    return reinterpret_cast<size_t>(_builder.get())
             ^ reinterpret_cast<size_t>(_set.get());
 }
 
 bool UnorderedFilter::_ptr_equality(const UnorderedFilter& other_uf) const{
-    return _df_mutex == other_uf._df_mutex && _gen_df == other_uf._gen_df
-           && _set == other_uf._set;
+    return _builder == other_uf._builder && _set == other_uf._set;
 }
 
 // UUIDsToProjectsFilter
 UUIDsToProjectsFilter::UUIDsToProjectsFilter(std::shared_ptr<DataFrame> uuid_df) 
-: UnorderedFilter(std::make_unique<Schema>("I")) {
-    IntSetGenerator isg;
-    uuid_df->map(isg);
-    _set = isg.finish_set();
-}
+: UUIDsToProjectsFilter(IntSet::from_frame(*uuid_df)) {}
+
+UUIDsToProjectsFilter::UUIDsToProjectsFilter(std::shared_ptr<const IntSet> uuids)
+: UnorderedFilter(std::make_unique<Schema>("I"), uuids) {}
 
-UUIDsToProjectsFilter::UUIDsToProjectsFilter(std::shared_ptr<std::mutex> m,
-                                             std::shared_ptr<DataFrame> df,
-                                             std::shared_ptr<std::unordered_set<int>> uuids)
-: UnorderedFilter(m, df, uuids) {}
+UUIDsToProjectsFilter::UUIDsToProjectsFilter(std::shared_ptr<ParallelFrameBuilder> builder,
+                                             std::shared_ptr<const IntSet> uuids)
+: UnorderedFilter(builder, uuids) {}
 
 bool UUIDsToProjectsFilter::accept(Row& r) {
     // this works on the commit dataframe
@@ -114,7 +118,7 @@ bool UUIDsToProjectsFilter::accept(Row& r) {
 }
 
 std::shared_ptr<Object> UUIDsToProjectsFilter::clone() const {
-    return std::make_shared<UUIDsToProjectsFilter>(_df_mutex, _gen_df, _set);
+    return std::make_shared<UUIDsToProjectsFilter>(_builder, _set);
 }
 
 bool UUIDsToProjectsFilter::equals(const Object *other) const {
@@ -124,16 +128,15 @@ bool UUIDsToProjectsFilter::equals(const Object *other) const {
 }
 
 // ProjectsToUUIDsFilter
-ProjectsToUUIDsFilter::ProjectsToUUIDsFilter(std::shared_ptr<DataFrame> projects_df) : UnorderedFilter(std::make_unique<Schema>("I")) {
-    IntSetGenerator isg;
-    projects_df->map(isg);
-    _set = isg.finish_set();
-}
+ProjectsToUUIDsFilter::ProjectsToUUIDsFilter(std::shared_ptr<DataFrame> projects_df)
+: ProjectsToUUIDsFilter(IntSet::from_frame(*projects_df)) {}
+
+ProjectsToUUIDsFilter::ProjectsToUUIDsFilter(std::shared_ptr<const IntSet> pids)
+: UnorderedFilter(std::make_unique<Schema>("I"), pids) {}
 
-ProjectsToUUIDsFilter::ProjectsToUUIDsFilter(std::shared_ptr<std::mutex> m,
-                                             std::shared_ptr<DataFrame> df,
-                                             std::shared_ptr<std::unordered_set<int>> pids)
-: UnorderedFilter(m, df, pids) {}
+ProjectsToUUIDsFilter::ProjectsToUUIDsFilter(std::shared_ptr<ParallelFrameBuilder> builder,
+                                             std::shared_ptr<const IntSet> pids)
+: UnorderedFilter(builder, pids) {}
 
 bool ProjectsToUUIDsFilter::accept(Row& r) {
     // works on commit dataframe
@@ -145,7 +148,7 @@ bool ProjectsToUUIDsFilter::accept(Row& r) {
 }
 
 std::shared_ptr<Object> ProjectsToUUIDsFilter::clone() const {
-    return std::make_shared<ProjectsToUUIDsFilter>(_df_mutex, _gen_df, _set);
+    return std::make_shared<ProjectsToUUIDsFilter>(_builder, _set);
 }
 
 bool ProjectsToUUIDsFilter::equals(const Object *other) const {
@@ -156,15 +159,14 @@ bool ProjectsToUUIDsFilter::equals(const Object *other) const {
 
 // UUIDsToNamesFilter
 UUIDsToNamesFilter::UUIDsToNamesFilter(std::shared_ptr<DataFrame> uuid_df) 
-    : UnorderedFilter(std::make_unique<Schema>("S")) {
-    IntSetGenerator isg;
-    uuid_df->map(isg);
-    _set = isg.finish_set();
-}
+    : UUIDsToNamesFilter(IntSet::from_frame(*uuid_df)) {}
+
+UUIDsToNamesFilter::UUIDsToNamesFilter(std::shared_ptr<const IntSet> uuids)
+    : UnorderedFilter(std::make_unique<Schema>("S"), uuids) {}
 
-UUIDsToNamesFilter::UUIDsToNamesFilter(std::shared_ptr<std::mutex> m, std::shared_ptr<DataFrame> df,
-                                        std::shared_ptr<std::unordered_set<int>> uuids)
-: UnorderedFilter(m, df, uuids) {}
+UUIDsToNamesFilter::UUIDsToNamesFilter(std::shared_ptr<ParallelFrameBuilder> builder,
+                                             std::shared_ptr<const IntSet> uuids)
+: UnorderedFilter(builder, uuids) {}
 
 bool UUIDsToNamesFilter::accept(Row& row) {
     // works on users dataframe
@@ -175,7 +177,7 @@ bool UUIDsToNamesFilter::accept(Row& row) {
 }
 
 std::shared_ptr<Object> UUIDsToNamesFilter::clone() const {
-    return std::make_shared<UUIDsToNamesFilter>(_df_mutex, _gen_df, _set);
+    return std::make_shared<UUIDsToNamesFilter>(_builder, _set);
 }
 
 bool UUIDsToNamesFilter::equals(const Object *other) const {
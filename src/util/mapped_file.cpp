@@ -0,0 +1,62 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include "util/mapped_file.h"
+
+/** Calls madvise on the pages covering [offset, offset + len) of the mapping.
+ * The advice is only a hint, so failures are ignored. */
+static void advise(const uint8_t *data, size_t size, size_t offset, size_t len, int advice) {
+    if(offset >= size || len == 0) return;
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t start = offset / page * page;
+    size_t end = std::min(size, offset + len);
+    madvise(const_cast<uint8_t *>(data) + start, end - start, advice);
+}
+
+MappedFile::MappedFile(const uint8_t *data, size_t size) : _data(data), _size(size) {}
+
+MappedFile::~MappedFile() {
+    if(_size > 0) munmap(const_cast<uint8_t *>(_data), _size);
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return nullptr;
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    size_t size = st.st_size;
+    void *data = nullptr;
+    if(size > 0) {
+        data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    // the mapping keeps the file open
+    close(fd);
+    if(data == MAP_FAILED) return nullptr;
+    return std::shared_ptr<MappedFile>(new MappedFile(static_cast<const uint8_t *>(data), size));
+}
+
+const uint8_t *MappedFile::data() const {
+    return _data;
+}
+
+size_t MappedFile::size() const {
+    return _size;
+}
+
+void MappedFile::advise_sequential(size_t offset, size_t len) const {
+    advise(_data, _size, offset, len, MADV_SEQUENTIAL);
+}
+
+void MappedFile::advise_willneed(size_t offset, size_t len) const {
+    advise(_data, _size, offset, len, MADV_WILLNEED);
+}
+
+void MappedFile::advise_dontneed(size_t offset, size_t len) const {
+    advise(_data, _size, offset, len, MADV_DONTNEED);
+}
@@ -0,0 +1,609 @@
+#include <cmath>
+#include <algorithm>
+
+#include "util/sketch.h"
+#include "util/top_k.h"
+
+namespace {
+    /** Mixes the bits of the given value so that every output bit depends on
+     * every input bit (the splitmix64 finalizer). */
+    inline uint64_t mix64(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    /** Hashes a string with 64 bit FNV-1a. Unlike std::hash, the result is the
+     * same on every platform, so sketches built on different nodes agree. */
+    inline uint64_t hash_string(std::string_view s) {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for(size_t i = 0; i < s.size(); ++i) {
+            h ^= static_cast<uint8_t>(s[i]);
+            h *= 0x100000001b3ULL;
+        }
+        return mix64(h);
+    }
+
+    /** Orders candidates by frequency, most frequent first, breaking ties
+     * alphabetically. */
+    struct MoreFrequent {
+        bool operator()(const std::pair<std::string, uint64_t>& a,
+                        const std::pair<std::string, uint64_t>& b) const {
+            return a.second > b.second || (a.second == b.second && a.first < b.first);
+        }
+    };
+}
+
+// HyperLogLog
+HyperLogLog::HyperLogLog(uint8_t precision) : _precision(precision), _registers() {
+    exit_if_not(precision >= 4 && precision <= 18, "HyperLogLog precision must be between 4 and 18.");
+    _registers.resize(size_t(1) << precision, 0);
+}
+
+void HyperLogLog::_add_hash(uint64_t h) {
+    size_t idx = h >> (64 - _precision);
+    uint64_t rest = h << _precision;
+    // the rank is the position of the first set bit after the index bits
+    uint8_t rank = rest == 0 ? (64 - _precision + 1) : (__builtin_clzll(rest) + 1);
+    if(rank > _registers[idx]) _registers[idx] = rank;
+}
+
+void HyperLogLog::add(int val) {
+    _add_hash(mix64(static_cast<uint32_t>(val)));
+}
+
+void HyperLogLog::add(double val) {
+    if(val == 0) val = 0; // -0.0 and 0.0 are the same value
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    _add_hash(mix64(bits));
+}
+
+void HyperLogLog::add(bool val) {
+    _add_hash(mix64(val));
+}
+
+void HyperLogLog::add(std::string_view val) {
+    _add_hash(hash_string(val));
+}
+
+size_t HyperLogLog::count() const {
+    double m = _registers.size();
+    double sum = 0;
+    size_t zeros = 0;
+    for(size_t i = 0; i < _registers.size(); ++i) {
+        sum += std::ldexp(1.0, -_registers[i]);
+        zeros += _registers[i] == 0;
+    }
+
+    double alpha = 0.7213 / (1 + 1.079 / m);
+    if(m == 16) alpha = 0.673;
+    else if(m == 32) alpha = 0.697;
+    else if(m == 64) alpha = 0.709;
+
+    double estimate = alpha * m * m / sum;
+    // for small cardinalities linear counting of the empty registers is more accurate
+    if(estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * std::log(m / zeros);
+    }
+    return static_cast<size_t>(estimate + 0.5);
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    exit_if_not(_precision == other._precision, "Cannot merge HyperLogLogs of different precisions.");
+    for(size_t i = 0; i < _registers.size(); ++i) {
+        _registers[i] = std::max(_registers[i], other._registers[i]);
+    }
+}
+
+void HyperLogLog::clear() {
+    std::fill(_registers.begin(), _registers.end(), 0);
+}
+
+size_t HyperLogLog::hash() const {
+    size_t hash = _precision;
+    for(size_t i = 0; i < _registers.size(); ++i) {
+        hash = hash * 31 + _registers[i];
+    }
+    return hash;
+}
+
+bool HyperLogLog::equals(const Object *other) const {
+    auto hll = dynamic_cast<const HyperLogLog *>(other);
+    if(hll) {
+        return _precision == hll->_precision && _registers == hll->_registers;
+    }
+    return false;
+}
+
+std::shared_ptr<Object> HyperLogLog::clone() const {
+    return std::make_shared<HyperLogLog>(*this);
+}
+
+std::vector<uint8_t> HyperLogLog::serialize() const {
+    return this->_serialize_exact();
+}
+
+void HyperLogLog::serialize_into(ByteWriter& w) const {
+    w.write<uint8_t>(_precision);
+    w.write_bytes(_registers.data(), _registers.size());
+}
+
+size_t HyperLogLog::serialized_size() const {
+    return sizeof(uint8_t) + _registers.size();
+}
+
+// CountMinSketch
+CountMinSketch::CountMinSketch(size_t width, size_t depth)
+: _width(width), _depth(depth), _counters(width * depth, 0), _total(0) {
+    exit_if_not(width > 0 && depth > 0, "CountMinSketch dimensions must be positive.");
+}
+
+uint64_t CountMinSketch::add(const std::string& val, uint64_t count) {
+    // each row uses a different hash, derived from two base hashes
+    uint64_t h1 = hash_string(val);
+    uint64_t h2 = mix64(h1) | 1;
+    uint64_t min = UINT64_MAX;
+    for(size_t d = 0; d < _depth; ++d) {
+        uint64_t& counter = _counters[d * _width + (h1 + d * h2) % _width];
+        counter += count;
+        min = std::min(min, counter);
+    }
+    _total += count;
+    return min;
+}
+
+uint64_t CountMinSketch::estimate(const std::string& val) const {
+    uint64_t h1 = hash_string(val);
+    uint64_t h2 = mix64(h1) | 1;
+    uint64_t min = UINT64_MAX;
+    for(size_t d = 0; d < _depth; ++d) {
+        min = std::min(min, _counters[d * _width + (h1 + d * h2) % _width]);
+    }
+    return min;
+}
+
+uint64_t CountMinSketch::total() const {
+    return _total;
+}
+
+void CountMinSketch::merge(const CountMinSketch& other) {
+    exit_if_not(_width == other._width && _depth == other._depth,
+                "Cannot merge CountMinSketches of different dimensions.");
+    for(size_t i = 0; i < _counters.size(); ++i) {
+        _counters[i] += other._counters[i];
+    }
+    _total += other._total;
+}
+
+void CountMinSketch::clear() {
+    std::fill(_counters.begin(), _counters.end(), 0);
+    _total = 0;
+}
+
+size_t CountMinSketch::hash() const {
+    size_t hash = _width ^ (_depth << 16) ^ _total;
+    for(size_t i = 0; i < _counters.size(); ++i) {
+        hash = hash * 31 + _counters[i];
+    }
+    return hash;
+}
+
+bool CountMinSketch::equals(const Object *other) const {
+    auto cms = dynamic_cast<const CountMinSketch *>(other);
+    if(cms) {
+        return _width == cms->_width && _depth == cms->_depth
+            && _total == cms->_total && _counters == cms->_counters;
+    }
+    return false;
+}
+
+std::shared_ptr<Object> CountMinSketch::clone() const {
+    return std::make_shared<CountMinSketch>(*this);
+}
+
+std::vector<uint8_t> CountMinSketch::serialize() const {
+    return this->_serialize_exact();
+}
+
+void CountMinSketch::serialize_into(ByteWriter& w) const {
+    w.write_size(_width);
+    w.write_size(_depth);
+    w.write<uint64_t>(_total);
+    w.write_bytes(_counters.data(), _counters.size() * sizeof(uint64_t));
+}
+
+size_t CountMinSketch::serialized_size() const {
+    return 2 * sizeof(size_t) + sizeof(uint64_t) + _counters.size() * sizeof(uint64_t);
+}
+
+// HeavyHitters
+HeavyHitters::HeavyHitters(size_t k, size_t width, size_t depth)
+: _k(k), _cms(width, depth), _candidates(), _min_estimate(0) {}
+
+void HeavyHitters::_update_min() {
+    _min_estimate = _candidates.empty() ? 0 : UINT64_MAX;
+    for(auto iter = _candidates.begin(); iter != _candidates.end(); ++iter) {
+        _min_estimate = std::min(_min_estimate, iter->second);
+    }
+}
+
+void HeavyHitters::add(const std::string& val, uint64_t count) {
+    uint64_t estimate = _cms.add(val, count);
+    if(_k == 0) return;
+
+    auto iter = _candidates.find(val);
+    if(iter != _candidates.end()) {
+        iter->second = estimate;
+        return;
+    }
+    if(_candidates.size() < _k) {
+        _candidates.emplace(val, estimate);
+        if(_candidates.size() == _k) _update_min();
+        return;
+    }
+    // estimates only grow, so _min_estimate is a lower bound on the current minimum
+    if(estimate <= _min_estimate) return;
+
+    auto least = _candidates.begin();
+    for(auto it = _candidates.begin(); it != _candidates.end(); ++it) {
+        if(MoreFrequent()(*least, *it)) least = it;
+    }
+    if(estimate > least->second) {
+        _candidates.erase(least);
+        _candidates.emplace(val, estimate);
+    }
+    _update_min();
+}
+
+std::vector<std::pair<std::string, uint64_t>> HeavyHitters::top() const {
+    TopK<std::pair<std::string, uint64_t>, MoreFrequent> heap(_k);
+    for(auto iter = _candidates.begin(); iter != _candidates.end(); ++iter) {
+        heap.push(*iter);
+    }
+    return heap.finish();
+}
+
+void HeavyHitters::merge(const HeavyHitters& other) {
+    exit_if_not(_k == other._k, "Cannot merge HeavyHitters with different k.");
+    _cms.merge(other._cms);
+
+    TopK<std::pair<std::string, uint64_t>, MoreFrequent> heap(_k);
+    for(auto iter = _candidates.begin(); iter != _candidates.end(); ++iter) {
+        heap.push({iter->first, _cms.estimate(iter->first)});
+    }
+    for(auto iter = other._candidates.begin(); iter != other._candidates.end(); ++iter) {
+        if(_candidates.count(iter->first)) continue;
+        heap.push({iter->first, _cms.estimate(iter->first)});
+    }
+
+    _candidates.clear();
+    std::vector<std::pair<std::string, uint64_t>> best = heap.finish();
+    _candidates.insert(best.begin(), best.end());
+    _update_min();
+}
+
+void HeavyHitters::clear() {
+    _cms.clear();
+    _candidates.clear();
+    _min_estimate = 0;
+}
+
+size_t HeavyHitters::hash() const {
+    size_t hash = _k ^ _cms.hash();
+    for(auto iter = _candidates.begin(); iter != _candidates.end(); ++iter) {
+        hash += std::hash<std::string>()(iter->first) ^ iter->second;
+    }
+    return hash;
+}
+
+bool HeavyHitters::equals(const Object *other) const {
+    auto hh = dynamic_cast<const HeavyHitters *>(other);
+    if(hh) {
+        return _k == hh->_k && _cms.equals(&hh->_cms) && _candidates == hh->_candidates;
+    }
+    return false;
+}
+
+std::shared_ptr<Object> HeavyHitters::clone() const {
+    return std::make_shared<HeavyHitters>(*this);
+}
+
+std::vector<uint8_t> HeavyHitters::serialize() const {
+    return this->_serialize_exact();
+}
+
+void HeavyHitters::serialize_into(ByteWriter& w) const {
+    w.write_size(_k);
+    w.write(_cms);
+    w.write_size(_candidates.size());
+    for(auto iter = _candidates.begin(); iter != _candidates.end(); ++iter) {
+        w.write(iter->first);
+        w.write<uint64_t>(iter->second);
+    }
+}
+
+size_t HeavyHitters::serialized_size() const {
+    size_t size = 2 * sizeof(size_t) + _cms.serialized_size();
+    for(auto iter = _candidates.begin(); iter != _candidates.end(); ++iter) {
+        size += sizeof(size_t) + iter->first.size() + sizeof(uint64_t);
+    }
+    return size;
+}
+
+// QuantileSketch
+QuantileSketch::QuantileSketch(size_t capacity)
+: _capacity(capacity), _count(0), _offset(false), _levels(1) {
+    exit_if_not(capacity >= 2, "QuantileSketch capacity must be at least 2.");
+}
+
+void QuantileSketch::_compact() {
+    for(size_t h = 0; h < _levels.size(); ++h) {
+        if(_levels[h].size() < _capacity) continue;
+        if(h + 1 == _levels.size()) _levels.emplace_back();
+
+        std::vector<double>& level = _levels[h];
+        std::vector<double>& above = _levels[h + 1];
+        std::sort(level.begin(), level.end());
+        // an odd value out stays behind, so the total weight is unchanged
+        size_t even = level.size() & ~size_t(1);
+        for(size_t i = _offset; i < even; i += 2) {
+            above.push_back(level[i]);
+        }
+        _offset = !_offset;
+
+        if(even < level.size()) {
+            level[0] = level.back();
+            level.resize(1);
+        } else {
+            level.clear();
+        }
+    }
+}
+
+void QuantileSketch::add(double val) {
+    if(std::isnan(val)) return;
+    _levels[0].push_back(val);
+    ++_count;
+    if(_levels[0].size() >= _capacity) _compact();
+}
+
+uint64_t QuantileSketch::count() const {
+    return _count;
+}
+
+double QuantileSketch::quantile(double q) const {
+    std::vector<std::pair<double, uint64_t>> weighted;
+    for(size_t h = 0; h < _levels.size(); ++h) {
+        for(size_t i = 0; i < _levels[h].size(); ++i) {
+            weighted.emplace_back(_levels[h][i], uint64_t(1) << h);
+        }
+    }
+    if(weighted.empty()) return std::nan("");
+    std::sort(weighted.begin(), weighted.end());
+
+    q = std::min(1.0, std::max(0.0, q));
+    double target = q * _count;
+    uint64_t seen = 0;
+    for(size_t i = 0; i < weighted.size(); ++i) {
+        seen += weighted[i].second;
+        if(seen >= target) return weighted[i].first;
+    }
+    return weighted.back().first;
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    exit_if_not(_capacity == other._capacity, "Cannot merge QuantileSketches of different capacities.");
+    if(_levels.size() < other._levels.size()) _levels.resize(other._levels.size());
+    for(size_t h = 0; h < other._levels.size(); ++h) {
+        _levels[h].insert(_levels[h].end(), other._levels[h].begin(), other._levels[h].end());
+    }
+    _count += other._count;
+    _compact();
+}
+
+void QuantileSketch::clear() {
+    _levels.assign(1, std::vector<double>());
+    _count = 0;
+    _offset = false;
+}
+
+size_t QuantileSketch::hash() const {
+    size_t hash = _capacity ^ _count;
+    for(size_t h = 0; h < _levels.size(); ++h) {
+        for(size_t i = 0; i < _levels[h].size(); ++i) {
+            hash = hash * 31 + (std::hash<double>()(_levels[h][i]) ^ h);
+        }
+    }
+    return hash;
+}
+
+bool QuantileSketch::equals(const Object *other) const {
+    auto qs = dynamic_cast<const QuantileSketch *>(other);
+    if(qs) {
+        return _capacity == qs->_capacity && _count == qs->_count
+            && _offset == qs->_offset && _levels == qs->_levels;
+    }
+    return false;
+}
+
+std::shared_ptr<Object> QuantileSketch::clone() const {
+    return std::make_shared<QuantileSketch>(*this);
+}
+
+std::vector<uint8_t> QuantileSketch::serialize() const {
+    return this->_serialize_exact();
+}
+
+void QuantileSketch::serialize_into(ByteWriter& w) const {
+    w.write_size(_capacity);
+    w.write<uint64_t>(_count);
+    w.write<bool>(_offset);
+    w.write_size(_levels.size());
+    for(size_t h = 0; h < _levels.size(); ++h) {
+        w.write_size(_levels[h].size());
+        w.write_bytes(_levels[h].data(), _levels[h].size() * sizeof(double));
+    }
+}
+
+size_t QuantileSketch::serialized_size() const {
+    size_t size = sizeof(size_t) + sizeof(uint64_t) + sizeof(bool) + sizeof(size_t);
+    for(size_t h = 0; h < _levels.size(); ++h) {
+        size += sizeof(size_t) + _levels[h].size() * sizeof(double);
+    }
+    return size;
+}
+
+// DistinctCountRower
+DistinctCountRower::DistinctCountRower(size_t col, uint8_t precision) : _col(col), _sketch(precision) {}
+
+bool DistinctCountRower::accept(Row& r) {
+    switch(r.col_type(_col)) {
+        case 'I': {
+            std::optional<int> v = r.get_int(_col);
+            if(v) _sketch.add(*v);
+            break;
+        }
+        case 'F': {
+            std::optional<double> v = r.get_double(_col);
+            if(v) _sketch.add(*v);
+            break;
+        }
+        case 'B': {
+            std::optional<bool> v = r.get_bool(_col);
+            if(v) _sketch.add(*v);
+            break;
+        }
+        case 'S': {
+            std::optional<std::string> v = r.get_string(_col);
+            if(v) _sketch.add(*v);
+            break;
+        }
+    }
+    return true;
+}
+
+void DistinctCountRower::join(std::shared_ptr<Rower> other) {
+    auto dcr = std::dynamic_pointer_cast<DistinctCountRower>(other);
+    assert(dcr);
+    _sketch.merge(dcr->_sketch);
+}
+
+bool DistinctCountRower::join_is_associative() const {
+    return true;
+}
+
+const HyperLogLog& DistinctCountRower::sketch() const {
+    return _sketch;
+}
+
+size_t DistinctCountRower::hash() const {
+    return _col ^ _sketch.hash();
+}
+
+bool DistinctCountRower::equals(const Object *other) const {
+    auto dcr = dynamic_cast<const DistinctCountRower *>(other);
+    if(dcr) {
+        return _col == dcr->_col && _sketch.equals(&dcr->_sketch);
+    }
+    return false;
+}
+
+std::shared_ptr<Object> DistinctCountRower::clone() const {
+    auto dcr = std::make_shared<DistinctCountRower>(*this);
+    dcr->_sketch.clear();
+    return dcr;
+}
+
+// HeavyHittersRower
+HeavyHittersRower::HeavyHittersRower(size_t col, size_t k, size_t width, size_t depth)
+: _col(col), _sketch(k, width, depth) {}
+
+bool HeavyHittersRower::accept(Row& r) {
+    std::optional<std::string> v = r.get_string(_col);
+    if(v) _sketch.add(*v);
+    return true;
+}
+
+void HeavyHittersRower::join(std::shared_ptr<Rower> other) {
+    auto hhr = std::dynamic_pointer_cast<HeavyHittersRower>(other);
+    assert(hhr);
+    _sketch.merge(hhr->_sketch);
+}
+
+bool HeavyHittersRower::join_is_associative() const {
+    // the merged sketch depends on the order clones are merged in
+    return false;
+}
+
+const HeavyHitters& HeavyHittersRower::sketch() const {
+    return _sketch;
+}
+
+size_t HeavyHittersRower::hash() const {
+    return _col ^ _sketch.hash();
+}
+
+bool HeavyHittersRower::equals(const Object *other) const {
+    auto hhr = dynamic_cast<const HeavyHittersRower *>(other);
+    if(hhr) {
+        return _col == hhr->_col && _sketch.equals(&hhr->_sketch);
+    }
+    return false;
+}
+
+std::shared_ptr<Object> HeavyHittersRower::clone() const {
+    auto hhr = std::make_shared<HeavyHittersRower>(*this);
+    hhr->_sketch.clear();
+    return hhr;
+}
+
+// QuantileRower
+QuantileRower::QuantileRower(size_t col, size_t capacity) : _col(col), _sketch(capacity) {}
+
+bool QuantileRower::accept(Row& r) {
+    if(r.col_type(_col) == 'I') {
+        std::optional<int> v = r.get_int(_col);
+        if(v) _sketch.add(*v);
+    } else {
+        std::optional<double> v = r.get_double(_col);
+        if(v) _sketch.add(*v);
+    }
+    return true;
+}
+
+void QuantileRower::join(std::shared_ptr<Rower> other) {
+    auto qr = std::dynamic_pointer_cast<QuantileRower>(other);
+    assert(qr);
+    _sketch.merge(qr->_sketch);
+}
+
+bool QuantileRower::join_is_associative() const {
+    // the merged sketch depends on the order clones are merged in
+    return false;
+}
+
+const QuantileSketch& QuantileRower::sketch() const {
+    return _sketch;
+}
+
+size_t QuantileRower::hash() const {
+    return _col ^ _sketch.hash();
+}
+
+bool QuantileRower::equals(const Object *other) const {
+    auto qr = dynamic_cast<const QuantileRower *>(other);
+    if(qr) {
+        return _col == qr->_col && _sketch.equals(&qr->_sketch);
+    }
+    return false;
+}
+
+std::shared_ptr<Object> QuantileRower::clone() const {
+    auto qr = std::make_shared<QuantileRower>(*this);
+    qr->_sketch.clear();
+    return qr;
+}
@@ -0,0 +1,89 @@
+#include "util/word_reader.h"
+#include "util/mapped_file.h"
+#include "util/parallel.h"
+
+/** Returns whether c is whitespace, as in the C locale. */
+static bool is_space(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+void WordReader::_split(const char *begin, const char *end, size_t parts,
+                        std::vector<Range>& ranges) {
+    size_t size = end - begin;
+    const char *start = begin;
+    for(size_t p = 1; p <= parts && start < end; ++p) {
+        const char *stop = std::max(start, begin + size * p / parts);
+        // a word is never split between ranges
+        while(stop < end && !is_space(*stop)) ++stop;
+        ranges.push_back({start, stop});
+        start = stop;
+    }
+}
+
+size_t WordReader::_count_words(const char *begin, const char *end) {
+    size_t words = 0;
+    bool in_word = false;
+    for(const char *p = begin; p < end; ++p) {
+        bool space = is_space(*p);
+        words += in_word && space;
+        in_word = !space;
+    }
+    return words + in_word;
+}
+
+void WordReader::_parse_range(const Range& range, ParallelFrameBuilder::Segment& segment) {
+    size_t size = range.end - range.begin;
+    size_t sample = std::min(size, WORD_SAMPLE_BYTES);
+    if(sample > 0) {
+        // a sixteenth more than the estimate, as words vary in length
+        size_t words = size_t(double(_count_words(range.begin, range.begin + sample)) * size / sample);
+        segment.reserve(words + words / 16 + 1);
+    }
+    const char *p = range.begin;
+    while(p < range.end) {
+        while(p < range.end && is_space(*p)) ++p;
+        const char *word = p;
+        while(p < range.end && !is_space(*p)) ++p;
+        if(p > word) segment.push_back(0, std::optional<std::string>(std::in_place, word, p));
+    }
+}
+
+std::shared_ptr<DataFrame> WordReader::_parse_ranges(const std::vector<Range>& ranges) {
+    ParallelFrameBuilder builder(Schema("S"));
+    builder.set_workers(std::max<size_t>(1, ranges.size()));
+    parallel_for(ranges.size(), [&ranges, &builder](size_t r){
+        _parse_range(ranges[r], builder.segment(r));
+    });
+    return builder.finish();
+}
+
+std::shared_ptr<DataFrame> WordReader::parse(const char *begin, const char *end, size_t max_threads) {
+    size_t parts = std::max<size_t>(1, std::min(max_threads, size_t(end - begin) / WORD_MIN_RANGE_BYTES));
+    std::vector<Range> ranges;
+    _split(begin, end, parts, ranges);
+    return _parse_ranges(ranges);
+}
+
+std::shared_ptr<DataFrame> WordReader::read(const std::vector<std::string>& paths) {
+    std::vector<std::shared_ptr<MappedFile>> files;
+    size_t total = 0;
+    for(auto& path : paths) {
+        auto file = MappedFile::open(path);
+        if(!file) return nullptr;
+        file->advise_sequential(0, file->size());
+        total += file->size();
+        files.push_back(file);
+    }
+
+    // every file gets ranges of about the same size, so small files are
+    // read whole alongside the parts of the large ones
+    size_t range_bytes = std::max(WORD_MIN_RANGE_BYTES, total / MAX_THREADS);
+    std::vector<Range> ranges;
+    for(auto& file : files) {
+        const char *begin = reinterpret_cast<const char *>(file->data());
+        size_t parts = std::max<size_t>(1, (file->size() + range_bytes / 2) / range_bytes);
+        _split(begin, begin + file->size(), parts, ranges);
+    }
+    // the files stay mapped until every range is tokenized
+    return _parse_ranges(ranges);
+}
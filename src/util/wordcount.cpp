@@ -1,8 +1,11 @@
 #include <iostream>
 #include <iomanip>
-#include <fstream>
+#include <chrono>
+#include <stdexcept>
 
 #include "util/wordcount.h"
+#include "util/top_k.h"
+#include "util/word_reader.h"
 #include "network/network.h"
 
 WordCount::CounterRower::CounterRower() : _word_map() {}
@@ -39,6 +42,13 @@ void WordCount::CounterRower::join(std::shared_ptr<Rower> other) {
     }
 }
 
+bool WordCount::CounterRower::join_is_associative() const {
+    return true;
+}
+
+void WordCount::CounterRower::reserve(size_t words) {
+    _word_map.reserve(words);
+}
 
 void WordCount::CounterRower::print() const {
     for(auto iter = _word_map.begin(); iter != _word_map.end(); ++iter){
@@ -46,6 +56,33 @@ void WordCount::CounterRower::print() const {
     }
 }
 
+std::vector<std::pair<std::string, size_t>> WordCount::CounterRower::top_k(size_t k) const {
+    using Entry = const std::pair<const std::string, size_t> *;
+    // more frequent is better, and ties go to the alphabetically first word
+    auto better = [](Entry a, Entry b) {
+        return a->second > b->second || (a->second == b->second && a->first < b->first);
+    };
+    TopK<Entry, decltype(better)> heap(k, better);
+    heap.reserve(_word_map.size());
+    for(auto iter = _word_map.begin(); iter != _word_map.end(); ++iter){
+        heap.push(&*iter);
+    }
+
+    std::vector<std::pair<std::string, size_t>> top;
+    for(Entry e : heap.finish()) {
+        top.push_back(*e);
+    }
+    return top;
+}
+
+void WordCount::CounterRower::print_top(size_t k) const {
+    auto top = this->top_k(k);
+    for(size_t i = 0; i < top.size(); ++i){
+        std::cout <<top[i].first <<": " <<top[i].second <<'\n';
+    }
+    std::cout <<std::flush;
+}
+
 std::shared_ptr<Object> WordCount::CounterRower::clone() const {
     return std::make_shared<WordCount::CounterRower>();
 }
@@ -68,29 +105,18 @@ bool WordCount::CounterRower::equals(const Object* other) const {
 
 
 WordCount::WordCount() : Application(), _ip(nullptr), _server_ip(nullptr),
-_filename(nullptr), _server_port(SERVER_PORT), _mode(Mode::NONE),
+_filenames(), _server_port(SERVER_PORT), _mode(Mode::NONE), _top(0),
 _key(std::string("wc_df")) {}
 
 void WordCount::_read_in_file() const {
-    std::unique_ptr<StringColumn> str_col = std::make_unique<StringColumn>();
-
-    auto stream = std::fstream(_filename, std::fstream::in);
-    std::string line;
-    std::string word;
-    while(!stream.eof() && !stream.fail() && !stream.bad()) {
-        std::getline(stream, line);
-        for(size_t i = 0; i < line.size(); ++i){
-            if(!isspace(line[i])) {
-                 word += line[i];
-            } else if(!word.empty()) {
-                str_col->push_back(word);
-                word.clear();
-            }
-        }
-        line.clear();
-    }
-    std::shared_ptr<DataFrame> df = std::make_shared<DataFrame>();
-    df->add_column(std::move(str_col));
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<DataFrame> df = WordReader::read(_filenames);
+    if(!df) throw std::runtime_error("cannot map the input files");
+    std::cout <<"Read " <<df->nrows() <<" words from " <<_filenames.size() <<" files in "
+        <<std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+        <<"s" <<std::endl;
+    // sent along with the words so the counter can size its map
+    df->compute_stats();
     KVStore::get_instance().set(_key, df);
 }
 
@@ -117,8 +143,15 @@ void WordCount::_counter() {
     auto df = KVStore::get_instance().get_or_wait(_key);
     assert(df);
     WordCount::CounterRower cr;
+    // the clones are joined into this rower, so it ends up with every word
+    auto stats = df->get_stats(0);
+    if(stats) cr.reserve(stats->distinct());
     df->pmap(cr);
-    cr.print();
+    if(_top > 0) {
+        cr.print_top(_top);
+    } else {
+        cr.print();
+    }
     cthread.join();
 }
 
@@ -130,7 +163,7 @@ void WordCount::_reader() {
 
     assert(Client::init(ip, sip, _server_port));
     std::thread cthread([]{ Client::get_instance().lock()->listen_on_socket(10); });
-    if(!_filename) {
+    if(_filenames.empty()) {
         std::cout <<"Filename required!" <<std::endl;
         Client::get_instance().lock()->request_teardown();
         cthread.join();
@@ -157,6 +190,8 @@ void WordCount::_help(const char* bin_name) const {
         <<std::setw(20) <<"Run this node as the reader" <<std::endl;
     std::cout <<std::left <<std::setw(20) <<"--counter:" 
         <<std::setw(20) <<"Run this node as the counter." <<std::endl;
+    std::cout <<std::left <<std::setw(20) <<"--top, -k:" 
+        <<std::setw(20) <<"Only print the k most frequent words (counter only)." <<std::endl;
     std::cout <<std::left <<std::setw(20) <<"--address, -ip:" 
         <<std::setw(20) <<"Set the address of this node (Default: " <<DEFAULT_IP <<")." <<std::endl;
     std::cout <<std::left <<std::setw(20) <<"--server_address, -sip:" 
@@ -164,7 +199,7 @@ void WordCount::_help(const char* bin_name) const {
     std::cout <<std::left <<std::setw(20) <<"--port, -p:" 
         <<std::setw(20) <<"Set the port of the server (Default: " <<DEFAULT_SERVER_PORT <<")." <<std::endl;
     std::cout <<std::left <<std::setw(20) <<"--file, -f:" 
-        <<std::setw(20) <<"Set the file to be read in." <<std::endl;
+        <<std::setw(20) <<"Add a file to be read in, may be given more than once (reader only)." <<std::endl;
     exit(0);
 }
 
@@ -178,6 +213,9 @@ void WordCount::parse_arguments(int argc, char **argv) {
             _mode = READER;
         } else if(strcmp(argv[i], "--counter") == 0){
             _mode = COUNTER;
+        } else if(strcmp(argv[i], "--top") == 0
+                || strcmp(argv[i], "-k") == 0){
+            _top = std::stoul(argv[++i]);
         } else if(strcmp(argv[i], "--address") == 0
                 || strcmp(argv[i], "-ip") == 0){
             _ip = argv[++i];
@@ -189,7 +227,7 @@ void WordCount::parse_arguments(int argc, char **argv) {
             _server_port = std::stoi(argv[++i]);
         } else if(strcmp(argv[i], "--file") == 0
                 || strcmp(argv[i], "-f") == 0){
-            _filename = argv[++i];
+            _filenames.push_back(argv[++i]);
         } else {
             std::cout <<"Unrecognized Option: " <<argv[i] <<std::endl;
         }
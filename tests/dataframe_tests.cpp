@@ -1,4 +1,7 @@
 #include <iostream>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
 #include "catch.hpp"
 #include "test_util.h"
 #include "test_rower.h"
@@ -6,6 +9,7 @@
 #include "data/dataframe.h"
 #include "data/schema.h"
 #include "data/row.h"
+#include "data/typed_frame.h"
 
 #define ROW_CNT 100000
 
@@ -30,5 +34,542 @@ SCENARIO("Can construct and use dataframe"){
             df.pmap(tsr_parallel);
             REQUIRE(tsr_sequential.get_sum() == tsr_parallel.get_sum());
         }
+        WHEN("Several rowers share a single scan") {
+            TestSumRower tsr_sequential;
+            df.map(tsr_sequential);
+
+            TestSumRower tsr_one;
+            TestAssociativeSumRower tsr_two;
+            auto builder = std::make_shared<ParallelFrameBuilder>(df.get_schema());
+            TestCopyRower tcr(builder);
+            df.pmap_many({&tsr_one, &tsr_two, &tcr});
+            REQUIRE(tsr_one.get_sum() == tsr_sequential.get_sum());
+            REQUIRE(tsr_two.get_sum() == tsr_sequential.get_sum());
+            REQUIRE(builder->nrows() == df.nrows());
+
+            TestSumRower tsr_three;
+            TestSumRower tsr_four;
+            df.map_many({&tsr_three, &tsr_four});
+            REQUIRE(tsr_three.get_sum() == tsr_sequential.get_sum());
+            REQUIRE(tsr_four.get_sum() == tsr_sequential.get_sum());
+        }
+        WHEN("The clones of an associative rower are joined in parallel") {
+            TestSumRower tsr_sequential;
+            TestAssociativeSumRower tsr_tree;
+            df.map(tsr_sequential);
+            df.pmap(tsr_tree);
+            REQUIRE(tsr_sequential.get_sum() == tsr_tree.get_sum());
+        }
+        WHEN("Room is reserved before the rows are added and released after") {
+            DataFrame reserved(std::make_unique<Schema>(df.get_schema()));
+            reserved.reserve(ROW_CNT * 2);
+            Row row(df.get_schema());
+            for(size_t r = 0; r < df.nrows(); ++r) {
+                df.fill_row(r, row);
+                reserved.add_row(row);
+            }
+            reserved.shrink_to_fit();
+            THEN("It holds the same rows") {
+                REQUIRE(reserved.nrows() == df.nrows());
+                // the generated floats include NaN, which is never equal
+                for(size_t c = 0; c < df.ncols(); ++c) {
+                    if(df.get_schema().col_type(c) == 'F') continue;
+                    REQUIRE(reserved.get_column(c).equals(&df.get_column(c)));
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Can view a dataframe through a typed frame"){
+    GIVEN("A dataframe with an 'ISBF' schema") {
+        DataFrame df(std::make_unique<Schema>("ISBF"));
+        generate_large_dataframe(df, ROW_CNT);
+
+        WHEN("It is viewed with matching types") {
+            TypedFrame<int, std::string, bool, double> tf(df);
+            THEN("Every value matches the dataframe") {
+                REQUIRE(tf.nrows() == df.nrows());
+                bool same = true;
+                for(size_t r = 0; r < tf.nrows(); ++r) {
+                    same = same && tf.get<0>(r) == df.get_int(0, r)
+                                && tf.get<1>(r) == df.get_string(1, r)
+                                && tf.get<2>(r) == df.get_bool(2, r)
+                                && tf.exists<3>(r) == df.get_double(3, r).has_value();
+                    // generated doubles may be NaN, so compare their bits
+                    if(tf.exists<3>(r)) {
+                        double expected = *df.get_double(3, r);
+                        same = same && memcmp(&tf.value<3>(r), &expected, sizeof(double)) == 0;
+                    }
+                }
+                REQUIRE(same);
+            }
+
+            THEN("Sequential and parallel maps give the same results") {
+                long seq_sum = 0;
+                tf.map([&seq_sum](const TypedFrame<int, std::string, bool, double>::RowView& row) {
+                    if(row.exists<0>()) seq_sum += row.value<0>();
+                });
+
+                // each thread sums into its own copy, which are joined at the end
+                struct Sum {
+                    long sum = 0;
+                    void operator()(const TypedFrame<int, std::string, bool, double>::RowView& row) {
+                        if(row.exists<0>()) sum += row.value<0>();
+                    }
+                } partial;
+                tf.pmap(partial, [](Sum& into, Sum& from){ into.sum += from.sum; });
+                REQUIRE(partial.sum == seq_sum);
+
+                std::atomic<long> shared_sum(0);
+                tf.pmap([&shared_sum](const auto& row) {
+                    if(row.template exists<0>()) shared_sum += row.template value<0>();
+                });
+                REQUIRE(shared_sum == seq_sum);
+            }
+        }
+
+        WHEN("It is viewed with the wrong types") {
+            THEN("Construction fails") {
+                REQUIRE_THROWS((TypedFrame<int, int, bool, double>(df)));
+                REQUIRE_THROWS((TypedFrame<int, std::string>(df)));
+            }
+        }
+    }
+}
+
+SCENARIO("Can build a dataframe in parallel without locking"){
+    GIVEN("A large dataframe and a rower copying rows into a ParallelFrameBuilder") {
+        DataFrame df(std::make_unique<Schema>("ISBF"));
+        generate_large_dataframe(df, ROW_CNT);
+        auto builder = std::make_shared<ParallelFrameBuilder>(df.get_schema());
+        TestCopyRower tcr(builder);
+
+        WHEN("The rower is run in parallel") {
+            df.pmap(tcr);
+            THEN("Every worker had its own segment") {
+                REQUIRE(builder->workers() > 1);
+                REQUIRE(builder->nrows() == df.nrows());
+            }
+
+            THEN("Finishing splices the segments back in row order") {
+                auto copy = builder->finish();
+                REQUIRE(copy->nrows() == df.nrows());
+                REQUIRE(copy->get_column(0).equals(&df.get_column(0)));
+                REQUIRE(copy->get_column(1).equals(&df.get_column(1)));
+                REQUIRE(copy->get_column(2).equals(&df.get_column(2)));
+                REQUIRE(builder->nrows() == 0);
+            }
+        }
+    }
+}
+
+SCENARIO("Can select the top k rows of a dataframe"){
+    GIVEN("A large dataframe") {
+        DataFrame df(std::make_unique<Schema>("ISBF"));
+        generate_large_dataframe(df, ROW_CNT);
+
+        WHEN("The top rows of the int column are selected") {
+            size_t k = 25;
+            auto top = df.top_k(0, k);
+
+            THEN("They match the first k rows of a full sort") {
+                std::vector<std::pair<int, size_t>> all;
+                for(size_t r = 0; r < df.nrows(); ++r) {
+                    std::optional<int> v = df.get_int(0, r);
+                    if(v) all.emplace_back(*v, r);
+                }
+                std::stable_sort(all.begin(), all.end(), [](auto& a, auto& b){ return a.first > b.first; });
+
+                REQUIRE(top->nrows() == std::min(k, all.size()));
+                for(size_t i = 0; i < top->nrows(); ++i) {
+                    REQUIRE(*top->get_int(0, i) == all[i].first);
+                    REQUIRE(top->get_string(1, i) == df.get_string(1, all[i].second));
+                }
+            }
+        }
+
+        WHEN("More rows are requested than exist") {
+            auto top = df.top_k(2, df.nrows() + 10);
+            THEN("Only the rows with values are returned") {
+                size_t present = 0;
+                for(size_t r = 0; r < df.nrows(); ++r) present += df.get_bool(2, r).has_value();
+                REQUIRE(top->nrows() == present);
+            }
+        }
+
+        WHEN("Far more rows are requested than could ever be held") {
+            auto top = df.top_k(0, SIZE_MAX);
+            THEN("Every row with a value is returned, without reserving k") {
+                size_t present = 0;
+                for(size_t r = 0; r < df.nrows(); ++r) present += df.get_int(0, r).has_value();
+                REQUIRE(top->nrows() == present);
+            }
+        }
+    }
+}
+
+SCENARIO("Zone maps let scans skip blocks of rows"){
+    GIVEN("A dataframe with a sorted int column") {
+        DataFrame df(std::make_unique<Schema>("IS"));
+        Row row(df.get_schema());
+        for(int i = 0; i < ROW_CNT; ++i) {
+            row.set(0, std::optional<int>(i));
+            row.set(1, i % 7 == 0 ? std::nullopt : std::optional<std::string>("s"));
+            df.add_row(row);
+        }
+        const ZoneMap<int>& zones = dynamic_cast<const IntColumn&>(df.get_column(0)).get_zones();
+
+        THEN("Every block records its bounds") {
+            REQUIRE(zones.size() == (ROW_CNT + ZONE_ROWS - 1) / ZONE_ROWS);
+            REQUIRE(zones.zone(3).min == 3 * ZONE_ROWS);
+            REQUIRE(zones.zone(3).max == 4 * ZONE_ROWS - 1);
+            REQUIRE(zones.zone(3).null_count == 0);
+        }
+
+        WHEN("A range is filtered and mapped") {
+            RangePredicate pred(0, 30000, 30010);
+            TestSumRower tsr;
+            auto filtered = df.filter(tsr, pred);
+            TestSumRower psr;
+            df.pmap(psr, pred);
+
+            THEN("Only the block holding the range is visited") {
+                size_t start = 30000 / ZONE_ROWS * ZONE_ROWS;
+                REQUIRE(filtered->nrows() == ZONE_ROWS);
+                REQUIRE(*filtered->get_int(0, 0) == (int)start);
+                REQUIRE(psr.get_sum() == tsr.get_sum());
+            }
+        }
+
+        WHEN("The largest value of a block is overwritten") {
+            df.set(0, 2 * ZONE_ROWS - 1, std::optional<int>(-5));
+            THEN("The block bounds are updated") {
+                REQUIRE(zones.zone(1).min == -5);
+                REQUIRE(zones.zone(1).max == 2 * ZONE_ROWS - 2);
+            }
+        }
+
+        WHEN("The dataframe is serialized") {
+            std::vector<uint8_t> data = df.serialize();
+            size_t pos = 0;
+            DataFrame copy = Serializable::deserialize<DataFrame>(data, pos);
+            THEN("The zone maps are sent with it") {
+                auto& sc = dynamic_cast<const StringColumn&>(copy.get_column(1));
+                auto& orig = dynamic_cast<const StringColumn&>(df.get_column(1));
+                REQUIRE(sc.get_zones() == orig.get_zones());
+                REQUIRE(sc.get_zones().zone(0).null_count == (ZONE_ROWS + 6) / 7);
+            }
+        }
+    }
+
+    GIVEN("Two int columns, one appended to the other") {
+        IntColumn a, b, fresh;
+        for(int i = 0; i < 3 * ZONE_ROWS; ++i) {
+            a.push_back(std::optional<int>(i));
+            b.push_back(std::optional<int>(-i));
+        }
+        a.append(std::move(b));
+
+        THEN("The emptied column is summarized as a new one") {
+            REQUIRE(a.get_zones().rows() == 6 * ZONE_ROWS);
+            REQUIRE(b.get_zones().rows() == 0);
+            b.push_back(std::optional<int>(7));
+            fresh.push_back(std::optional<int>(7));
+            REQUIRE(b.get_zones() == fresh.get_zones());
+            REQUIRE(b.get_zones().zone(0).min == 7);
+        }
+    }
+}
+
+SCENARIO("Can compute and ship column statistics"){
+    GIVEN("A dataframe with known distributions") {
+        DataFrame df(std::make_unique<Schema>("IFS"));
+        Row row(df.get_schema());
+        for(int i = 0; i < ROW_CNT; ++i) {
+            row.set(0, std::optional<int>(i % 2000));
+            row.set(1, i % 4 == 0 ? std::nullopt : std::optional<double>(i / 100.0));
+            row.set(2, std::optional<std::string>(i % 2 ? "abcd" : "ab"));
+            df.add_row(row);
+        }
+
+        THEN("No statistics exist until they are computed") {
+            REQUIRE(df.get_stats(0) == nullptr);
+        }
+
+        WHEN("The statistics are computed") {
+            df.compute_stats();
+            auto ints = df.get_stats(0);
+            auto floats = df.get_stats(1);
+            auto strs = df.get_stats(2);
+
+            THEN("They describe each column") {
+                REQUIRE(ints->rows() == ROW_CNT);
+                REQUIRE(ints->null_count() == 0);
+                REQUIRE(std::abs(double(ints->distinct()) - 2000) < 2000 * 0.05);
+                REQUIRE(floats->null_count() == ROW_CNT / 4);
+                REQUIRE(strs->distinct() == 2);
+                REQUIRE(strs->avg_length() == 3);
+                REQUIRE(strs->histogram().empty());
+            }
+
+            THEN("The histogram estimates range selectivity") {
+                REQUIRE(ints->histogram().size() == STATS_BUCKETS + 1);
+                REQUIRE(std::is_sorted(ints->histogram().begin(), ints->histogram().end()));
+                REQUIRE(std::abs(ints->selectivity(0, 499) - 0.25) < 0.05);
+                REQUIRE(ints->selectivity(5000, 6000) == 0);
+            }
+
+            THEN("They are sent with the dataframe but not copied into empty frames") {
+                std::vector<uint8_t> data = df.serialize();
+                size_t pos = 0;
+                DataFrame copy = Serializable::deserialize<DataFrame>(data, pos);
+                REQUIRE(pos == data.size());
+                REQUIRE(copy.get_stats(1)->equals(floats.get()));
+                REQUIRE(DataFrame(df).get_stats(1) == nullptr);
+            }
+        }
+    }
+}
+
+SCENARIO("Can save and load a dataframe as a columnar file"){
+    GIVEN("A dataframe with missing values and statistics saved to a file") {
+        const char *path = "frame_file_test.cols";
+        DataFrame df(std::make_unique<Schema>("IBFS"));
+        Row row(df.get_schema());
+        for(int i = 0; i < ROW_CNT; ++i) {
+            row.set(0, i % 5 == 0 ? std::nullopt : std::optional<int>(i - 100));
+            row.set(1, std::optional<bool>(i % 3 == 0));
+            row.set(2, i % 4 == 0 ? std::nullopt : std::optional<double>(i / 8.0));
+            row.set(3, i % 7 == 0 ? std::nullopt : std::optional<std::string>(std::to_string(i)));
+            df.add_row(row);
+        }
+        df.compute_stats();
+        REQUIRE(df.save(path));
+
+        THEN("Loading it gives the same dataframe, statistics and zone maps") {
+            auto loaded = DataFrame::load(path);
+            REQUIRE(loaded != nullptr);
+            REQUIRE(loaded->equals(&df));
+            REQUIRE(loaded->get_stats(2)->equals(df.get_stats(2).get()));
+            REQUIRE(!loaded->get_int(0, 0).has_value());
+            REQUIRE(static_cast<const IntColumn&>(loaded->get_column(0)).get_zones()
+                    == static_cast<const IntColumn&>(df.get_column(0)).get_zones());
+        }
+
+        THEN("A subset of the columns can be loaded") {
+            auto loaded = DataFrame::load(path, {3, 0});
+            REQUIRE(loaded != nullptr);
+            REQUIRE(loaded->get_schema().col_type(0) == 'S');
+            REQUIRE(loaded->get_schema().col_type(1) == 'I');
+            REQUIRE(loaded->nrows() == ROW_CNT);
+            REQUIRE(loaded->get_string(0, 8) == std::optional<std::string>("8"));
+            REQUIRE(loaded->get_int(1, 8) == std::optional<int>(-92));
+            REQUIRE(DataFrame::load(path, {4}) == nullptr);
+        }
+
+        THEN("Mapping it gives a dataframe reading the file in place") {
+            auto mapped = DataFrame::open_mmap(path);
+            REQUIRE(mapped != nullptr);
+            REQUIRE(static_cast<const IntColumn&>(mapped->get_column(0)).get_array().is_mapped());
+            REQUIRE(mapped->equals(&df));
+            REQUIRE(df.equals(mapped.get()));
+            REQUIRE(mapped->hash() == df.hash());
+            REQUIRE(mapped->serialize() == df.serialize());
+            REQUIRE(mapped->get_stats(0)->equals(df.get_stats(0).get()));
+            REQUIRE(mapped->get_string(3, 8) == std::optional<std::string>("8"));
+            REQUIRE(!mapped->get_string(3, 7).has_value());
+            REQUIRE(mapped->get_bool(1, 3) == std::optional<bool>(true));
+            REQUIRE(mapped->count({ EqualsPredicate(0, 21) }) == 1);
+        }
+
+        THEN("Scanning a mapped dataframe reads it in place without copying it") {
+            auto mapped = DataFrame::open_mmap(path);
+            REQUIRE(mapped != nullptr);
+            TypedFrame<int, bool, double, std::string> tf(*mapped);
+            bool same = true;
+            for(size_t r = 0; r < tf.nrows(); ++r) {
+                same = same && tf.get<0>(r) == df.get_int(0, r)
+                            && tf.get<1>(r) == df.get_bool(1, r)
+                            && tf.get<2>(r) == df.get_double(2, r)
+                            && tf.get<3>(r) == df.get_string(3, r);
+            }
+            REQUIRE(same);
+            for(size_t c = 0; c < df.ncols(); ++c) {
+                REQUIRE(mapped->top_k(c, 10)->equals(df.top_k(c, 10).get()));
+            }
+            mapped->compute_stats();
+            REQUIRE(mapped->get_stats(3)->equals(df.get_stats(3).get()));
+            REQUIRE(mapped->build_index(3, ROW_CNT));
+
+            REQUIRE(!static_cast<const IntColumn&>(mapped->get_column(0)).get_array().is_copied());
+            REQUIRE(!static_cast<const BoolColumn&>(mapped->get_column(1)).get_array().is_copied());
+            REQUIRE(!static_cast<const FloatColumn&>(mapped->get_column(2)).get_array().is_copied());
+            REQUIRE(!static_cast<const StringColumn&>(mapped->get_column(3)).get_array().is_copied());
+        }
+
+        THEN("Changing a mapped dataframe copies the column and leaves the file") {
+            auto mapped = DataFrame::open_mmap(path, {0, 3});
+            REQUIRE(mapped != nullptr);
+            mapped->set(0, 1, std::optional<int>(7));
+            REQUIRE(!static_cast<const IntColumn&>(mapped->get_column(0)).get_array().is_mapped());
+            REQUIRE(mapped->get_int(0, 1) == std::optional<int>(7));
+            REQUIRE(mapped->get_int(0, 2) == std::optional<int>(-98));
+            REQUIRE(DataFrame::open_mmap(path)->get_int(0, 1) == std::optional<int>(-99));
+        }
+
+        THEN("Saving a mapped dataframe over its own file replaces the file whole") {
+            auto mapped = DataFrame::open_mmap(path);
+            REQUIRE(mapped != nullptr);
+            REQUIRE(mapped->save(path));
+            REQUIRE(mapped->equals(&df));
+            auto loaded = DataFrame::load(path);
+            REQUIRE(loaded != nullptr);
+            REQUIRE(loaded->equals(&df));
+            REQUIRE(loaded->get_int(0, 6) == std::optional<int>(-94));
+        }
+
+        THEN("Files that are not frame files are rejected") {
+            std::vector<uint8_t> data = df.serialize();
+            FILE *f = fopen(path, "wb");
+            fwrite(data.data(), 1, 100, f);
+            fclose(f);
+            REQUIRE(DataFrame::load(path) == nullptr);
+            REQUIRE(DataFrame::open_mmap(path) == nullptr);
+            REQUIRE(DataFrame::load("no_such_file.cols") == nullptr);
+            REQUIRE(DataFrame::open_mmap("no_such_file.cols") == nullptr);
+        }
+        std::remove(path);
+    }
+}
+
+SCENARIO("Compressed bitmaps switch between arrays and bitsets"){
+    GIVEN("A sparse and a dense bitmap") {
+        Bitmap sparse;
+        for(uint32_t i = 0; i < 200000; i += 100) sparse.add(i);
+        Bitmap dense = Bitmap::range(50000, 150000);
+
+        THEN("Set operations match the values in each") {
+            REQUIRE(sparse.cardinality() == 2000);
+            REQUIRE(dense.cardinality() == 100000);
+            REQUIRE((sparse & dense).cardinality() == 1000);
+            REQUIRE((sparse | dense).cardinality() == 101000);
+            REQUIRE(sparse.and_not(dense).cardinality() == 1000);
+            REQUIRE(dense.negate(200000).cardinality() == 100000);
+            REQUIRE((dense & sparse).contains(50000));
+            REQUIRE(!(dense & sparse).contains(50001));
+        }
+
+        THEN("Removing values below the threshold converts back to an array") {
+            size_t removed = 0;
+            for(uint32_t i = 50000; i < 65536 - BITMAP_ARRAY_MAX; ++i) removed += dense.remove(i);
+            REQUIRE(removed == 65536 - BITMAP_ARRAY_MAX - 50000);
+            REQUIRE(dense.cardinality() == 100000 - (65536 - BITMAP_ARRAY_MAX - 50000));
+            REQUIRE(dense.to_vector().front() == 65536 - BITMAP_ARRAY_MAX);
+        }
+
+        THEN("They are serialized and deserialized") {
+            std::vector<uint8_t> data = (sparse | dense).serialize();
+            size_t pos = 0;
+            Bitmap copy = Serializable::deserialize<Bitmap>(data, pos);
+            REQUIRE(pos == data.size());
+            REQUIRE(copy == (sparse | dense));
+        }
+
+        THEN("Forged counts, keys and cardinalities are rejected") {
+            auto rejects = [](const std::vector<uint8_t>& data) {
+                size_t pos = 0;
+                try {
+                    Serializable::deserialize<Bitmap>(data, pos);
+                } catch(Serializable::ShortSerializedDataException& e) {
+                    return true;
+                }
+                return false;
+            };
+            // a container of the given key and cardinality, holding the values [0, len)
+            auto container = [](ByteWriter& w, uint16_t key, size_t cardinality, size_t len) {
+                w.write<uint16_t>(key);
+                w.write_size(cardinality);
+                for(uint16_t i = 0; i < len; ++i) w.write<uint16_t>(i);
+            };
+
+            std::vector<uint8_t> huge;
+            ByteWriter(huge).write_size(SIZE_MAX / 4);
+            REQUIRE(rejects(huge));
+
+            std::vector<uint8_t> unsorted;
+            ByteWriter uw(unsorted);
+            uw.write_size(2);
+            container(uw, 3, 1, 1);
+            container(uw, 2, 1, 1);
+            REQUIRE(rejects(unsorted));
+
+            std::vector<uint8_t> empty;
+            ByteWriter ew(empty);
+            ew.write_size(1);
+            container(ew, 0, 0, 0);
+            REQUIRE(rejects(empty));
+
+            std::vector<uint8_t> miscounted;
+            ByteWriter mw(miscounted);
+            mw.write_size(1);
+            container(mw, 0, BITMAP_ARRAY_MAX + 1, 1024 * 4);
+            REQUIRE(rejects(miscounted));
+        }
+    }
+}
+
+SCENARIO("Bitmap indexes answer equality predicates"){
+    GIVEN("A dataframe with low cardinality columns") {
+        DataFrame df(std::make_unique<Schema>("BISF"));
+        Row row(df.get_schema());
+        for(int i = 0; i < ROW_CNT; ++i) {
+            row.set(0, std::optional<bool>(i % 2 == 0));
+            row.set(1, i % 7 == 0 ? std::nullopt : std::optional<int>(i % 10));
+            row.set(2, std::optional<std::string>(i % 3 ? "x" : "y"));
+            row.set(3, std::optional<double>(i));
+            df.add_row(row);
+        }
+        std::vector<EqualsPredicate> preds = { EqualsPredicate(0, true), EqualsPredicate(2, "y") };
+        size_t expected = 0;
+        for(int i = 0; i < ROW_CNT; ++i) expected += i % 2 == 0 && i % 3 == 0;
+
+        THEN("Only bool, int and string columns with few values are indexed") {
+            REQUIRE(df.build_index(0));
+            REQUIRE(df.build_index(1));
+            REQUIRE(!df.build_index(3));
+            REQUIRE(!df.build_index(1, 5));
+            REQUIRE(df.get_index(1)->distinct() == 10);
+            REQUIRE(df.get_index(1)->missing().cardinality() == (ROW_CNT + 6) / 7);
+        }
+
+        THEN("Indexed and unindexed columns give the same answers") {
+            size_t scanned = df.count(preds);
+            df.build_index(0);
+            df.build_index(2);
+            REQUIRE(df.count(preds) == expected);
+            REQUIRE(scanned == expected);
+            REQUIRE(df.count({ EqualsPredicate(0, false), EqualsPredicate(1, 4) })
+                    == df.select({ EqualsPredicate(1, 4) }).and_not(df.select({ EqualsPredicate(0, true) })).cardinality());
+            REQUIRE(df.count({}) == ROW_CNT);
+        }
+
+        THEN("Filtering copies the matching rows") {
+            df.build_index(2);
+            auto filtered = df.filter(preds);
+            REQUIRE(filtered->nrows() == expected);
+            REQUIRE(filtered->get_int(1, 1) == 6);
+        }
+
+        THEN("Changing a column drops its index") {
+            df.build_index(0);
+            df.build_index(2);
+            df.set(0, 0, std::optional<bool>(false));
+            REQUIRE(df.get_index(0) == nullptr);
+            REQUIRE(df.get_index(2) != nullptr);
+            REQUIRE(df.count(preds) == expected - 1);
+            df.add_row(row);
+            REQUIRE(df.get_index(2) == nullptr);
+        }
     }
 }
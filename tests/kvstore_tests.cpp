@@ -1,9 +1,11 @@
 #include <string>
+#include <limits>
 
 #include "catch.hpp"
 
 #include "data/dataframe.h"
 #include "data/kvstore.h"
+#include "data/int_set.h"
 
 SCENARIO("Can construct a KVStore containing a Dataframe constructed from double array"){
     GIVEN("An array of doubles and a KVStore (with key)"){
@@ -67,3 +69,37 @@ SCENARIO("Can construct a KVStore containing a Dataframe constructed from boolea
         delete[] vals;
     }
 }
+
+SCENARIO("Can store a compressed set of ints in a KVStore"){
+    GIVEN("A set of negative, sparse and dense ints") {
+        IntSet set;
+        set.add(-5);
+        set.add(std::numeric_limits<int>::min());
+        for(int i = 100000; i < 200000; ++i) set.add(i);
+        for(int i = 0; i < 100000; i += 1000) set.add(i);
+        IntSet evens;
+        for(int i = -10; i < 150000; i += 2) evens.add(i);
+
+        THEN("It keeps the order and answers set operations") {
+            REQUIRE(set.size() == 100102);
+            REQUIRE(set.min() == std::numeric_limits<int>::min());
+            REQUIRE(set.max() == 199999);
+            REQUIRE(set.contains(-5));
+            REQUIRE(!set.contains(5));
+            REQUIRE(set.to_vector()[1] == -5);
+            REQUIRE((set & evens).size() == 100 + 25000);
+            REQUIRE((set | evens).size() == set.size() + evens.size() - (set & evens).size());
+            REQUIRE(set.and_not(evens).size() == set.size() - (set & evens).size());
+        }
+
+        WHEN("It is put in the KVStore") {
+            KVStore::Key k(std::string("int_set"));
+            put_int_set(k, set);
+
+            THEN("The same set can be fetched") {
+                auto fetched = get_int_set(k);
+                REQUIRE(fetched->equals(&set));
+            }
+        }
+    }
+}
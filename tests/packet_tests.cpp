@@ -1,8 +1,20 @@
 #include <cstring> 
+#include <unistd.h>
+#include <sys/socket.h>
 
 #include "catch.hpp"
 
 #include "network/packet.h"
+#include "network/ctc_connection.h"
+#include "data/dataframe.h"
+#include "util/codec.h"
+
+/** Exposes the packet parser of a client-to-client connection. */
+class ParsingConnection : public CtCConnection {
+public:
+    using CtCConnection::CtCConnection;
+    using CtCConnection::_parse_data;
+};
 
 SCENARIO("We can packet and unpack a packet") {
     GIVEN("A Packet containing some data.") {
@@ -45,3 +57,70 @@ SCENARIO("We can partially unpack a buffer using a packet"){
         }
     }
 }
+
+SCENARIO("Key lists are sent with shared prefixes in the compact encoding") {
+    GIVEN("A set of keys sharing prefixes") {
+        std::unordered_set<std::string> keys;
+        for(size_t d = 1; d <= 7; ++d) {
+            keys.insert("uuids_degree_" + std::to_string(d));
+            keys.insert("projects_degree_" + std::to_string(d));
+        }
+        keys.insert("");
+
+        THEN("Both encodings unpack to the same keys, the compact one smaller") {
+            std::vector<uint8_t> fixed = CtCConnection::pack_keys(keys, Encoding::FIXED);
+            std::vector<uint8_t> compact = CtCConnection::pack_keys(keys, Encoding::COMPACT);
+            REQUIRE(compact.size() * 3 < fixed.size());
+
+            std::vector<std::string> from_fixed = CtCConnection::unpack_keys(fixed, Encoding::FIXED);
+            std::vector<std::string> from_compact = CtCConnection::unpack_keys(compact, Encoding::COMPACT);
+            REQUIRE(std::unordered_set<std::string>(from_fixed.begin(), from_fixed.end()) == keys);
+            REQUIRE(std::unordered_set<std::string>(from_compact.begin(), from_compact.end()) == keys);
+        }
+    }
+}
+
+SCENARIO("Forged packets from another client are parse errors") {
+    GIVEN("A client-to-client connection that is never run") {
+        Client::init("127.0.0.1", "127.0.0.1", 8080);
+        int fds[2];
+        REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        close(fds[1]);
+        sockaddr_in other = {};
+        ParsingConnection conn(fds[0], other, *Client::get_instance().lock(), true);
+
+        THEN("A compressed value response claiming too large a block is rejected") {
+            Packet packet;
+            packet.type = Packet::Type::VALUE_RESPONSE_COMPRESSED;
+            ByteWriter w(packet.value, Encoding::COMPRESSED);
+            w.write<bool>(true);
+            w.write(std::string("key"));
+            Schema("S").serialize_into(w);
+            w.write_size(1);
+            w.write<uint8_t>(uint8_t(CodecId::LZ));
+            w.write_size(SIZE_MAX / 2);
+            w.write_size(4);
+            w.write_bytes(reinterpret_cast<const uint8_t *>("abcd"), 4);
+            w.write<bool>(false);
+            REQUIRE(conn._parse_data(packet) == ParseResult::ParseError);
+        }
+
+        THEN("A truncated value response is rejected") {
+            Packet packet;
+            packet.type = Packet::Type::VALUE_RESPONSE_COMPRESSED;
+            ByteWriter w(packet.value, Encoding::COMPRESSED);
+            w.write<bool>(true);
+            w.write(std::string("key"));
+            REQUIRE(conn._parse_data(packet) == ParseResult::ParseError);
+        }
+
+        THEN("A key list sharing more than the key before it is rejected") {
+            Packet packet;
+            packet.type = Packet::Type::KEY_LIST_COMPACT;
+            ByteWriter w(packet.value, Encoding::COMPACT);
+            w.write_varint(3);
+            w.write_varint(0);
+            REQUIRE(conn._parse_data(packet) == ParseResult::ParseError);
+        }
+    }
+}
@@ -80,6 +80,14 @@ SCENARIO("We can properly serialize and deserialize objects") {
                     REQUIRE(vec[i] == deserialized[i]);
                 }
             }
+
+            THEN("A length longer than the bytes left is rejected before making room for it"){
+                std::vector<uint8_t> forged = Serializable::serialize<size_t>(SIZE_MAX);
+                forged.insert(forged.end(), serialized.begin() + sizeof(size_t), serialized.end());
+                size_t pos = 0;
+                REQUIRE_THROWS_AS(Serializable::deserialize<std::vector<bool>>(forged, pos),
+                                  Serializable::ShortSerializedDataException);
+            }
         }
     }
 
@@ -138,6 +146,60 @@ SCENARIO("We can properly serialize and deserialize objects") {
         }
     }
 
+    GIVEN("A long nullable array with runs of missing values") {
+        NullableArray<double> na;
+        for(size_t i = 0; i < 1000; ++i) {
+            na.push_back(i % 10 < 3 ? std::nullopt : std::optional<double>(i * 0.5));
+        }
+
+        WHEN("We serialize it.") {
+            std::vector<uint8_t> serialized = na.serialize();
+
+            THEN("Only the existing values are written, and it round trips") {
+                REQUIRE(serialized.size() == sizeof(size_t) + 1000 / 8 + 700 * sizeof(double));
+                size_t pos = 0;
+                auto deserialized = NullableArray<double>::deserialize(serialized, pos);
+                REQUIRE(pos == serialized.size());
+                REQUIRE(deserialized == na);
+                REQUIRE_THROWS_AS(NullableArray<double>::deserialize(
+                                    std::vector<uint8_t>(serialized.begin(), serialized.end() - 1), pos = 0),
+                                  Serializable::ShortSerializedDataException);
+            }
+        }
+    }
+
+    GIVEN("Nullable arrays long enough to be split into chunks") {
+        NullableArray<int> ni;
+        NullableArray<std::string> ns;
+        for(size_t i = 0; i < 3 * PARALLEL_CHUNK_ROWS + 77; ++i) {
+            bool missing = i % 13 == 0 || (i / 1000) % 9 == 0;
+            ni.push_back(missing ? std::nullopt : std::optional<int>(int(i * 31)));
+            ns.push_back(missing ? std::nullopt : std::optional<std::string>(std::to_string(i)));
+        }
+
+        THEN("They serialize to the same bytes as a value at a time") {
+            std::vector<uint8_t> expected_i, expected_s;
+            ByteWriter wi(expected_i), ws(expected_s);
+            wi.write_bits(ni.bitmap());
+            ws.write_bits(ns.bitmap());
+            for(size_t i = 0; i < ni.size(); ++i) {
+                if(ni.exists(i)) wi.write(ni.data()[i]);
+                if(ns.exists(i)) ws.write(ns.data()[i]);
+            }
+            REQUIRE(ni.serialize() == expected_i);
+            REQUIRE(ns.serialize() == expected_s);
+        }
+
+        THEN("A change in the last chunk changes equality and the hash") {
+            NullableArray<std::string> other(ns);
+            REQUIRE(other == ns);
+            REQUIRE(other.hash() == ns.hash());
+            other.set(other.size() - 1, std::optional<std::string>("changed"));
+            REQUIRE(!(other == ns));
+            REQUIRE(other.hash() != ns.hash());
+        }
+    }
+
     GIVEN("A nullable array of booleans") {
         /* BoolColumn bc(6, false, true, false, true, true, false); */
         NullableArray<bool> nb;
@@ -346,4 +408,193 @@ SCENARIO("We can properly serialize and deserialize objects") {
             REQUIRE(tsr_one.get_sum() == tsr_two.get_sum());
         }
     }
+
+    GIVEN("A dataframe with statistics, serialized into a shared buffer") {
+        DataFrame df(std::make_unique<Schema>("ISFB"));
+        generate_large_dataframe(df, 5000);
+        df.set(1, 7, std::optional<std::string>(std::nullopt));
+        df.compute_stats();
+
+        std::vector<uint8_t> buffer;
+        ByteWriter w(buffer);
+        w.write<int>(42);
+        w.reserve(df.serialized_size() + ByteWriter::size_of(std::string("key")));
+        size_t capacity = buffer.capacity();
+        df.serialize_into(w);
+        w.write(std::string("key"));
+
+        THEN("The size is computed exactly and the buffer is never reallocated") {
+            REQUIRE(df.serialized_size() == df.serialize().size());
+            REQUIRE(buffer.size() == capacity);
+        }
+
+        THEN("It reads back with a ByteReader") {
+            size_t pos = 0;
+            ByteReader r(buffer, pos);
+            REQUIRE(r.read<int>() == 42);
+            DataFrame d_df = r.read<DataFrame>();
+            REQUIRE(r.read<std::string>() == "key");
+            REQUIRE(r.remaining() == 0);
+            REQUIRE(d_df.nrows() == df.nrows());
+            REQUIRE(!d_df.get_string(1, 7));
+            REQUIRE(d_df.get_stats(2)->equals(df.get_stats(2).get()));
+        }
+    }
+
+    GIVEN("A dataframe with a sorted id column, in the compact encoding") {
+        DataFrame df(std::make_unique<Schema>("ISFBI"));
+        generate_large_dataframe(df, 5000);
+        for(size_t r = 0; r < df.nrows(); ++r) {
+            df.set(4, r, std::optional<int>(int(r * 7) - 1000));
+        }
+        df.set(4, 11, std::optional<int>(std::nullopt));
+        df.compute_stats();
+
+        std::vector<uint8_t> buffer;
+        ByteWriter w(buffer, Encoding::COMPACT);
+        df.serialize_into(w);
+
+        THEN("It is smaller than the fixed encoding") {
+            REQUIRE(buffer.size() < df.serialized_size());
+        }
+
+        THEN("It reads back with a compact ByteReader") {
+            size_t pos = 0;
+            ByteReader r(buffer, pos, Encoding::COMPACT);
+            DataFrame d_df = r.read<DataFrame>();
+            REQUIRE(r.remaining() == 0);
+            REQUIRE(d_df.equals(&df));
+            REQUIRE(d_df.get_stats(4)->equals(df.get_stats(4).get()));
+        }
+    }
+
+    GIVEN("Varints of signed values") {
+        std::vector<int64_t> vals = {0, -1, 1, 63, -64, 64, 300, -100000, INT64_MAX, INT64_MIN};
+        std::vector<uint8_t> buffer;
+        ByteWriter w(buffer);
+        size_t expected = 0;
+        for(int64_t v : vals) {
+            w.write_varint(ByteWriter::zigzag(v));
+            expected += ByteWriter::varint_size(ByteWriter::zigzag(v));
+        }
+
+        THEN("Small values take a byte and every value reads back") {
+            REQUIRE(ByteWriter::varint_size(ByteWriter::zigzag(-64)) == 1);
+            REQUIRE(ByteWriter::varint_size(ByteWriter::zigzag(64)) == 2);
+            REQUIRE(buffer.size() == expected);
+            size_t pos = 0;
+            ByteReader r(buffer, pos);
+            std::vector<int64_t> read;
+            while(r.remaining() > 0) read.push_back(ByteReader::unzigzag(r.read_varint()));
+            REQUIRE(read == vals);
+        }
+    }
+
+    GIVEN("A dataframe with repetitive strings, in the compressed encoding") {
+        DataFrame df(std::make_unique<Schema>("SIF"));
+        generate_large_dataframe(df, 5000);
+        for(size_t r = 0; r < df.nrows(); ++r) {
+            df.set(0, r, std::optional<std::string>("user_" + std::to_string(r % 20)));
+        }
+
+        std::vector<uint8_t> compact;
+        ByteWriter cw(compact, Encoding::COMPACT);
+        df.serialize_into(cw);
+        std::vector<uint8_t> compressed;
+        ByteWriter w(compressed, Encoding::COMPRESSED);
+        df.serialize_into(w);
+
+        THEN("It is smaller than the compact encoding and reads back") {
+            REQUIRE(compressed.size() * 2 < compact.size());
+            size_t pos = 0;
+            ByteReader r(compressed, pos, Encoding::COMPRESSED);
+            DataFrame d_df = r.read<DataFrame>();
+            REQUIRE(r.remaining() == 0);
+            REQUIRE(d_df.equals(&df));
+        }
+
+        THEN("The report measures every codec on every column") {
+            std::vector<Codec::Report> reports = df.codec_report();
+            REQUIRE(reports.size() == 2 * df.ncols());
+            REQUIRE(reports[0].codec == CodecId::NONE);
+            REQUIRE(reports[0].ratio() == 1.0);
+            REQUIRE(reports[1].codec == CodecId::LZ);
+            REQUIRE(reports[1].ratio() > 2.0);
+        }
+    }
+
+    GIVEN("Blocks of bytes for the LZ codec") {
+        std::vector<uint8_t> runs(100000);
+        for(size_t i = 0; i < runs.size(); ++i) runs[i] = uint8_t((i / 300) % 7);
+        std::vector<uint8_t> noise(5000);
+        for(size_t i = 0; i < noise.size(); ++i) noise[i] = uint8_t(rand());
+        const Codec& lz = Codec::get(CodecId::LZ);
+
+        THEN("Each decompresses to the original bytes") {
+            for(const std::vector<uint8_t>& data : {runs, noise, std::vector<uint8_t>()}) {
+                std::vector<uint8_t> compressed;
+                lz.compress(data.data(), data.size(), compressed);
+                std::vector<uint8_t> out(data.size());
+                lz.decompress(compressed.data(), compressed.size(), out.data(), out.size());
+                REQUIRE(out == data);
+            }
+        }
+
+        THEN("A truncated block is detected") {
+            std::vector<uint8_t> compressed;
+            lz.compress(runs.data(), runs.size(), compressed);
+            std::vector<uint8_t> out(runs.size());
+            REQUIRE_THROWS_AS(lz.decompress(compressed.data(), compressed.size() - 1,
+                                            out.data(), out.size()),
+                              Codec::CorruptDataException);
+        }
+
+        THEN("A block claiming to decompress to more than it can is rejected") {
+            REQUIRE(lz.max_decompressed(10) == 10 * LZ_MAX_EXPANSION);
+            REQUIRE(Codec::get(CodecId::NONE).max_decompressed(10) == 10);
+
+            std::vector<uint8_t> forged;
+            ByteWriter w(forged, Encoding::COMPRESSED);
+            Schema("S").serialize_into(w);
+            w.write_size(1);
+            w.write<uint8_t>(uint8_t(CodecId::LZ));
+            w.write_size(SIZE_MAX / 2);
+            w.write_size(runs.size());
+            w.write_bytes(runs.data(), runs.size());
+            w.write<bool>(false);
+            size_t pos = 0;
+            ByteReader r(forged, pos, Encoding::COMPRESSED);
+            REQUIRE_THROWS_AS(r.read<DataFrame>(), Codec::CorruptDataException);
+        }
+
+        THEN("Only the compressible block is compressed") {
+            std::vector<uint8_t> out;
+            REQUIRE(Codec::choose(runs.data(), runs.size(), out).id() == CodecId::LZ);
+            REQUIRE(out.size() * 50 < runs.size());
+            REQUIRE(Codec::choose(noise.data(), noise.size(), out).id() == CodecId::NONE);
+            REQUIRE(out.empty());
+        }
+    }
+
+    GIVEN("A frame with a column for every thread") {
+        DataFrame df(std::make_unique<Schema>("ISFBISFBIS"));
+        generate_large_dataframe(df, 10000);
+
+        THEN("It serializes to the same bytes as a column at a time") {
+            std::vector<uint8_t> expected = df.get_schema().serialize();
+            ByteWriter w(expected);
+            w.write<size_t>(df.ncols());
+            for(size_t c = 0; c < df.ncols(); ++c) w.write(df.get_column(c));
+            for(size_t c = 0; c < df.ncols(); ++c) w.write<bool>(false);
+            REQUIRE(df.serialize() == expected);
+        }
+
+        THEN("Its copy is equal and has the same hash") {
+            size_t pos = 0;
+            std::vector<uint8_t> serialized = df.serialize();
+            DataFrame copy = Serializable::deserialize<DataFrame>(serialized, pos);
+            REQUIRE(copy.equals(&df));
+            REQUIRE(copy.hash() == df.hash());
+        }
+    }
 }
@@ -0,0 +1,185 @@
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <unordered_set>
+
+#include "catch.hpp"
+#include "test_util.h"
+
+#include "util/sketch.h"
+#include "data/dataframe.h"
+#include "data/schema.h"
+
+SCENARIO("Sketches approximate distinct counts, heavy hitters and quantiles"){
+    GIVEN("A large dataframe with a skewed string column") {
+        DataFrame df(std::make_unique<Schema>("IS"));
+        Row row(df.get_schema());
+        for(int i = 0; i < 40000; ++i) {
+            row.set(0, std::optional<int>(i % 25000));
+            // word w<j> appears roughly 1000 / (j + 1) times
+            row.set(1, std::optional<std::string>("w" + std::to_string(1000 / (i % 1000 + 1))));
+            df.add_row(row);
+        }
+
+        WHEN("The sketch rowers are run in a single parallel scan") {
+            DistinctCountRower dcr(0);
+            HeavyHittersRower hhr(1, 3);
+            QuantileRower qr(0);
+            df.pmap_many({&dcr, &hhr, &qr});
+
+            THEN("The distinct count is within a few percent") {
+                REQUIRE(std::abs(double(dcr.sketch().count()) - 25000) < 25000 * 0.03);
+            }
+
+            THEN("The most frequent words are found") {
+                auto top = hhr.sketch().top();
+                REQUIRE(top.size() == 3);
+                REQUIRE(top[0].first == "w1");
+                REQUIRE(top[0].second >= 20000);
+                REQUIRE(top[1].first == "w2");
+            }
+
+            THEN("Only the rowers whose merges are order independent join in a tree") {
+                REQUIRE(dcr.join_is_associative());
+                REQUIRE(!hhr.join_is_associative());
+                REQUIRE(!qr.join_is_associative());
+            }
+
+            THEN("Scanning again, one rower at a time, builds the same sketches") {
+                HeavyHittersRower hhr2(1, 3);
+                QuantileRower qr2(0);
+                df.pmap(hhr2);
+                df.pmap(qr2);
+                REQUIRE(hhr2.sketch().equals(&hhr.sketch()));
+                REQUIRE(qr2.sketch().equals(&qr.sketch()));
+            }
+
+            THEN("The quantiles have a small rank error") {
+                REQUIRE(qr.sketch().count() == 40000);
+                // the ints below 15000 appear twice, so the median is 10000
+                REQUIRE(std::abs(qr.sketch().quantile(0.5) - 10000) < 40000 * 0.03);
+                REQUIRE(std::abs(qr.sketch().quantile(0.9) - 21000) < 40000 * 0.03);
+            }
+
+            THEN("The sketches survive serialization") {
+                std::vector<uint8_t> data = dcr.sketch().serialize();
+                size_t pos = 0;
+                HyperLogLog hll = Serializable::deserialize<HyperLogLog>(data, pos);
+                REQUIRE(pos == data.size());
+                REQUIRE(hll.equals(&dcr.sketch()));
+
+                data = hhr.sketch().serialize();
+                pos = 0;
+                HeavyHitters hh = Serializable::deserialize<HeavyHitters>(data, pos);
+                REQUIRE(pos == data.size());
+                REQUIRE(hh.equals(&hhr.sketch()));
+
+                data = qr.sketch().serialize();
+                pos = 0;
+                QuantileSketch qs = Serializable::deserialize<QuantileSketch>(data, pos);
+                REQUIRE(pos == data.size());
+                REQUIRE(qs.equals(&qr.sketch()));
+            }
+
+            THEN("The sketches are written in place, in the size they report") {
+                REQUIRE(dcr.sketch().serialize().size() == dcr.sketch().serialized_size());
+                REQUIRE(hhr.sketch().serialize().size() == hhr.sketch().serialized_size());
+                REQUIRE(qr.sketch().serialize().size() == qr.sketch().serialized_size());
+
+                // several sketches share one compact buffer
+                std::vector<uint8_t> data;
+                ByteWriter w(data, Encoding::COMPACT);
+                w.write(hhr.sketch());
+                w.write(qr.sketch());
+                size_t pos = 0;
+                ByteReader r(data, pos, Encoding::COMPACT);
+                REQUIRE(r.read<HeavyHitters>().equals(&hhr.sketch()));
+                REQUIRE(r.read<QuantileSketch>().equals(&qr.sketch()));
+                REQUIRE(r.remaining() == 0);
+            }
+        }
+    }
+
+    GIVEN("Sketches with forged sizes, as a faulty or hostile node might send") {
+        auto forged = [](auto&& write) {
+            std::vector<uint8_t> data;
+            ByteWriter w(data);
+            write(w);
+            // a little more than the headers, but never enough for what they claim
+            w.write_bytes(std::vector<uint8_t>(64, 1).data(), 64);
+            return data;
+        };
+        auto rejects = [](const std::vector<uint8_t>& data, auto sketch) {
+            size_t pos = 0;
+            try {
+                Serializable::deserialize<decltype(sketch)>(data, pos);
+            } catch(Serializable::ShortSerializedDataException& e) {
+                return true;
+            }
+            return false;
+        };
+
+        THEN("Each is rejected before anything is made for it") {
+            // precisions outside the constructor's range, or with too few registers
+            REQUIRE(rejects(forged([](ByteWriter& w){ w.write<uint8_t>(40); }), HyperLogLog()));
+            REQUIRE(rejects(forged([](ByteWriter& w){ w.write<uint8_t>(18); }), HyperLogLog()));
+            // empty, overflowing and oversized counter tables
+            REQUIRE(rejects(forged([](ByteWriter& w){ w.write_size(0); w.write_size(4); }), CountMinSketch()));
+            REQUIRE(rejects(forged([](ByteWriter& w){
+                w.write_size(size_t(1) << 62);
+                w.write_size(8);
+            }), CountMinSketch()));
+            REQUIRE(rejects(forged([](ByteWriter& w){ w.write_size(1 << 20); w.write_size(4); }), CountMinSketch()));
+            // more candidates than k, or than the bytes left could hold
+            REQUIRE(rejects(forged([](ByteWriter& w){
+                w.write_size(3);
+                w.write(CountMinSketch(1, 1));
+                w.write_size(4);
+            }), HeavyHitters(3)));
+            REQUIRE(rejects(forged([](ByteWriter& w){
+                w.write_size(SIZE_MAX);
+                w.write(CountMinSketch(1, 1));
+                w.write_size(SIZE_MAX / 2);
+            }), HeavyHitters(3)));
+            // a capacity the constructor rejects, no levels, too many levels, and a long level
+            REQUIRE(rejects(forged([](ByteWriter& w){ w.write_size(0); }), QuantileSketch()));
+            REQUIRE(rejects(forged([](ByteWriter& w){
+                w.write_size(8);
+                w.write<uint64_t>(0);
+                w.write<bool>(false);
+                w.write_size(0);
+            }), QuantileSketch()));
+            REQUIRE(rejects(forged([](ByteWriter& w){
+                w.write_size(8);
+                w.write<uint64_t>(0);
+                w.write<bool>(false);
+                w.write_size(SIZE_MAX);
+            }), QuantileSketch()));
+            REQUIRE(rejects(forged([](ByteWriter& w){
+                w.write_size(8);
+                w.write<uint64_t>(0);
+                w.write<bool>(false);
+                w.write_size(1);
+                w.write_size(SIZE_MAX / 4 + 1);
+            }), QuantileSketch()));
+        }
+    }
+
+    GIVEN("Two HyperLogLogs over overlapping values") {
+        HyperLogLog a, b, both;
+        for(int i = 0; i < 3000; ++i) {
+            a.add(i);
+            both.add(i);
+        }
+        for(int i = 2000; i < 5000; ++i) {
+            b.add(i);
+            both.add(i);
+        }
+        WHEN("They are merged") {
+            a.merge(b);
+            THEN("The result is the sketch of the union") {
+                REQUIRE(a.equals(&both));
+            }
+        }
+    }
+}
@@ -1,6 +1,12 @@
+#include <cstdio>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
 #include "catch.hpp"
 
 #include "adapter/sorer_dataframe_adapter.h"
+#include "adapter/sor_stream.h"
+#include "util/word_reader.h"
 #include "data/dataframe.h"
 
 SCENARIO("Can use Sorer library to construct dataframe"){
@@ -30,6 +36,256 @@ SCENARIO("Can use Sorer library to construct dataframe"){
             REQUIRE((df->get_bool(0, 2).has_value() && *(df->get_bool(0, 2)) == true));
             REQUIRE((df->get_int(1, 2).has_value() && *(df->get_int(1, 2)) == 1));
             REQUIRE((!df->get_string(2, 2)));
+            std::remove(SorerDataframeAdapter::cache_path(fn).c_str());
          }
     }
 }
+
+SCENARIO("Parsed SOR files are cached next to the file"){
+    GIVEN("A SOR file parsed once"){
+        std::string fn("sorer_cache_test.sor");
+        std::string cache = SorerDataframeAdapter::cache_path(fn);
+        {
+            std::ofstream out(fn);
+            out <<"<0> <23> <hi>\n<1> <12> <>\n";
+        }
+        auto parsed = SorerDataframeAdapter::parse_file(fn);
+        REQUIRE(parsed);
+        REQUIRE(std::ifstream(cache).good());
+
+        THEN("Parsing it again maps the cache instead"){
+            auto cached = SorerDataframeAdapter::parse_file(fn, true);
+            REQUIRE(cached);
+            REQUIRE(static_cast<const IntColumn&>(cached->get_column(1)).get_array().is_mapped());
+            REQUIRE(cached->equals(parsed.get()));
+            REQUIRE(cached->get_stats(1) != nullptr);
+        }
+
+        THEN("Forcing a parse or changing the file parses it again"){
+            auto forced = SorerDataframeAdapter::parse_file(fn, false, true);
+            REQUIRE(!static_cast<const IntColumn&>(forced->get_column(1)).get_array().is_mapped());
+            {
+                std::ofstream out(fn, std::ios::app);
+                out <<"<1> <7> <yo>\n";
+            }
+            auto changed = SorerDataframeAdapter::parse_file(fn);
+            REQUIRE(changed->nrows() == 3);
+            REQUIRE(!static_cast<const IntColumn&>(changed->get_column(1)).get_array().is_mapped());
+            REQUIRE(SorerDataframeAdapter::parse_file(fn)->get_int(1, 2) == std::optional<int>(7));
+        }
+        std::remove(fn.c_str());
+        std::remove(cache.c_str());
+    }
+}
+
+SCENARIO("The SoR reader infers the schema and parses every field"){
+    GIVEN("SoR text with every type, missing fields and a short line"){
+        std::string text = "<0> <12> <1.5> <hi> <1>\n"
+                           "\n"
+                           "<1> < -3 > <2> <\"a b\"> <0>\n"
+                           "<1> <x> <3e2> <> <1>\n"
+                           "<0> <7>\n";
+        auto df = SorReader::parse(text.data(), text.data() + text.size());
+
+        THEN("Each column takes the most general type of its values"){
+            REQUIRE(df->ncols() == 5);
+            REQUIRE(df->get_schema().col_type(0) == 'B');
+            REQUIRE(df->get_schema().col_type(1) == 'S');
+            REQUIRE(df->get_schema().col_type(2) == 'F');
+            REQUIRE(df->get_schema().col_type(3) == 'S');
+            REQUIRE(df->get_schema().col_type(4) == 'B');
+        }
+
+        THEN("Blank lines are skipped and short lines padded with missing values"){
+            REQUIRE(df->nrows() == 4);
+            REQUIRE(df->get_string(1, 1) == std::optional<std::string>("-3"));
+            REQUIRE(df->get_string(3, 1) == std::optional<std::string>("a b"));
+            REQUIRE(df->get_double(2, 2) == std::optional<double>(300));
+            REQUIRE(!df->get_string(3, 2));
+            REQUIRE(df->get_string(1, 3) == std::optional<std::string>("7"));
+            REQUIRE(!df->get_double(2, 3));
+            REQUIRE(!df->get_bool(4, 3));
+        }
+    }
+
+    GIVEN("SoR text with brackets in quotes and numbers from_chars alone would misread"){
+        std::string text = "<+12> <1e3> <\"<a> b\">   <inf>\n"
+                           "<+-1> <.5> <\">\"> <nan> <extra>\n"
+                           "<3000000000> <-2.5E-1> <\"unclosed>\n";
+        auto df = SorReader::parse(text.data(), text.data() + text.size());
+
+        THEN("Quoted brackets belong to the string, and bad numbers are missing"){
+            REQUIRE(df->ncols() == 5);
+            REQUIRE(df->nrows() == 3);
+            REQUIRE(df->get_schema().col_type(0) == 'S');
+            REQUIRE(df->get_schema().col_type(1) == 'F');
+            REQUIRE(df->get_schema().col_type(3) == 'S');
+            REQUIRE(df->get_string(2, 0) == std::optional<std::string>("<a> b"));
+            REQUIRE(df->get_string(2, 1) == std::optional<std::string>(">"));
+            REQUIRE(!df->get_string(2, 2));
+            REQUIRE(df->get_double(1, 0) == std::optional<double>(1000));
+            REQUIRE(df->get_double(1, 1) == std::optional<double>(0.5));
+            REQUIRE(df->get_double(1, 2) == std::optional<double>(-0.25));
+            REQUIRE(df->get_string(3, 1) == std::optional<std::string>("nan"));
+        }
+    }
+
+    GIVEN("SoR text large enough to be split between threads"){
+        std::string text;
+        for(int i = 0; i < 100000; ++i) {
+            text += "<" + std::to_string(i % 2) + "> <" + std::to_string(i) + "> <"
+                + (i % 9 == 0 ? "" : std::to_string(i / 4.0)) + "> <\"row " + std::to_string(i) + "\">\n";
+        }
+        REQUIRE(text.size() > 2 * SOR_MIN_THREAD_BYTES);
+
+        THEN("It reads the same as on one thread"){
+            auto serial = SorReader::parse(text.data(), text.data() + text.size(), 1);
+            auto parallel = SorReader::parse(text.data(), text.data() + text.size());
+            REQUIRE(parallel->nrows() == 100000);
+            REQUIRE(parallel->equals(serial.get()));
+            REQUIRE(parallel->get_int(1, 99999) == std::optional<int>(99999));
+            REQUIRE(parallel->get_string(3, 12345) == std::optional<std::string>("row 12345"));
+            REQUIRE(!parallel->get_double(2, 99999 - 99999 % 9));
+        }
+
+        THEN("Its row count is estimated from a sample of its lines"){
+            size_t estimate = SorReader::estimate_rows(text.data(), text.data() + text.size());
+            REQUIRE(estimate > 95000);
+            REQUIRE(estimate < 105000);
+        }
+    }
+}
+
+SCENARIO("A SoR file can be streamed in row groups"){
+    GIVEN("A file of 1000 lines"){
+        std::string fn = "sor_stream_test.sor";
+        {
+            std::ofstream out(fn);
+            for(int i = 0; i < 1000; ++i) out <<"<" <<i <<"> <\"row " <<i <<"\">\n";
+        }
+        auto whole = SorReader::read(fn);
+
+        THEN("Its groups hold every row in order, and the watermark counts them"){
+            auto stream = SorStream::open(fn, 300, 2);
+            REQUIRE(stream);
+            REQUIRE(stream->get_schema().col_type(0) == 'I');
+            std::vector<size_t> sizes;
+            size_t row = 0;
+            for(auto group = stream->next(); group; group = stream->next()) {
+                REQUIRE(stream->committed_rows() >= row + group->nrows());
+                for(size_t r = 0; r < group->nrows(); ++r, ++row) {
+                    REQUIRE(group->get_int(0, r) == whole->get_int(0, row));
+                    REQUIRE(group->get_string(1, r) == whole->get_string(1, row));
+                }
+                sizes.push_back(group->nrows());
+            }
+            REQUIRE(sizes == std::vector<size_t>({300, 300, 300, 100}));
+            REQUIRE(stream->done());
+            REQUIRE(stream->committed_rows() == 1000);
+            REQUIRE(stream->committed_groups() == 4);
+        }
+
+        THEN("A stream can be dropped before it is finished"){
+            auto stream = SorStream::open(fn, 10, 1);
+            REQUIRE(stream->next()->nrows() == 10);
+            stream = nullptr;
+        }
+        std::remove(fn.c_str());
+    }
+}
+
+SCENARIO("Dataframes can be written out as SoR and CSV"){
+    GIVEN("A dataframe of every type with missing values, over several chunks"){
+        DataFrame df(std::make_unique<Schema>("IBFS"));
+        Row row(df.get_schema());
+        for(int i = 0; i < 200000; ++i) {
+            row.set(0, i % 5 == 0 ? std::nullopt : std::optional<int>(i - 100));
+            row.set(1, std::optional<bool>(i % 3 == 0));
+            row.set(2, i % 4 == 1 ? std::nullopt : std::optional<double>(i / 8.0));
+            row.set(3, i % 7 == 0 ? std::nullopt : std::optional<std::string>("row " + std::to_string(i)));
+            df.add_row(row);
+        }
+
+        THEN("Reading the SoR back gives the same dataframe"){
+            std::string fn = "frame_writer_test.sor";
+            int fd = open(fn.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            REQUIRE(fd >= 0);
+            REQUIRE(df.write_sor(fd));
+            close(fd);
+            auto read = SorReader::read(fn);
+            std::remove(fn.c_str());
+            REQUIRE(read->equals(&df));
+        }
+    }
+
+    GIVEN("A dataframe of strings that need quoting"){
+        DataFrame df(std::make_unique<Schema>("IBFS"));
+        Row row(df.get_schema());
+        row.set(0, std::optional<int>(1));
+        row.set(1, std::optional<bool>(true));
+        row.set(2, std::optional<double>(2));
+        row.set(3, std::optional<std::string>("a,b"));
+        df.add_row(row);
+        row.set(0, std::optional<int>());
+        row.set(1, std::optional<bool>(false));
+        row.set(2, std::optional<double>(0.5));
+        row.set(3, std::optional<std::string>("say \"hi\""));
+        df.add_row(row);
+        row.set(1, std::optional<bool>());
+        row.set(2, std::optional<double>());
+        row.set(3, std::optional<std::string>(""));
+        df.add_row(row);
+
+        THEN("The CSV quotes them and leaves missing values empty"){
+            std::string fn = "frame_writer_test.csv";
+            int fd = open(fn.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            REQUIRE(fd >= 0);
+            REQUIRE(df.write_csv(fd));
+            close(fd);
+            std::ifstream in(fn);
+            std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            std::remove(fn.c_str());
+            REQUIRE(text == "1,1,2.0,\"a,b\"\n,0,0.5,\"say \"\"hi\"\"\"\n,,,\"\"\n");
+        }
+    }
+}
+
+SCENARIO("The words of text files are read in parallel"){
+    GIVEN("Text with words between every kind of whitespace"){
+        std::string text = "  the quick\tbrown\n\nfox\r\njumps\vover the\flazy dog";
+
+        THEN("Every word is a row, in order"){
+            auto df = WordReader::parse(text.data(), text.data() + text.size());
+            REQUIRE(df->ncols() == 1);
+            REQUIRE(df->nrows() == 9);
+            REQUIRE(df->get_string(0, 0) == std::optional<std::string>("the"));
+            REQUIRE(df->get_string(0, 3) == std::optional<std::string>("fox"));
+            REQUIRE(df->get_string(0, 8) == std::optional<std::string>("dog"));
+        }
+    }
+
+    GIVEN("Two files, one large enough to be split between threads"){
+        std::string large;
+        for(int i = 0; large.size() < 3 * WORD_MIN_RANGE_BYTES; ++i) {
+            large += "word" + std::to_string(i % 1000) + (i % 10 == 9 ? "\n" : " ");
+        }
+        std::string small = "last words";
+        std::ofstream("word_reader_test_1.txt") <<large;
+        std::ofstream("word_reader_test_2.txt") <<small;
+
+        THEN("They read as the words of the first followed by those of the second"){
+            auto df = WordReader::read({"word_reader_test_1.txt", "word_reader_test_2.txt"});
+            auto serial = WordReader::parse(large.data(), large.data() + large.size(), 1);
+            REQUIRE(df);
+            REQUIRE(df->nrows() == serial->nrows() + 2);
+            for(size_t r = 0; r < serial->nrows(); r += 997) {
+                REQUIRE(df->get_string(0, r) == serial->get_string(0, r));
+            }
+            REQUIRE(df->get_string(0, serial->nrows() - 1) == serial->get_string(0, serial->nrows() - 1));
+            REQUIRE(df->get_string(0, serial->nrows() + 1) == std::optional<std::string>("words"));
+            REQUIRE(!WordReader::read({"word_reader_test_missing.txt"}));
+        }
+        std::remove("word_reader_test_1.txt");
+        std::remove("word_reader_test_2.txt");
+    }
+}
@@ -1,5 +1,6 @@
 #include "data/rower.h"
 #include "data/fielder.h"
+#include "data/parallel_frame_builder.h"
 
 class TestSumRower : public Rower {
 private:
@@ -76,3 +77,50 @@ public:
         return dynamic_cast<const TestSumRower *>(other);
     }
 };
+
+/** Same as TestSumRower, but lets pmap join its clones in parallel. */
+class TestAssociativeSumRower : public TestSumRower {
+public:
+    std::shared_ptr<Object> clone() const override {
+        return std::make_shared<TestAssociativeSumRower>();
+    }
+
+    bool join_is_associative() const override {
+        return true;
+    }
+};
+
+/** Copies every row it sees into a shared ParallelFrameBuilder. */
+class TestCopyRower : public Rower {
+private:
+    std::shared_ptr<ParallelFrameBuilder> _builder;
+    ParallelFrameBuilder::Segment *_segment;
+public:
+    TestCopyRower(std::shared_ptr<ParallelFrameBuilder> builder)
+        : _builder(builder), _segment(&builder->segment(0)) {}
+
+    bool accept(Row& r) override {
+        _segment->add_row(r);
+        return true;
+    }
+
+    void start_worker(size_t worker, size_t worker_cnt) override {
+        _builder->set_workers(worker_cnt);
+        _segment = &_builder->segment(worker);
+    }
+
+    std::shared_ptr<Object> clone() const override {
+        return std::make_shared<TestCopyRower>(_builder);
+    }
+
+    void join([[maybe_unused]] std::shared_ptr<Rower> other) override {}
+
+    size_t hash() const override {
+        return reinterpret_cast<size_t>(_builder.get());
+    }
+
+    bool equals(const Object* other) const override {
+        auto tcr = dynamic_cast<const TestCopyRower *>(other);
+        return tcr && tcr->_builder == _builder;
+    }
+};